@@ -27,6 +27,11 @@ ALL_STUKOBJS += $(STUKOBJS)
 
 STUKCLEANS += $(STUKDIR)/partial_kernel.o
 
+# TIMER_BACKEND = lapic (see config.mk) moves the timer to the local APIC
+ifeq ($(TIMER_BACKEND),lapic)
+$(STUKDIR)/game.o: CFLAGS += -DTIMER_LAPIC
+endif
+
 ifeq ($(STUKOBJS),)
 $(STUKDIR)/partial_kernel.o :
 	touch $@
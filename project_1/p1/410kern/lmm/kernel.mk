@@ -6,14 +6,38 @@
                  lmm_alloc_gen.o \
                  lmm_alloc_page.o \
                  lmm_avail.o \
+                 lmm_buddy.o \
                  lmm_dump.o \
                  lmm_find_free.o \
                  lmm_free.o \
+                 lmm_free_page.o \
                  lmm_init.o \
                  lmm_remove_free.o \
+                 lmm_resize.o \
+
+# LMM_VARIANT = segregated (see config.mk) replaces the address ordered
+# free lists with size bins and an address treap, all in lmm_seg.c.
+ifeq ($(LMM_VARIANT),segregated)
+410K_LMM_OBJS := \
+                 lmm_add_free.o \
+                 lmm_alloc_aligned.o \
+                 lmm_alloc_page.o \
+                 lmm_buddy.o \
+                 lmm_free_page.o \
+                 lmm_init.o \
+                 lmm_remove_free.o \
+                 lmm_seg.o \
+
+endif
 
 410K_LMM_OBJS := $(410K_LMM_OBJS:%=$(410KDIR)/lmm/%)
 
+# struct lmm_region differs between the variants, so everything that
+# allocates one must agree with the library on which it is.
+ifeq ($(LMM_VARIANT),segregated)
+$(410K_LMM_OBJS) $(410KDIR)/boot/util_lmm.o: CFLAGS += -DLMM_SEGREGATED
+endif
+
 ALL_410KOBJS += $(410K_LMM_OBJS)
 410KCLEANS += $(410KDIR)/liblmm.a
 
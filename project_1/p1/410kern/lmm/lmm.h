@@ -32,6 +32,7 @@
 typedef struct lmm
 {
 	struct lmm_region *regions;
+	struct lmm_buddy *buddy;
 } lmm_t;
 
 typedef struct lmm_region lmm_region_t;
@@ -58,6 +59,7 @@ vm_size_t lmm_avail(lmm_t *lmm, lmm_flags_t flags);
 void lmm_find_free(lmm_t *lmm, vm_offset_t *inout_addr,
 		   vm_size_t *out_size, lmm_flags_t *out_flags);
 void lmm_free(lmm_t *lmm, void *block, vm_size_t size);
+int lmm_resize(lmm_t *lmm, void *block, vm_size_t size, vm_size_t new_size);
 void lmm_free_page(lmm_t *lmm, void *block);
 
 void lmm_dump(lmm_t *lmm);
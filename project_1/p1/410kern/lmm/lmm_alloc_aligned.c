@@ -21,10 +21,18 @@
 
 #include <lmm/lmm.h>
 #include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
 
 void *lmm_alloc_aligned(lmm_t *lmm, vm_size_t size, lmm_flags_t flags,
 			int align_bits, vm_offset_t align_ofs)
 {
+	int order = lmm_buddy_order(size, align_bits, align_ofs);
+	void *block;
+
+	/* Naturally aligned page blocks come from the buddy allocator.  */
+	if (order >= 0 && (block = lmm_buddy_alloc(lmm, order, flags)))
+		return block;
+
 	return lmm_alloc_gen(lmm, size, flags,
 			     align_bits, align_ofs,
 			     (vm_offset_t)0, (vm_size_t)-1);
@@ -25,7 +25,6 @@
 
 void *lmm_alloc_page(lmm_t *lmm, lmm_flags_t flags)
 {
-	return lmm_alloc_gen(lmm, PAGE_SIZE, flags, PAGE_SHIFT, 0,
-			     (vm_offset_t)0, (vm_size_t)-1);
+	return lmm_alloc_aligned(lmm, PAGE_SIZE, flags, PAGE_SHIFT, 0);
 }
 
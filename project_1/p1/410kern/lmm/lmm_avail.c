@@ -21,6 +21,7 @@
 
 #include <lmm/lmm.h>
 #include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
 #include <assert.h>
 
 vm_size_t lmm_avail(lmm_t *lmm, lmm_flags_t flags)
@@ -42,6 +43,8 @@ vm_size_t lmm_avail(lmm_t *lmm, lmm_flags_t flags)
 
 		count += reg->free;
 	}
-	return count;
+
+	/* Free pages of buddy arenas are allocated as far as lmm knows.  */
+	return count + lmm_buddy_avail(lmm, flags);
 }
 
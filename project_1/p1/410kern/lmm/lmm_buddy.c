@@ -0,0 +1,300 @@
+/** @file lmm/lmm_buddy.c
+ *  @brief Binary buddy allocator for naturally aligned page blocks
+ *
+ *  A free block of 2^k pages is on the free list of order k, linked
+ *  through its first bytes, which also point to its arena.  Each arena
+ *  has one bit per pair of buddies of every order below the top one,
+ *  the exclusive or of "this half is free" for the two halves:
+ *
+ *  -- Taking a block off a free list or freeing one flips its pair's
+ *  bit.  When freeing flips it to 0 the buddy is free as well, so the
+ *  two merge and the merged block is freed one order up.
+ *  -- Splitting a block puts its upper half on the free list one order
+ *  down and flips that pair's bit.
+ *
+ *  Allocating and freeing are thus O(BUDDY_MAX_ORDER), whatever the
+ *  number of free blocks.  Free lists are shared by all the arenas;
+ *  a request with region flags skips blocks of arenas without them.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Not thread-safe, like the rest of lmm
+ */
+
+#include <assert.h>
+#include <string/string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
+
+/** @brief Pairs of buddies in an arena, over all orders below the top */
+#define BUDDY_PAIRS	((1 << BUDDY_MAX_ORDER) - 1)
+
+/** @brief Free block */
+struct buddy_block
+{
+	struct buddy_block *next;
+	struct buddy_block *prev;
+	struct buddy_arena *arena;
+};
+
+/** @brief Arena carved out of the lmm */
+struct buddy_arena
+{
+	/** @brief Whether the slot is in use */
+	int used;
+	/** @brief Start, aligned to BUDDY_ARENA_SIZE */
+	vm_offset_t base;
+	/** @brief Flags of the region it came from */
+	lmm_flags_t flags;
+	/** @brief Bytes on free lists */
+	vm_size_t free;
+	/** @brief Buddy pair bits, order 0 first */
+	unsigned char bits[(BUDDY_PAIRS + 7) / 8];
+};
+
+/** @brief Buddy allocator of an lmm, allocated from it on first use */
+struct lmm_buddy
+{
+	/** @brief Free blocks by order */
+	struct buddy_block *free[BUDDY_MAX_ORDER + 1];
+	/** @brief Arena slots */
+	struct buddy_arena arenas[BUDDY_MAX_ARENAS];
+	/** @brief Arenas in use, by address */
+	struct buddy_arena *sorted[BUDDY_MAX_ARENAS];
+	/** @brief Number of them */
+	int count;
+};
+
+/** @brief Flip the pair bit of a block of the given order
+ *
+ *  @return The new value of the bit
+ */
+static int buddy_flip(struct buddy_arena *a, int order, vm_offset_t block)
+{
+	unsigned int bit = (1 << BUDDY_MAX_ORDER) -
+			   (1 << (BUDDY_MAX_ORDER - order)) +
+			   ((block - a->base) >> (PAGE_SHIFT + order + 1));
+
+	a->bits[bit / 8] ^= 1 << (bit % 8);
+	return (a->bits[bit / 8] >> (bit % 8)) & 1;
+}
+
+/** @brief Put a block on a free list */
+static void buddy_push(struct lmm_buddy *b, vm_offset_t block, int order,
+		       struct buddy_arena *a)
+{
+	struct buddy_block *blk = (struct buddy_block*)block;
+
+	blk->arena = a;
+	blk->prev = 0;
+	blk->next = b->free[order];
+	if (blk->next)
+		blk->next->prev = blk;
+	b->free[order] = blk;
+}
+
+/** @brief Take a block off a free list */
+static void buddy_unlink(struct lmm_buddy *b, struct buddy_block *blk,
+			 int order)
+{
+	if (blk->prev)
+		blk->prev->next = blk->next;
+	else
+		b->free[order] = blk->next;
+	if (blk->next)
+		blk->next->prev = blk->prev;
+}
+
+/** @brief Arena holding an address, 0 if none */
+static struct buddy_arena *buddy_arena_of(struct lmm_buddy *b,
+					  vm_offset_t addr)
+{
+	int lo = 0, hi = b->count, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (b->sorted[mid]->base > addr)
+			hi = mid;
+		else if (b->sorted[mid]->base + BUDDY_ARENA_SIZE <= addr)
+			lo = mid + 1;
+		else
+			return b->sorted[mid];
+	}
+	return 0;
+}
+
+/** @brief Carve a new arena with the given flags out of the lmm
+ *
+ *  @return The arena, its one block on the top free list, or 0
+ */
+static struct buddy_arena *buddy_grow(lmm_t *lmm, struct lmm_buddy *b,
+				      lmm_flags_t flags)
+{
+	struct lmm_region *reg;
+	struct buddy_arena *a;
+	vm_offset_t base;
+	int i;
+
+	if (b->count == BUDDY_MAX_ARENAS)
+		return 0;
+	base = (vm_offset_t)lmm_alloc_gen(lmm, BUDDY_ARENA_SIZE, flags,
+					  BUDDY_ARENA_SHIFT, 0,
+					  (vm_offset_t)0, (vm_size_t)-1);
+	if (!base)
+		return 0;
+
+	for (a = b->arenas; a->used; a++)
+		;
+	a->used = 1;
+	a->base = base;
+	a->free = BUDDY_ARENA_SIZE;
+	a->flags = flags;
+	for (reg = lmm->regions; reg; reg = reg->next)
+		if (base >= reg->min && base < reg->max)
+			a->flags = reg->flags;
+	memset(a->bits, 0, sizeof(a->bits));
+
+	for (i = b->count; i > 0 && b->sorted[i - 1]->base > base; i--)
+		b->sorted[i] = b->sorted[i - 1];
+	b->sorted[i] = a;
+	b->count++;
+
+	buddy_push(b, base, BUDDY_MAX_ORDER, a);
+	return a;
+}
+
+/** @brief Give an entirely free arena back to the lmm */
+static void buddy_release(lmm_t *lmm, struct lmm_buddy *b,
+			  struct buddy_arena *a)
+{
+	int i;
+
+	for (i = 0; b->sorted[i] != a; i++)
+		;
+	for (b->count--; i < b->count; i++)
+		b->sorted[i] = b->sorted[i + 1];
+	a->used = 0;
+
+	/* No longer an arena, so this goes to the lmm's free lists */
+	lmm_free(lmm, (void*)a->base, BUDDY_ARENA_SIZE);
+}
+
+int lmm_buddy_order(vm_size_t size, int align_bits, vm_offset_t align_ofs)
+{
+	int order;
+
+	if (align_ofs != 0 || align_bits < PAGE_SHIFT ||
+	    size < PAGE_SIZE || size > BUDDY_ARENA_SIZE ||
+	    (size & (size - 1)) != 0)
+		return -1;
+
+	order = __builtin_ctzl(size) - PAGE_SHIFT;
+	if (align_bits > order + PAGE_SHIFT)
+		return -1;
+	return order;
+}
+
+void *lmm_buddy_alloc(lmm_t *lmm, int order, lmm_flags_t flags)
+{
+	struct lmm_buddy *b = lmm->buddy;
+	struct buddy_block *blk;
+	struct buddy_arena *a;
+	int k;
+
+	if (!b)
+	{
+		if (!(b = lmm_alloc(lmm, sizeof(*b), 0)))
+			return 0;
+		memset(b, 0, sizeof(*b));
+		lmm->buddy = b;
+	}
+
+	for (k = order; k <= BUDDY_MAX_ORDER; k++)
+		for (blk = b->free[k]; blk; blk = blk->next)
+			if (!(flags & ~blk->arena->flags))
+				goto found;
+
+	if (!(a = buddy_grow(lmm, b, flags)))
+		return 0;
+	blk = (struct buddy_block*)a->base;
+	k = BUDDY_MAX_ORDER;
+
+found:
+	a = blk->arena;
+	buddy_unlink(b, blk, k);
+	if (k < BUDDY_MAX_ORDER)
+		buddy_flip(a, k, (vm_offset_t)blk);
+	while (k > order)
+	{
+		k--;
+		buddy_push(b, (vm_offset_t)blk + (PAGE_SIZE << k), k, a);
+		buddy_flip(a, k, (vm_offset_t)blk);
+	}
+
+	a->free -= PAGE_SIZE << order;
+	return blk;
+}
+
+int lmm_buddy_free(lmm_t *lmm, void *block, vm_size_t size)
+{
+	struct lmm_buddy *b = lmm->buddy;
+	vm_offset_t blk = (vm_offset_t)block, buddy;
+	struct buddy_arena *a;
+	int k;
+
+	if (!b || !(a = buddy_arena_of(b, blk)))
+		return 0;
+
+	k = lmm_buddy_order(size, PAGE_SHIFT, 0);
+	assert(k >= 0);
+	assert((blk & (size - 1)) == 0);
+	a->free += size;
+
+	for (; k < BUDDY_MAX_ORDER; k++)
+	{
+		if (buddy_flip(a, k, blk))
+			break;
+		/* The buddy is free too: merge */
+		buddy = a->base + ((blk - a->base) ^ (PAGE_SIZE << k));
+		buddy_unlink(b, (struct buddy_block*)buddy, k);
+		if (buddy < blk)
+			blk = buddy;
+	}
+
+	if (k == BUDDY_MAX_ORDER)
+		buddy_release(lmm, b, a);
+	else
+		buddy_push(b, blk, k, a);
+	return 1;
+}
+
+int lmm_buddy_owns(lmm_t *lmm, void *block)
+{
+	return lmm->buddy && buddy_arena_of(lmm->buddy, (vm_offset_t)block);
+}
+
+vm_size_t lmm_buddy_avail(lmm_t *lmm, lmm_flags_t flags)
+{
+	struct lmm_buddy *b = lmm->buddy;
+	vm_size_t count = 0;
+	int i;
+
+	for (i = 0; b && i < b->count; i++)
+		if (!(flags & ~b->sorted[i]->flags))
+			count += b->sorted[i]->free;
+	return count;
+}
+
+vm_size_t lmm_buddy_largest(lmm_t *lmm, lmm_flags_t flags)
+{
+	struct lmm_buddy *b = lmm->buddy;
+	struct buddy_block *blk;
+	int k;
+
+	for (k = BUDDY_MAX_ORDER; b && k >= 0; k--)
+		for (blk = b->free[k]; blk; blk = blk->next)
+			if (!(flags & ~blk->arena->flags))
+				return PAGE_SIZE << k;
+	return 0;
+}
@@ -0,0 +1,88 @@
+/** @file lmm/lmm_buddy.h
+ *  @brief Binary buddy allocator for naturally aligned page blocks
+ *
+ *  lmm_alloc_aligned() and lmm_alloc_page() hand requests for a power
+ *  of two number of pages, aligned to no more than their size, to the
+ *  buddy allocator first.  It carves BUDDY_ARENA_SIZE arenas out of the
+ *  lmm with lmm_alloc_gen(), each from the highest priority region
+ *  that has room and the flags asked for, and splits and merges blocks
+ *  inside them with a bitmap per arena.  lmm_free() gives blocks that
+ *  lie in an arena back to it.  An arena that is entirely free again
+ *  goes back to the lmm at once.  Arenas are kept small, so that a
+ *  single page does not hold on to much of a small lmm.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Requests the buddy allocator cannot serve (no arena fits, or
+ *  BUDDY_MAX_ARENAS are in use) fall back to lmm_alloc_gen()
+ */
+
+#ifndef _LMM_BUDDY_H_
+#define _LMM_BUDDY_H_
+
+#include <lmm/lmm.h>
+#include <x86/page.h>
+
+/** @brief Largest block, in pages, as a power of two: 256 KB */
+#define BUDDY_MAX_ORDER		6
+
+/** @brief log2 of the arena size */
+#define BUDDY_ARENA_SHIFT	(PAGE_SHIFT + BUDDY_MAX_ORDER)
+
+/** @brief Bytes of an arena */
+#define BUDDY_ARENA_SIZE	((vm_size_t)1 << BUDDY_ARENA_SHIFT)
+
+/** @brief Arenas an lmm can have at once */
+#define BUDDY_MAX_ARENAS	64
+
+/** @brief Order of a request the buddy allocator serves, -1 if none
+ *
+ *  @param size Bytes
+ *  @param align_bits Alignment asked for, as for lmm_alloc_aligned()
+ *  @param align_ofs Offset from that alignment
+ *  @return log2 of the size in pages, or -1
+ */
+int lmm_buddy_order(vm_size_t size, int align_bits, vm_offset_t align_ofs);
+
+/** @brief Allocate a block of 2^order pages
+ *
+ *  @param lmm Memory manager the arenas come from
+ *  @param order From lmm_buddy_order()
+ *  @param flags Region flags the block must have
+ *  @return The block, 0 if the buddy allocator cannot serve it
+ */
+void *lmm_buddy_alloc(lmm_t *lmm, int order, lmm_flags_t flags);
+
+/** @brief Free a block if it lies in an arena
+ *
+ *  @param lmm Memory manager
+ *  @param block Block
+ *  @param size Bytes, as passed to lmm_free()
+ *  @return 1 if the block was the buddy allocator's, 0 otherwise
+ */
+int lmm_buddy_free(lmm_t *lmm, void *block, vm_size_t size);
+
+/** @brief Whether a block lies in an arena
+ *
+ *  @param lmm Memory manager
+ *  @param block Block
+ *  @return 1 if it does, 0 otherwise
+ */
+int lmm_buddy_owns(lmm_t *lmm, void *block);
+
+/** @brief Bytes free in the arenas with the given flags
+ *
+ *  @param lmm Memory manager
+ *  @param flags As for lmm_avail()
+ *  @return Bytes
+ */
+vm_size_t lmm_buddy_avail(lmm_t *lmm, lmm_flags_t flags);
+
+/** @brief Largest block free in the arenas with the given flags
+ *
+ *  @param lmm Memory manager
+ *  @param flags As for lmm_avail()
+ *  @return Bytes, 0 if none
+ */
+vm_size_t lmm_buddy_largest(lmm_t *lmm, lmm_flags_t flags);
+
+#endif /* _LMM_BUDDY_H_ */
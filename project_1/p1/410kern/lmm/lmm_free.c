@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <lmm/lmm.h>
 #include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
 
 void lmm_free(lmm_t *lmm, void *block, vm_size_t size)
 {
@@ -34,6 +35,9 @@ void lmm_free(lmm_t *lmm, void *block, vm_size_t size)
 	assert(block != 0);
 	assert(size > 0);
 
+	if (lmm_buddy_free(lmm, block, size))
+		return;
+
 	size = (((vm_offset_t)block & ALIGN_MASK) + size + ALIGN_MASK)
 		& ~ALIGN_MASK;
 
@@ -21,9 +21,10 @@
 
 #include <lmm/lmm.h>
 #include <lmm/lmm_types.h>
+#include <x86/page.h>
 
 void lmm_free_page(lmm_t *lmm, void *page)
 {
-	return lmm_free(lmm, page, PAGE_SIZE);
+	lmm_free(lmm, page, PAGE_SIZE);
 }
 
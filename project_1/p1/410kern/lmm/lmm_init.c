@@ -25,5 +25,6 @@
 void lmm_init(lmm_t *lmm)
 {
 	lmm->regions = 0;
+	lmm->buddy = 0;
 }
 
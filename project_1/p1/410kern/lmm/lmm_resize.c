@@ -0,0 +1,82 @@
+/** @file lmm/lmm_resize.c
+ *  @brief Grow or shrink an allocated block where it is
+ *
+ *  lmm_resize() changes the size of a block from lmm_alloc() and
+ *  friends without moving it.  Shrinking gives the tail back with
+ *  lmm_free(), which coalesces it with the free block that follows, if
+ *  any.  Growing takes the start of the free block that begins right
+ *  where the block ends, if it is big enough, so a block that keeps
+ *  growing into free space is never copied.
+ *
+ *  Blocks of the buddy allocator keep their size.  lmm_seg.c has its
+ *  own lmm_resize().
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Like the rest of lmm, not thread-safe
+ */
+
+#include <assert.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
+
+/** @brief Resize a block in place
+ *
+ *  @param lmm Memory manager it came from
+ *  @param block Block
+ *  @param size Bytes it was allocated with
+ *  @param new_size Bytes it should have
+ *  @return 1 if the block now has new_size bytes, 0 if it could not grow
+ *  and is unchanged
+ */
+int lmm_resize(lmm_t *lmm, void *block, vm_size_t size, vm_size_t new_size)
+{
+	vm_offset_t end = ((vm_offset_t)block + size + ALIGN_MASK) & ~ALIGN_MASK;
+	vm_offset_t new_end = ((vm_offset_t)block + new_size + ALIGN_MASK)
+			      & ~ALIGN_MASK;
+	struct lmm_region *reg;
+	struct lmm_node *prevnode, *node, *rest;
+
+	assert(lmm != 0);
+	assert(block != 0);
+	assert(new_size > 0);
+
+	if (lmm_buddy_owns(lmm, block))
+		return 0;
+	if (new_end < end)
+		lmm_free(lmm, (void*)new_end, end - new_end);
+	if (new_end <= end)
+		return 1;
+
+	for (reg = lmm->regions; ; reg = reg->next)
+	{
+		assert(reg != 0);
+		if (((vm_offset_t)block >= reg->min)
+		    && ((vm_offset_t)block < reg->max))
+			break;
+	}
+
+	/* Find the free node that starts where the block ends.  */
+	for (prevnode = 0, node = reg->nodes;
+	     (node != 0) && ((vm_offset_t)node < end);
+	     prevnode = node, node = node->next);
+	if (((vm_offset_t)node != end) || (node->size < new_end - end))
+		return 0;
+
+	/* Take the start of it, leaving the rest in its place.  */
+	if (node->size == new_end - end)
+		rest = node->next;
+	else
+	{
+		rest = (struct lmm_node*)new_end;
+		rest->next = node->next;
+		rest->size = node->size - (new_end - end);
+	}
+	if (prevnode)
+		prevnode->next = rest;
+	else
+		reg->nodes = rest;
+
+	reg->free -= new_end - end;
+	return 1;
+}
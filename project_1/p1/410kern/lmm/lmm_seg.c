@@ -0,0 +1,609 @@
+/** @file lmm/lmm_seg.c
+ *  @brief Size-indexed variant of the list memory manager
+ *
+ *  Same interface and region semantics (flags, priorities, address
+ *  bounds) as the list version, built instead of lmm_alloc.c,
+ *  lmm_alloc_gen.c, lmm_free.c, lmm_resize.c, lmm_find_free.c,
+ *  lmm_avail.c, lmm_add_region.c and lmm_dump.c when config.mk sets
+ *  LMM_VARIANT = segregated.  The list version walks one address
+ *  ordered list per region on every allocation and every free.
+ *
+ *  Here each free block is on two structures of its region:
+ *
+ *  -- A bin per power of two of its size, with a bitmap of the bins
+ *  that are not empty.  An allocation looks at a few blocks of its own
+ *  bin (they may be too small), then takes the first block of the next
+ *  non-empty bin, which is always big enough unless alignment or
+ *  bounds get in the way.
+ *  -- A treap ordered by address, whose priorities are a hash of the
+ *  address, so it needs no field for them.  lmm_free() finds the
+ *  neighbours of the freed block there to coalesce, and bounded
+ *  allocations and lmm_find_free() walk it in address order.
+ *
+ *  A block is allocated from the top of the free block it comes from,
+ *  so the rest keeps its address and stays where it is in the treap:
+ *  most allocations only move it to another bin.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Like the list version, not thread-safe
+ */
+
+#include <assert.h>
+#include <stdio/stdio.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
+
+/** @brief Blocks of its own bin an allocation tries before larger bins */
+#define LMM_BIN_SCAN	8
+
+/** @brief Bin of a block size, floor(log2(size)) */
+static unsigned int seg_bin(vm_size_t size)
+{
+	return LMM_BINS - 1 - __builtin_clzl(size);
+}
+
+/** @brief Fibonacci hashing multiplier, 2^bits / golden ratio.  It has to
+    wrap around a word, or priorities rise with the address and the
+    treap turns into a list.  */
+#define SEG_HASH	((unsigned long)(sizeof(long) == 4 ? \
+				2654435761UL : 0x9E3779B97F4A7C15ULL))
+
+/** @brief Treap priority of a node, a hash of its address */
+static unsigned long seg_prio(struct lmm_node *node)
+{
+	return ((vm_offset_t)node >> ALIGN_SHIFT) * SEG_HASH;
+}
+
+/** @brief Join two treaps, every node of l below every node of r */
+static struct lmm_node *seg_merge(struct lmm_node *l, struct lmm_node *r)
+{
+	if (!l)
+		return r;
+	if (!r)
+		return l;
+	if (seg_prio(l) > seg_prio(r))
+	{
+		l->right = seg_merge(l->right, r);
+		return l;
+	}
+	r->left = seg_merge(l, r->left);
+	return r;
+}
+
+/** @brief Split a treap into the nodes below key and the rest */
+static void seg_split(struct lmm_node *t, struct lmm_node *key,
+		      struct lmm_node **l, struct lmm_node **r)
+{
+	if (!t)
+	{
+		*l = *r = 0;
+		return;
+	}
+	if (t < key)
+	{
+		*l = t;
+		seg_split(t->right, key, &t->right, r);
+	}
+	else
+	{
+		*r = t;
+		seg_split(t->left, key, l, &t->left);
+	}
+}
+
+/** @brief Add a node to a region's treap */
+static void seg_tree_insert(struct lmm_region *reg, struct lmm_node *node)
+{
+	struct lmm_node **tp = &reg->tree;
+	unsigned long prio = seg_prio(node);
+
+	while (*tp && seg_prio(*tp) >= prio)
+		tp = node < *tp ? &(*tp)->left : &(*tp)->right;
+	seg_split(*tp, node, &node->left, &node->right);
+	*tp = node;
+}
+
+/** @brief Take a node out of a region's treap */
+static void seg_tree_remove(struct lmm_region *reg, struct lmm_node *node)
+{
+	struct lmm_node **tp = &reg->tree;
+
+	while (*tp != node)
+	{
+		assert(*tp != 0);
+		tp = node < *tp ? &(*tp)->left : &(*tp)->right;
+	}
+	*tp = seg_merge(node->left, node->right);
+}
+
+/** @brief Highest free block starting below addr */
+static struct lmm_node *seg_tree_below(struct lmm_region *reg,
+				       vm_offset_t addr)
+{
+	struct lmm_node *t = reg->tree, *best = 0;
+
+	while (t)
+	{
+		if ((vm_offset_t)t < addr)
+		{
+			best = t;
+			t = t->right;
+		}
+		else
+			t = t->left;
+	}
+	return best;
+}
+
+/** @brief Lowest free block ending above addr */
+static struct lmm_node *seg_tree_after(struct lmm_region *reg,
+				       vm_offset_t addr)
+{
+	struct lmm_node *t = reg->tree, *best = 0;
+
+	while (t)
+	{
+		if ((vm_offset_t)t + t->size > addr)
+		{
+			best = t;
+			t = t->left;
+		}
+		else
+			t = t->right;
+	}
+	return best;
+}
+
+/** @brief Put a node on the bin of its size */
+static void seg_bin_add(struct lmm_region *reg, struct lmm_node *node)
+{
+	unsigned int bin = seg_bin(node->size);
+
+	node->prev = 0;
+	node->next = reg->bins[bin];
+	if (node->next)
+		node->next->prev = node;
+	reg->bins[bin] = node;
+	reg->binmap |= 1UL << bin;
+}
+
+/** @brief Take a node off the bin of its size */
+static void seg_bin_remove(struct lmm_region *reg, struct lmm_node *node)
+{
+	unsigned int bin = seg_bin(node->size);
+
+	if (node->prev)
+		node->prev->next = node->next;
+	else if (!(reg->bins[bin] = node->next))
+		reg->binmap &= ~(1UL << bin);
+	if (node->next)
+		node->next->prev = node->prev;
+}
+
+/** @brief Where a block would go in a free block, as high as it fits
+ *
+ *  @param addr Set to the address of the block if it fits
+ *  @return Whether it fits
+ */
+static int seg_fit(struct lmm_node *node, vm_size_t size,
+		   vm_offset_t align_mask, vm_offset_t align_ofs,
+		   vm_offset_t in_min, vm_offset_t in_max, vm_offset_t *addr)
+{
+	vm_offset_t lo = (vm_offset_t)node;
+	vm_offset_t hi = lo + node->size;
+
+	if (lo < in_min)
+		lo = in_min;
+	if (hi > in_max)
+		hi = in_max;
+	if (hi < lo || hi - lo < size)
+		return 0;
+	*addr = hi - size;
+	*addr -= (*addr - align_ofs) & align_mask;
+	return *addr >= lo;
+}
+
+/** @brief Find a free block for an allocation the region holds entirely
+ *
+ *  @return The free block, 0 if none fits
+ */
+static struct lmm_node *seg_find_any(struct lmm_region *reg, vm_size_t size,
+				     vm_offset_t align_mask,
+				     vm_offset_t align_ofs, vm_offset_t in_min,
+				     vm_offset_t in_max, vm_offset_t *addr)
+{
+	unsigned int bin = seg_bin(size);
+	unsigned long map;
+	struct lmm_node *node;
+	int i;
+
+	/* A few blocks of its own bin, which may be too small.  */
+	for (node = reg->bins[bin], i = 0;
+	     node && i < LMM_BIN_SCAN;
+	     node = node->next, i++)
+		if (seg_fit(node, size, align_mask, align_ofs,
+			    in_min, in_max, addr))
+			return node;
+
+	/* Blocks of the bins above are big enough, unless aligning
+	   moves the block down past their start.  */
+	map = reg->binmap & ~((2UL << bin) - 1);
+	while (map)
+	{
+		struct lmm_node *n;
+
+		for (n = reg->bins[__builtin_ctzl(map)]; n; n = n->next)
+			if (seg_fit(n, size, align_mask, align_ofs,
+				    in_min, in_max, addr))
+				return n;
+		map &= map - 1;
+	}
+
+	/* Last, the rest of its own bin.  */
+	for (; node; node = node->next)
+		if (seg_fit(node, size, align_mask, align_ofs,
+			    in_min, in_max, addr))
+			return node;
+	return 0;
+}
+
+/** @brief Find a free block for an allocation bounded inside the region
+ *
+ *  @return The lowest free block it fits in, 0 if none
+ */
+static struct lmm_node *seg_find_range(struct lmm_region *reg,
+				       vm_size_t size, vm_offset_t align_mask,
+				       vm_offset_t align_ofs,
+				       vm_offset_t in_min, vm_offset_t in_max,
+				       vm_offset_t *addr)
+{
+	struct lmm_node *node;
+
+	for (node = seg_tree_after(reg, in_min);
+	     node && (vm_offset_t)node < in_max;
+	     node = seg_tree_after(reg, (vm_offset_t)node + node->size))
+		if (seg_fit(node, size, align_mask, align_ofs,
+			    in_min, in_max, addr))
+			return node;
+	return 0;
+}
+
+/** @brief Allocate addr to addr + size from a free block */
+static void seg_carve(struct lmm_region *reg, struct lmm_node *node,
+		      vm_offset_t addr, vm_size_t size)
+{
+	vm_offset_t start = addr & ~ALIGN_MASK;
+	vm_offset_t end = (addr + size + ALIGN_MASK) & ~ALIGN_MASK;
+	vm_offset_t node_end = (vm_offset_t)node + node->size;
+
+	assert(start >= (vm_offset_t)node);
+	assert(end <= node_end);
+
+	seg_bin_remove(reg, node);
+	if (end < node_end)
+	{
+		struct lmm_node *tail = (struct lmm_node*)end;
+
+		tail->size = node_end - end;
+		seg_tree_insert(reg, tail);
+		seg_bin_add(reg, tail);
+	}
+	if (start > (vm_offset_t)node)
+	{
+		node->size = start - (vm_offset_t)node;
+		seg_bin_add(reg, node);
+	}
+	else
+		seg_tree_remove(reg, node);
+
+	assert(reg->free >= end - start);
+	reg->free -= end - start;
+}
+
+void lmm_add_region(lmm_t *lmm, lmm_region_t *reg,
+		    void *addr, vm_size_t size,
+		    lmm_flags_t flags, lmm_pri_t pri)
+{
+	vm_offset_t min = (vm_offset_t)addr;
+	vm_offset_t max = min + size;
+	struct lmm_region **rp, *r;
+	unsigned int i;
+
+	/* Align the start and end addresses appropriately.  */
+	min = (min + ALIGN_MASK) & ~ALIGN_MASK;
+	max &= ~ALIGN_MASK;
+
+	/* Too small to hold anything; drop it on the floor.  */
+	if (max <= min)
+		return;
+
+	reg->tree = 0;
+	for (i = 0; i < LMM_BINS; i++)
+		reg->bins[i] = 0;
+	reg->binmap = 0;
+	reg->min = min;
+	reg->max = max;
+	reg->flags = flags;
+	reg->pri = pri;
+	reg->free = 0;
+
+	/* Descending priority order, larger regions first within one.  */
+	for (rp = &lmm->regions;
+	     (r = *rp) && ((r->pri > pri) ||
+			   ((r->pri == pri) &&
+			    (r->max - r->min > reg->max - reg->min)));
+	     rp = &r->next)
+	{
+		assert(r != reg);
+		assert((reg->max <= r->min) || (reg->min >= r->max));
+	}
+	reg->next = r;
+	*rp = reg;
+}
+
+void *lmm_alloc_gen(lmm_t *lmm, vm_size_t size, unsigned flags,
+		    int align_bits, vm_offset_t align_ofs,
+		    vm_offset_t in_min, vm_size_t in_size)
+{
+	vm_offset_t in_max = in_min + in_size;
+	vm_offset_t align_mask;
+	struct lmm_region *reg;
+
+	assert(lmm != 0);
+	assert(size > 0);
+
+	if (in_max < in_min)
+		in_max = (vm_offset_t)-1;
+
+	/* Blocks are aligned to ALIGN_SIZE anyway; an offset within a
+	   finer alignment is kept within ALIGN_SIZE, as the list version
+	   does when it starts from an aligned node.  */
+	if (align_bits < ALIGN_SHIFT)
+	{
+		align_ofs &= ((vm_offset_t)1 << align_bits) - 1;
+		align_bits = ALIGN_SHIFT;
+	}
+	align_mask = ((vm_offset_t)1 << align_bits) - 1;
+
+	for (reg = lmm->regions; reg; reg = reg->next)
+	{
+		struct lmm_node *node;
+		vm_offset_t addr;
+
+		assert(reg->free <= reg->max - reg->min);
+
+		if ((flags & ~reg->flags)
+		    || (reg->min >= in_max)
+		    || (reg->max <= in_min))
+			continue;
+
+		if (in_min <= reg->min && in_max >= reg->max)
+			node = seg_find_any(reg, size, align_mask, align_ofs,
+					    in_min, in_max, &addr);
+		else
+			node = seg_find_range(reg, size, align_mask, align_ofs,
+					      in_min, in_max, &addr);
+		if (node)
+		{
+			seg_carve(reg, node, addr, size);
+			return (void*)addr;
+		}
+	}
+
+	return 0;
+}
+
+void *lmm_alloc(lmm_t *lmm, vm_size_t size, lmm_flags_t flags)
+{
+	return lmm_alloc_gen(lmm, size, flags, 0, 0,
+			     (vm_offset_t)0, (vm_size_t)-1);
+}
+
+void lmm_free(lmm_t *lmm, void *block, vm_size_t size)
+{
+	struct lmm_region *reg;
+	struct lmm_node *node = (struct lmm_node*)
+				((vm_offset_t)block & ~ALIGN_MASK);
+	struct lmm_node *prev, *next;
+
+	assert(lmm != 0);
+	assert(block != 0);
+	assert(size > 0);
+
+	if (lmm_buddy_free(lmm, block, size))
+		return;
+
+	size = (((vm_offset_t)block & ALIGN_MASK) + size + ALIGN_MASK)
+		& ~ALIGN_MASK;
+
+	for (reg = lmm->regions; ; reg = reg->next)
+	{
+		assert(reg != 0);
+		if (((vm_offset_t)node >= reg->min)
+		    && ((vm_offset_t)node < reg->max))
+			break;
+	}
+
+	reg->free += size;
+	assert(reg->free <= reg->max - reg->min);
+
+	prev = seg_tree_below(reg, (vm_offset_t)node);
+	next = seg_tree_after(reg, (vm_offset_t)node);
+	assert(!prev || (vm_offset_t)prev + prev->size <= (vm_offset_t)node);
+	assert(!next || (vm_offset_t)next >= (vm_offset_t)node + size);
+
+	/* Coalesce with the block above, then the one below.  */
+	if (next && (vm_offset_t)node + size == (vm_offset_t)next)
+	{
+		seg_bin_remove(reg, next);
+		seg_tree_remove(reg, next);
+		size += next->size;
+	}
+	if (prev && (vm_offset_t)prev + prev->size == (vm_offset_t)node)
+	{
+		seg_bin_remove(reg, prev);
+		prev->size += size;
+		seg_bin_add(reg, prev);
+	}
+	else
+	{
+		node->size = size;
+		seg_tree_insert(reg, node);
+		seg_bin_add(reg, node);
+	}
+}
+
+int lmm_resize(lmm_t *lmm, void *block, vm_size_t size, vm_size_t new_size)
+{
+	vm_offset_t end = ((vm_offset_t)block + size + ALIGN_MASK) & ~ALIGN_MASK;
+	vm_offset_t new_end = ((vm_offset_t)block + new_size + ALIGN_MASK)
+			      & ~ALIGN_MASK;
+	struct lmm_region *reg;
+	struct lmm_node *next;
+
+	assert(lmm != 0);
+	assert(block != 0);
+	assert(new_size > 0);
+
+	if (lmm_buddy_owns(lmm, block))
+		return 0;
+	if (new_end < end)
+		lmm_free(lmm, (void*)new_end, end - new_end);
+	if (new_end <= end)
+		return 1;
+
+	for (reg = lmm->regions; ; reg = reg->next)
+	{
+		assert(reg != 0);
+		if (((vm_offset_t)block >= reg->min)
+		    && ((vm_offset_t)block < reg->max))
+			break;
+	}
+
+	/* Grow into the free block that starts where this one ends.  */
+	next = seg_tree_after(reg, end);
+	if (!next || (vm_offset_t)next != end || next->size < new_end - end)
+		return 0;
+	seg_carve(reg, next, end, new_end - end);
+	return 1;
+}
+
+void lmm_find_free(lmm_t *lmm, vm_offset_t *inout_addr,
+		   vm_size_t *out_size, lmm_flags_t *out_flags)
+{
+	struct lmm_region *reg;
+	vm_offset_t start_addr = (*inout_addr + ALIGN_MASK) & ~ALIGN_MASK;
+	vm_offset_t lowest_addr = (vm_offset_t)-1;
+	vm_size_t lowest_size = 0;
+	unsigned lowest_flags = 0;
+
+	for (reg = lmm->regions; reg; reg = reg->next)
+	{
+		struct lmm_node *node;
+
+		if ((reg->tree == 0)
+		    || (reg->max <= start_addr)
+		    || (reg->min > lowest_addr))
+			continue;
+
+		node = seg_tree_after(reg, start_addr);
+		if (!node || (vm_offset_t)node >= lowest_addr)
+			continue;
+		if ((vm_offset_t)node > start_addr)
+		{
+			lowest_addr = (vm_offset_t)node;
+			lowest_size = node->size;
+		}
+		else
+		{
+			lowest_addr = start_addr;
+			lowest_size = node->size
+				- (lowest_addr - (vm_offset_t)node);
+		}
+		lowest_flags = reg->flags;
+	}
+
+	*inout_addr = lowest_addr;
+	*out_size = lowest_size;
+	*out_flags = lowest_flags;
+}
+
+vm_size_t lmm_avail(lmm_t *lmm, lmm_flags_t flags)
+{
+	struct lmm_region *reg;
+	vm_size_t count = 0;
+
+	for (reg = lmm->regions; reg; reg = reg->next)
+	{
+		assert(reg->free <= reg->max - reg->min);
+
+		/* Don't count inapplicable regions.  */
+		if (flags & ~reg->flags)
+			continue;
+
+		count += reg->free;
+	}
+
+	/* Free pages of buddy arenas are allocated as far as lmm knows.  */
+	return count + lmm_buddy_avail(lmm, flags);
+}
+
+/** @brief Print and check a treap in address order
+ *
+ *  @return Bytes free in it
+ */
+static vm_size_t seg_dump_tree(struct lmm_region *reg, struct lmm_node *t,
+			       struct lmm_node **last)
+{
+	vm_size_t free = 0;
+	struct lmm_node *n;
+
+	if (!t)
+		return 0;
+	assert(!t->left || seg_prio(t->left) <= seg_prio(t));
+	assert(!t->right || seg_prio(t->right) <= seg_prio(t));
+	free += seg_dump_tree(reg, t->left, last);
+
+	printf("  node %p-%08lx size=%08lx bin=%u\n",
+	       t, (vm_offset_t)t + t->size, t->size, seg_bin(t->size));
+	assert(((vm_offset_t)t & ALIGN_MASK) == 0);
+	assert((t->size & ALIGN_MASK) == 0);
+	assert((vm_offset_t)t >= reg->min);
+	assert((vm_offset_t)t + t->size <= reg->max);
+	/* Free blocks are coalesced, so they never touch.  */
+	assert(!*last || (vm_offset_t)*last + (*last)->size < (vm_offset_t)t);
+	for (n = reg->bins[seg_bin(t->size)]; n != t; n = n->next)
+		assert(n != 0);
+	*last = t;
+
+	return free + t->size + seg_dump_tree(reg, t->right, last);
+}
+
+void lmm_dump(lmm_t *lmm)
+{
+	struct lmm_region *reg;
+
+	printf("lmm_dump(lmm=%p)\n", lmm);
+
+	for (reg = lmm->regions; reg; reg = reg->next)
+	{
+		struct lmm_node *last = 0;
+		vm_size_t free_check;
+		unsigned int i;
+
+		printf(" region %08lx-%08lx size=%08lx flags=%08x pri=%d "
+		       "free=%08lx binmap=%08lx\n",
+		       reg->min, reg->max, reg->max - reg->min,
+		       reg->flags, reg->pri, reg->free, reg->binmap);
+
+		for (i = 0; i < LMM_BINS; i++)
+			assert(!(reg->binmap & (1UL << i)) == !reg->bins[i]);
+
+		free_check = seg_dump_tree(reg, reg->tree, &last);
+		printf(" free_check=%08lx\n", free_check);
+		assert(reg->free == free_check);
+	}
+
+	printf("lmm_dump done\n");
+}
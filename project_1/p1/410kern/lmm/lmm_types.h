@@ -24,6 +24,55 @@
 #ifndef _LMM_TYPES_H_
 #define _LMM_TYPES_H_
 
+#ifdef LMM_SEGREGATED
+
+/* Size-indexed variant (lmm_seg.c), selected with LMM_VARIANT in
+   config.mk.  Each region keeps its free blocks twice: on a list per
+   power-of-two size bin, with a bitmap of the bins that are not empty,
+   and in a treap ordered by address for finding the neighbours of a
+   freed block.  A free block holds its node, so blocks are multiples
+   of a larger ALIGN_SIZE than in the list version.  */
+
+#define LMM_BINS	(sizeof(unsigned long) * 8)
+
+struct lmm_region
+{
+	struct lmm_region *next;
+
+	/* Free blocks by address, and by size (bins[i] holds sizes
+	   from 2^i to 2^(i+1) - 1, binmap bit i is set if it has any).  */
+	struct lmm_node *tree;
+	struct lmm_node *bins[LMM_BINS];
+	unsigned long binmap;
+
+	vm_offset_t min;
+	vm_offset_t max;
+	lmm_flags_t flags;
+	lmm_pri_t pri;
+	vm_size_t free;
+};
+
+struct lmm_node
+{
+	/* Treap children, lower and higher addresses.  */
+	struct lmm_node *left;
+	struct lmm_node *right;
+
+	/* Other blocks of the same bin.  */
+	struct lmm_node *next;
+	struct lmm_node *prev;
+
+	vm_size_t size;
+};
+
+/* The smallest power of two that holds a node: 32 bytes with 32-bit
+   pointers, 64 on a 64-bit host.  */
+#define ALIGN_SHIFT	(sizeof(void *) == 4 ? 5 : 6)
+#define ALIGN_SIZE	((vm_size_t)1 << ALIGN_SHIFT)
+#define ALIGN_MASK	(ALIGN_SIZE - 1)
+
+#else /* !LMM_SEGREGATED */
+
 /* The contents of these structures are opaque to users.  */
 struct lmm_region
 {
@@ -55,4 +104,6 @@ struct lmm_node
 #define ALIGN_SIZE	sizeof(struct lmm_node)
 #define ALIGN_MASK	(ALIGN_SIZE - 1)
 
+#endif /* LMM_SEGREGATED */
+
 #endif /*  _LMM_TYPES_H_ */
@@ -0,0 +1,169 @@
+/** @file malloc/arena.c
+ *  @brief Bump-pointer arenas on malloc_lmm pages
+ *
+ *  An arena is a chain of blocks, each one page or, for a request that
+ *  does not fit in a page, as many whole pages as it takes.  A block
+ *  starts with its link and size, and arena_alloc() bumps through the
+ *  rest.  When the current block is full it moves on to the first block
+ *  further down the chain that is big enough, otherwise it links a new
+ *  block in after the current one.  arena_reset() only points the
+ *  cursor back at the first block.
+ *
+ *  With MALLOC_DEBUG every arena_alloc() is a block of its own from
+ *  _memalign(), so that it gets the red zone and canary of the debug
+ *  heap and malloc_debug_audit() checks it; arena_reset() frees them.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug See arena.h
+ */
+
+#include <stddef.h>
+#include <lmm/lmm.h>
+#include <x86/page.h>
+#include "malloc_internal.h"
+#include "arena.h"
+
+/** @brief Header of a block of pages */
+struct arena_block
+{
+	/** @brief Next block in the chain */
+	struct arena_block *next;
+	/** @brief Bytes of the block, header included */
+	size_t size;
+};
+
+/** @brief Bytes a block keeps for its header */
+#define ARENA_HEADER \
+	((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+void arena_create(arena_t *arena)
+{
+	arena->blocks = NULL;
+	arena->cur = NULL;
+	arena->next = NULL;
+	arena->end = NULL;
+}
+
+#ifdef MALLOC_DEBUG
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+	struct arena_block *b;
+
+	/* Not rounded up, so that the red zone starts right after */
+	if (!(b = _memalign(ARENA_ALIGN, ARENA_HEADER + size)))
+		return NULL;
+	b->size = ARENA_HEADER + size;
+	b->next = arena->blocks;
+	arena->blocks = b;
+	return (char *)b + ARENA_HEADER;
+}
+
+void arena_reset(arena_t *arena)
+{
+	struct arena_block *b, *next;
+
+	for (b = arena->blocks; b; b = next)
+	{
+		next = b->next;
+		_free(b);
+	}
+	arena->blocks = NULL;
+}
+
+void arena_destroy(arena_t *arena)
+{
+	arena_reset(arena);
+}
+
+#else /* !MALLOC_DEBUG */
+
+/** @brief Make a block the one being bumped through */
+static void arena_enter(arena_t *arena, struct arena_block *b)
+{
+	arena->cur = b;
+	arena->next = (char *)b + ARENA_HEADER;
+	arena->end = (char *)b + b->size;
+}
+
+/** @brief Move to a block with room for size bytes
+ *
+ *  @param arena The arena
+ *  @param size Bytes, a multiple of ARENA_ALIGN
+ *  @return 0, -1 if malloc_lmm is out of pages
+ */
+static int arena_grow(arena_t *arena, size_t size)
+{
+	struct arena_block **link = arena->cur ? &arena->cur->next
+					       : &arena->blocks;
+	struct arena_block **l, *b;
+	size_t bsize;
+
+	/* A block further on that fits moves up, so the chain stays as
+	 * long as the most a round has needed */
+	for (l = link; *l; l = &(*l)->next)
+	{
+		if ((*l)->size - ARENA_HEADER < size)
+			continue;
+		b = *l;
+		*l = b->next;
+		b->next = *link;
+		*link = b;
+		arena_enter(arena, b);
+		return 0;
+	}
+
+	bsize = (ARENA_HEADER + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	_malloc_lock();
+	if (bsize == PAGE_SIZE)
+		b = lmm_alloc_page(&malloc_lmm, 0);
+	else
+		b = lmm_alloc_aligned(&malloc_lmm, bsize, 0, PAGE_SHIFT, 0);
+	_malloc_unlock();
+	if (!b)
+		return -1;
+
+	b->size = bsize;
+	b->next = *link;
+	*link = b;
+	arena_enter(arena, b);
+	return 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+	void *p;
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (size == 0)
+		size = ARENA_ALIGN;
+	if ((size_t)(arena->end - arena->next) < size &&
+	    arena_grow(arena, size) < 0)
+		return NULL;
+
+	p = arena->next;
+	arena->next += size;
+	return p;
+}
+
+void arena_reset(arena_t *arena)
+{
+	if (arena->blocks)
+		arena_enter(arena, arena->blocks);
+}
+
+void arena_destroy(arena_t *arena)
+{
+	struct arena_block *b, *next;
+
+	_malloc_lock();
+	for (b = arena->blocks; b; b = next)
+	{
+		next = b->next;
+		lmm_free(&malloc_lmm, b, b->size);
+	}
+	_malloc_unlock();
+	arena_create(arena);
+}
+
+#endif /* MALLOC_DEBUG */
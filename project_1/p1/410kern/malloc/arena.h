@@ -0,0 +1,66 @@
+/** @file malloc/arena.h
+ *  @brief Bump-pointer arenas on malloc_lmm pages
+ *
+ *  An arena hands out memory for allocations that all die together,
+ *  such as the board of one game or a scratch buffer.  There is no
+ *  size word and no per-object free: arena_alloc() moves a pointer
+ *  through pages taken from malloc_lmm with lmm_alloc_page(), and
+ *  arena_reset() frees everything at once by rewinding it.  The pages
+ *  are kept for the next round until arena_destroy().
+ *
+ *  An arena is not locked; a context that shares one with another has
+ *  to serialize them itself.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <types.h>
+
+/** @brief Alignment of every arena_alloc() */
+#define ARENA_ALIGN	8
+
+/** @brief Arena, empty when all zeroes */
+typedef struct arena {
+	/** @brief Blocks of pages, in the order they are bumped through */
+	struct arena_block *blocks;
+	/** @brief Block being bumped through */
+	struct arena_block *cur;
+	/** @brief Next free byte and end of cur */
+	char *next;
+	char *end;
+} arena_t;
+
+/** @brief Set up an empty arena, it takes no pages until the first alloc
+ *
+ *  @param arena The arena
+ *  @return void
+ */
+void arena_create(arena_t *arena);
+
+/** @brief Allocate from an arena
+ *
+ *  @param arena The arena
+ *  @param size Bytes, requests larger than a page get a block of their own
+ *  @return ARENA_ALIGN aligned memory, NULL if malloc_lmm is out of pages
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/** @brief Free everything allocated from an arena, keeping its pages
+ *
+ *  @param arena The arena
+ *  @return void
+ */
+void arena_reset(arena_t *arena);
+
+/** @brief Give all the pages of an arena back to malloc_lmm
+ *
+ *  @param arena The arena, empty afterwards
+ *  @return void
+ */
+void arena_destroy(arena_t *arena);
+
+#endif /* _ARENA_H_ */
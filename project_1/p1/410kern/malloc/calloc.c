@@ -22,18 +22,35 @@
 #include <assert.h>
 #include <stddef.h>
 #include <malloc/malloc_internal.h>
+#include <malloc/zero_pool.h>
 #include <string/string.h>
+#include <x86/page.h>
 
 void *
 _calloc(size_t nelt, size_t eltsize)
 {
 	size_t allocsize = nelt * eltsize;
+	size_t *chunk;
+	void *ptr;
 
-	void *ptr = _malloc(allocsize);
+	/* Too big for the size classes but within a page: a page the
+	 * idle loop already zeroed, only its size word to write */
+	if (allocsize + sizeof(size_t) + MALLOC_DEBUG_EXTRA > SLAB_MAX_CHUNK &&
+	    allocsize + sizeof(size_t) + MALLOC_DEBUG_EXTRA <= PAGE_SIZE)
+	{
+		if (!(chunk = zero_pool_page()))
+			return NULL;
+		*chunk = PAGE_SIZE;
+		_stats_alloc(chunk+1, allocsize + MALLOC_DEBUG_EXTRA,
+			     MALLOC_SITE());
+		return _debug_alloc(chunk+1, allocsize);
+	}
+
+	ptr = _malloc_at(allocsize, MALLOC_SITE());
 	if (!ptr)
 		return NULL;
 
-	memset(ptr, 0, allocsize);
+	bzero(ptr, allocsize);
 
 	return ptr;
 }
@@ -23,7 +23,22 @@
 
 void _free(void *chunk_ptr)
 {
-	size_t *chunk = (size_t*)chunk_ptr - 1;
-	lmm_free(&malloc_lmm, chunk, *chunk);
+	size_t *chunk;
+
+#ifdef MALLOC_DEBUG
+	/* Quarantined, and maybe an older chunk to free instead */
+	if (!(chunk_ptr = _debug_free(chunk_ptr)))
+		return;
+#endif
+	chunk = (size_t*)chunk_ptr - 1;
+	_stats_free(chunk_ptr);
+	if (*chunk & SLAB_CHUNK)
+		_mag_free(chunk);
+	else
+	{
+		_malloc_lock();
+		lmm_free(&malloc_lmm, chunk, *chunk);
+		_malloc_unlock();
+	}
 }
 
@@ -1,17 +1,33 @@
 410KLIB_MALLOC_OBJS:= \
+                        arena.o			\
                         calloc.o		\
                         free.o			\
+                        magazine.o		\
                         malloc.o		\
+                        malloc_debug.o	\
                         malloc_lmm.o	\
+                        malloc_stats.o	\
                         memalign.o		\
                         realloc.o		\
                         sfree.o			\
+                        slab.o			\
                         smalloc.o		\
-                        smemalign.o
+                        smemalign.o		\
+                        zero_pool.o
 
 
 410KLIB_MALLOC_OBJS:= $(410KLIB_MALLOC_OBJS:%=$(410KDIR)/malloc/%)
 
+# MALLOC_STATS = 1 (see config.mk) turns on the allocation accounting
+ifeq ($(MALLOC_STATS),1)
+$(410KLIB_MALLOC_OBJS): CFLAGS += -DMALLOC_STATS
+endif
+
+# MALLOC_DEBUG = 1 (see config.mk) turns on the debug heap
+ifeq ($(MALLOC_DEBUG),1)
+$(410KLIB_MALLOC_OBJS): CFLAGS += -DMALLOC_DEBUG
+endif
+
 ALL_410KOBJS += $(410KLIB_MALLOC_OBJS)
 410KCLEANS += $(410KDIR)/libmalloc.a
 
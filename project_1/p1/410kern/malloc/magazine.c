@@ -0,0 +1,209 @@
+/** @file malloc/magazine.c
+ *  @brief Per-context caches of slab chunks in front of the size classes
+ *
+ *  Once more than one context allocates (interrupt handlers, other
+ *  CPUs), the slab classes and malloc_lmm have to be serialized, and
+ *  taking one lock around every malloc and free serializes everything.
+ *  Instead each context has a magazine per size class: a stack of up to
+ *  MAG_SIZE free chunks that only it touches, so most mallocs and frees
+ *  take no lock at all.
+ *
+ *  -- A malloc pops its class's magazine.  An empty magazine is first
+ *  refilled from the chunks other contexts gave back, then with
+ *  MAG_BATCH chunks from the slab class under the malloc lock.
+ *  -- A free of a chunk the context allocated pushes it on the
+ *  magazine.  A full magazine first gives MAG_BATCH chunks back to the
+ *  slab class under the malloc lock.
+ *  -- A free of a chunk another context allocated (its owner is in the
+ *  size word) pushes it on the owner's return list with a compare and
+ *  swap.  Any number of contexts push; only the owner takes the list,
+ *  all of it at once with an atomic exchange, when one of its
+ *  magazines runs empty.  There is no pop of single entries, so there
+ *  is no ABA problem.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Chunks on a return list wait there until their owner allocates
+ *  from an empty magazine
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include "malloc_internal.h"
+
+/** @brief Chunks a magazine holds */
+#define MAG_SIZE	32
+
+/** @brief Chunks moved between a magazine and its slab class at once */
+#define MAG_BATCH	(MAG_SIZE / 2)
+
+/** @brief Free chunks of one class, at their size word */
+struct magazine
+{
+	unsigned int count;
+	size_t *chunks[MAG_SIZE];
+};
+
+/** @brief Everything a context owns */
+struct mag_context
+{
+	struct magazine mags[SLAB_CLASSES];
+	/** @brief Chunks other contexts freed, linked through the word
+	    after their size word */
+	size_t *volatile remote;
+};
+
+static struct mag_context mag_contexts[MALLOC_CONTEXTS];
+
+/** @brief Hooks from malloc_set_contexts() */
+static int (*mag_context)(void);
+static void (*mag_lock)(void);
+static void (*mag_unlock)(void);
+
+/** @brief Install the context and lock hooks
+ *
+ *  Has to run before a second context allocates.
+ *
+ *  @param context Returns the caller's context, below MALLOC_CONTEXTS
+ *  @param lock Takes the malloc lock
+ *  @param unlock Releases it
+ *  @return void
+ */
+void malloc_set_contexts(int (*context)(void), void (*lock)(void),
+			 void (*unlock)(void))
+{
+	mag_context = context;
+	mag_lock = lock;
+	mag_unlock = unlock;
+}
+
+/** @brief Take the malloc lock, if there is one */
+void _malloc_lock(void)
+{
+	if (mag_lock)
+		mag_lock();
+}
+
+/** @brief Release the malloc lock, if there is one */
+void _malloc_unlock(void)
+{
+	if (mag_unlock)
+		mag_unlock();
+}
+
+/** @brief Context of the caller */
+static int mag_self(void)
+{
+	int ctx = mag_context ? mag_context() : 0;
+
+	assert(ctx >= 0 && ctx < MALLOC_CONTEXTS);
+	return ctx;
+}
+
+/** @brief Give the oldest MAG_BATCH chunks of a full magazine back */
+static void mag_flush(struct magazine *m, unsigned int class)
+{
+	unsigned int i;
+
+	_malloc_lock();
+	for (i = 0; i < MAG_BATCH; i++)
+		_slab_free(m->chunks[i], class);
+	_malloc_unlock();
+
+	for (i = MAG_BATCH; i < MAG_SIZE; i++)
+		m->chunks[i - MAG_BATCH] = m->chunks[i];
+	m->count -= MAG_BATCH;
+}
+
+/** @brief Put a chunk of this context on its magazine */
+static void mag_push(struct mag_context *mc, size_t *chunk)
+{
+	unsigned int class = *chunk & SLAB_CLASS_MASK;
+	struct magazine *m = &mc->mags[class];
+
+	if (m->count == MAG_SIZE)
+		mag_flush(m, class);
+	m->chunks[m->count++] = chunk;
+}
+
+/** @brief Take back everything on the return list of a context */
+static void mag_drain(struct mag_context *mc)
+{
+	size_t *chunk, *next;
+
+	for (chunk = __sync_lock_test_and_set(&mc->remote, NULL); chunk;
+	     chunk = next)
+	{
+		next = (size_t *)chunk[1];
+		mag_push(mc, chunk);
+	}
+}
+
+/** @brief Refill an empty magazine
+ *
+ *  @return 0 if it has chunks now, -1 if the slab class is out of memory
+ */
+static int mag_refill(struct mag_context *mc, unsigned int class)
+{
+	struct magazine *m = &mc->mags[class];
+	size_t *chunk;
+
+	/* Pairs with the compare and swap of a remote free, so a chunk seen
+	   on the list is seen with its link */
+	if (__atomic_load_n(&mc->remote, __ATOMIC_ACQUIRE))
+		mag_drain(mc);
+	if (m->count)
+		return 0;
+
+	_malloc_lock();
+	while (m->count < MAG_BATCH && (chunk = _slab_alloc(class)))
+		m->chunks[m->count++] = chunk;
+	_malloc_unlock();
+
+	return m->count ? 0 : -1;
+}
+
+/** @brief Allocate a chunk of up to SLAB_MAX_CHUNK bytes
+ *
+ *  @param size Chunk size, size word included
+ *  @return The memory after the size word, NULL if out of memory
+ */
+void *_mag_alloc(size_t size)
+{
+	int ctx = mag_self();
+	struct mag_context *mc = &mag_contexts[ctx];
+	unsigned int class = _slab_class(size);
+	struct magazine *m = &mc->mags[class];
+	size_t *chunk;
+
+	if (!m->count && mag_refill(mc, class) < 0)
+		return NULL;
+
+	chunk = m->chunks[--m->count];
+	*chunk = SLAB_CHUNK | (ctx << SLAB_OWNER_SHIFT) | class;
+	return chunk + 1;
+}
+
+/** @brief Free a chunk from _mag_alloc()
+ *
+ *  @param chunk The chunk, at its size word
+ *  @return void
+ */
+void _mag_free(size_t *chunk)
+{
+	int ctx = mag_self();
+	int owner = (*chunk >> SLAB_OWNER_SHIFT) & SLAB_OWNER_MASK;
+	struct mag_context *mc = &mag_contexts[owner];
+	size_t *head;
+
+	if (owner == ctx)
+	{
+		mag_push(mc, chunk);
+		return;
+	}
+
+	do
+	{
+		head = mc->remote;
+		chunk[1] = (size_t)head;
+	} while (!__sync_bool_compare_and_swap(&mc->remote, head, chunk));
+}
@@ -24,16 +24,35 @@
 #include "malloc_internal.h"
 
 void *_malloc(size_t size)
+{
+	return _malloc_at(size, MALLOC_SITE());
+}
+
+/* _malloc() for the other entry points, which pass their own caller.  */
+void *_malloc_at(size_t size, void *site)
 {
 	size_t *chunk;
+	void *buf;
+
+	size += sizeof(size_t) + MALLOC_DEBUG_EXTRA;
 
-	size += sizeof(size_t);
+	/* Small chunks come from the size classes, or lmm if they are out */
+	if (size <= SLAB_MAX_CHUNK && (buf = _mag_alloc(size)))
+	{
+		_stats_alloc(buf, size - sizeof(size_t), site);
+		return _debug_alloc(buf, size - sizeof(size_t) -
+				    MALLOC_DEBUG_EXTRA);
+	}
 
-	if (!(chunk = lmm_alloc(&malloc_lmm, size, 0)))
+	_malloc_lock();
+	chunk = lmm_alloc(&malloc_lmm, size, 0);
+	_malloc_unlock();
+	if (!chunk)
 		return 0;
 
 	*chunk = size;
-	return chunk+1;
+	_stats_alloc(chunk+1, size - sizeof(size_t), site);
+	return _debug_alloc(chunk+1, size - sizeof(size_t) - MALLOC_DEBUG_EXTRA);
 }
 
 void *
@@ -41,7 +60,7 @@ _mustmalloc(size_t size)
 {
 	void *buf;
 
-	buf = _malloc(size);
+	buf = _malloc_at(size, MALLOC_SITE());
 	assert(buf);
 
 	return buf;
@@ -0,0 +1,200 @@
+/** @file malloc/malloc_debug.c
+ *  @brief Debug heap for malloc
+ *
+ *  The headers of the live chunks are on a doubly linked list, so that
+ *  free() takes a chunk off in O(1) and the audit can walk them all.
+ *  The quarantine is a ring of the chunks freed last.  Both change under
+ *  the malloc lock and with debug_busy set.  The kernel audits from its
+ *  main loop, which never interrupts them; debug_busy is for an audit
+ *  run from a handler anyway, which leaves them alone.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug See malloc_debug.h
+ */
+
+#include <stddef.h>
+#include <stdlib.h>                 /* panic() */
+#include <simics.h>
+#include <string/string.h>
+#include "malloc_internal.h"
+#include "malloc_debug.h"
+
+#ifdef MALLOC_DEBUG
+
+/** @brief Header in front of a chunk, MALLOC_DEBUG_HEAD bytes */
+struct debug_head
+{
+	/** @brief Live list */
+	struct debug_head *next;
+	struct debug_head *prev;
+	/** @brief Bytes asked for */
+	size_t size;
+	/** @brief DEBUG_LIVE or DEBUG_DEAD, xor the chunk's address */
+	size_t canary;
+};
+
+/** @brief Canaries of live and freed chunks */
+#define DEBUG_LIVE	0x5afe11feUL
+#define DEBUG_DEAD	0xdeadf4eeUL
+
+/** @brief Chunk after a header */
+#define DEBUG_BUF(h)	((unsigned char *)(h) + MALLOC_DEBUG_HEAD)
+
+static struct debug_head debug_live = { &debug_live, &debug_live, 0, 0 };
+static struct debug_head *debug_ring[MALLOC_DEBUG_QUARANTINE];
+static unsigned int debug_ring_next;
+
+/** @brief Set while the live list or the ring change */
+static volatile int debug_busy;
+
+/** @brief Report corruption of a chunk */
+static void debug_fail(const char *what, struct debug_head *h)
+{
+	lprintf("malloc debug: %s, chunk %p of %u bytes", what, DEBUG_BUF(h),
+		(unsigned int)h->size);
+	panic("malloc debug: %s, chunk %p", what, DEBUG_BUF(h));
+}
+
+/** @brief Bytes from the header to the end of what the allocator gave */
+static size_t debug_room(struct debug_head *h)
+{
+	size_t *word = (size_t *)h - 1;
+
+	return ((*word & SLAB_CHUNK) ? _slab_chunk_size(word) : *word)
+		- sizeof(size_t);
+}
+
+/** @brief Index of the first byte in [p, p+n) that is not c, n if none */
+static size_t debug_scan(unsigned char *p, size_t n, unsigned char c)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		if (p[i] != c)
+			return i;
+	return n;
+}
+
+/** @brief Check the canary and red zone of a live chunk */
+static void debug_check_live(struct debug_head *h)
+{
+	size_t zone = debug_room(h) - MALLOC_DEBUG_HEAD - h->size;
+
+	if (h->canary != (DEBUG_LIVE ^ (size_t)DEBUG_BUF(h)))
+		debug_fail("header overwritten", h);
+	if (debug_scan(DEBUG_BUF(h) + h->size, zone, MALLOC_DEBUG_RED) != zone)
+		debug_fail("write past the end", h);
+}
+
+/** @brief Check a quarantined chunk is still as free() left it */
+static void debug_check_dead(struct debug_head *h)
+{
+	if (h->canary != (DEBUG_DEAD ^ (size_t)DEBUG_BUF(h)))
+		debug_fail("header of a freed chunk overwritten", h);
+	if (debug_scan(DEBUG_BUF(h), h->size, MALLOC_DEBUG_FREED) != h->size)
+		debug_fail("write after free", h);
+}
+
+/** @brief Set up a chunk the allocator handed out
+ *
+ *  @param buf What the allocator gave, after its size word
+ *  @param size Bytes asked for, MALLOC_DEBUG_EXTRA less than it gave
+ *  @return The chunk for the caller
+ */
+void *_debug_alloc(void *buf, size_t size)
+{
+	struct debug_head *h = buf;
+
+	h->size = size;
+	h->canary = DEBUG_LIVE ^ (size_t)DEBUG_BUF(h);
+	memset(DEBUG_BUF(h) + size, MALLOC_DEBUG_RED,
+	       debug_room(h) - MALLOC_DEBUG_HEAD - size);
+
+	_malloc_lock();
+	debug_busy = 1;
+	h->next = debug_live.next;
+	h->prev = &debug_live;
+	h->next->prev = h;
+	debug_live.next = h;
+	debug_busy = 0;
+	_malloc_unlock();
+	return DEBUG_BUF(h);
+}
+
+/** @brief Check and quarantine a chunk given to free()
+ *
+ *  @param buf The chunk
+ *  @return What to really free now, as _debug_alloc() got it, or NULL
+ */
+void *_debug_free(void *buf)
+{
+	struct debug_head *h, *out;
+
+	if (!buf)
+		return NULL;
+	h = (struct debug_head *)((unsigned char *)buf - MALLOC_DEBUG_HEAD);
+	if (h->canary == (DEBUG_DEAD ^ (size_t)buf))
+		debug_fail("freed twice", h);
+	debug_check_live(h);
+	memset(buf, MALLOC_DEBUG_FREED, h->size);
+
+	_malloc_lock();
+	debug_busy = 1;
+	h->prev->next = h->next;
+	h->next->prev = h->prev;
+	h->canary = DEBUG_DEAD ^ (size_t)buf;
+	out = debug_ring[debug_ring_next];
+	debug_ring[debug_ring_next] = h;
+	debug_ring_next = (debug_ring_next + 1) % MALLOC_DEBUG_QUARANTINE;
+	debug_busy = 0;
+	_malloc_unlock();
+
+	if (out)
+		debug_check_dead(out);
+	return out;
+}
+
+/** @brief Check a live chunk and return its size, for realloc()
+ *
+ *  @param buf The chunk
+ *  @return Bytes asked for
+ */
+size_t _debug_size(void *buf)
+{
+	struct debug_head *h =
+		(struct debug_head *)((unsigned char *)buf - MALLOC_DEBUG_HEAD);
+
+	if (h->canary == (DEBUG_DEAD ^ (size_t)buf))
+		debug_fail("realloc of a freed chunk", h);
+	debug_check_live(h);
+	return h->size;
+}
+
+int malloc_debug_audit(void)
+{
+	struct debug_head *h;
+	int i, n = 0;
+
+	if (debug_busy)
+		return 0;
+	_malloc_lock();
+	for (h = debug_live.next; h != &debug_live; h = h->next, n++)
+		debug_check_live(h);
+	for (i = 0; i < MALLOC_DEBUG_QUARANTINE; i++)
+		if (debug_ring[i])
+		{
+			debug_check_dead(debug_ring[i]);
+			n++;
+		}
+	_malloc_unlock();
+	return n;
+}
+
+#else /* !MALLOC_DEBUG */
+
+int malloc_debug_audit(void)
+{
+	return -1;
+}
+
+#endif /* MALLOC_DEBUG */
@@ -0,0 +1,55 @@
+/** @file malloc/malloc_debug.h
+ *  @brief Debug heap for malloc
+ *
+ *  With MALLOC_DEBUG = 1 in config.mk, every chunk from malloc, calloc,
+ *  realloc and memalign is laid out as
+ *
+ *  -- a header: the live list links, the size asked for and a canary
+ *  word that depends on the chunk's address
+ *  -- the chunk
+ *  -- a red zone of MALLOC_DEBUG_RED bytes up to the end of what the
+ *  allocator handed out, at least MALLOC_DEBUG_ZONE of them
+ *
+ *  free() checks the canary and the red zone of the chunk, fills it
+ *  with MALLOC_DEBUG_FREED and keeps it in a quarantine ring of
+ *  MALLOC_DEBUG_QUARANTINE chunks; the chunk it pushes out has to be
+ *  still filled before it really goes back.  realloc() always moves the
+ *  chunk, so that stale pointers to the old one land in the quarantine.
+ *  Nothing else is checked on the way: malloc_debug_audit() checks every
+ *  live and quarantined chunk at once, and the kernel calls it every
+ *  few seconds from the loops that wait for a key and from the game's
+ *  own key loop, outside interrupt context.  Corruption panics with
+ *  what was found and where.
+ *
+ *  arena_alloc() is covered too, each one a chunk of its own until the
+ *  arena is reset.  smalloc() and smemalign() chunks are not covered.
+ *  Without MALLOC_DEBUG malloc is built as before and only the audit
+ *  exists, returning -1.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug A write past a chunk that skips its red zone is not seen
+ */
+
+#ifndef _MALLOC_DEBUG_H_
+#define _MALLOC_DEBUG_H_
+
+/** @brief Byte the red zones are filled with */
+#define MALLOC_DEBUG_RED	0xfd
+
+/** @brief Byte freed chunks are filled with */
+#define MALLOC_DEBUG_FREED	0xdd
+
+/** @brief Freed chunks held back before they are really freed */
+#define MALLOC_DEBUG_QUARANTINE	64
+
+/** @brief Check every live and quarantined chunk
+ *
+ *  Returns at once, checking nothing, if it interrupted malloc or free
+ *  changing the live list.  With malloc_set_contexts() hooks it takes
+ *  the malloc lock, so it must run in a context that may.
+ *
+ *  @return Chunks checked, -1 if malloc was built without MALLOC_DEBUG
+ */
+int malloc_debug_audit(void);
+
+#endif /* _MALLOC_DEBUG_H_ */
@@ -28,6 +28,7 @@
 extern lmm_t malloc_lmm;
 
 void *_malloc(size_t size);
+void *_malloc_at(size_t size, void *site);
 void *_mustmalloc(size_t size);
 void *_memalign(size_t alignment, size_t size);
 void *_calloc(size_t nelt, size_t eltsize);
@@ -48,4 +49,77 @@ void *_smalloc(size_t size);
 void *_smemalign(size_t alignment, size_t size);
 void _sfree(void *buf, size_t size);
 
+/* Size-class front end for small chunks (slab.c).  _malloc() hands
+   chunks of up to SLAB_MAX_CHUNK bytes, size word included, to the
+   magazines; their size word is SLAB_CHUNK | owner << SLAB_OWNER_SHIFT
+   | class instead of the chunk size, which is how _free() and
+   _realloc() tell them apart from chunks that came straight from
+   malloc_lmm.  _slab_alloc() and _slab_free() take and return chunks
+   at their size word and must be called with the malloc lock held. */
+#define SLAB_MAX_CHUNK	2048
+#define SLAB_CHUNK	0x80000000
+#define SLAB_CLASS_MASK	0xff
+#define SLAB_OWNER_SHIFT 8
+#define SLAB_OWNER_MASK	0xff
+#define SLAB_CLASSES	14
+
+unsigned int _slab_class(size_t size);
+size_t *_slab_alloc(unsigned int class);
+void _slab_free(size_t *chunk, unsigned int class);
+size_t _slab_chunk_size(size_t *chunk);
+size_t _slab_class_size(unsigned int class);
+
+/* Per-context magazines of slab chunks (magazine.c).  Each of up to
+   MALLOC_CONTEXTS contexts allocates from and frees to its own
+   magazines without the malloc lock; chunks freed by another context
+   go back to their owner through a lock-free list.  The malloc lock
+   guards the slab classes and malloc_lmm.  Until malloc_set_contexts()
+   installs hooks there is one context and no lock.  A context must
+   never interrupt itself: with interrupt handlers that allocate, a
+   handler is a context of its own. */
+#ifndef MALLOC_CONTEXTS
+#define MALLOC_CONTEXTS	4
+#endif
+
+void malloc_set_contexts(int (*context)(void), void (*lock)(void),
+			 void (*unlock)(void));
+void _malloc_lock(void);
+void _malloc_unlock(void);
+void *_mag_alloc(size_t size);
+void _mag_free(size_t *chunk);
+
+/* Allocation accounting (malloc_stats.c), built in when config.mk sets
+   MALLOC_STATS = 1.  The entry points record the chunks they hand out
+   and take back, with the address their caller returns to; without
+   MALLOC_STATS the hooks compile to nothing. */
+#ifdef MALLOC_STATS
+void _stats_alloc(void *buf, size_t size, void *site);
+void _stats_free(void *buf);
+#define MALLOC_SITE()	__builtin_return_address(0)
+#else
+#define _stats_alloc(buf, size, site)	((void)0)
+#define _stats_free(buf)		((void)0)
+#define MALLOC_SITE()	((void *)0)
+#endif
+
+/* Debug heap (malloc_debug.c), built in when config.mk sets
+   MALLOC_DEBUG = 1.  The entry points ask the allocator for
+   MALLOC_DEBUG_EXTRA more bytes, _debug_alloc() puts a header with a
+   canary in front of the chunk and a red zone after it, and _free()
+   hands the chunk to _debug_free(), which quarantines it and gives back
+   an older one to really free, if any.  Without MALLOC_DEBUG the extra
+   is 0 and _debug_alloc() is the chunk itself. */
+#ifdef MALLOC_DEBUG
+#define MALLOC_DEBUG_HEAD	(4 * sizeof(size_t))
+#define MALLOC_DEBUG_ZONE	8
+void *_debug_alloc(void *buf, size_t size);
+void *_debug_free(void *buf);
+size_t _debug_size(void *buf);
+#else
+#define MALLOC_DEBUG_HEAD	0
+#define MALLOC_DEBUG_ZONE	0
+#define _debug_alloc(buf, size)	(buf)
+#endif
+#define MALLOC_DEBUG_EXTRA	(MALLOC_DEBUG_HEAD + MALLOC_DEBUG_ZONE)
+
 #endif /* _410KERN_MALLOC_H_ */
@@ -0,0 +1,300 @@
+/** @file malloc/malloc_stats.c
+ *  @brief Allocation accounting for malloc
+ *
+ *  Two fixed tables, so that the accounting never allocates:
+ *
+ *  -- Call sites, hashed by address with linear probing.  A site keeps
+ *  how many chunks and bytes it has live, which is the leak report.
+ *  -- Live chunks, hashed by address with linear probing and backward
+ *  shift deletion, each with its size and site, so that free() knows
+ *  what to take off.
+ *
+ *  Updates run under the malloc lock, so with several contexts they
+ *  serialize the magazines; this is for finding out where memory goes,
+ *  not for production.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug See malloc_stats.h
+ */
+
+#include <stddef.h>
+#include <simics.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_buddy.h>
+#include "malloc_internal.h"
+#include "malloc_stats.h"
+
+#ifdef MALLOC_STATS
+
+/** @brief Live chunk */
+struct stats_chunk
+{
+	/** @brief The chunk, after its size word, 0 if the slot is empty */
+	void *buf;
+	/** @brief Bytes asked for */
+	size_t size;
+	/** @brief Slots of its call site and class */
+	unsigned short site;
+	unsigned short class;
+};
+
+static malloc_stats_t stats;
+static malloc_site_stats_t stats_sites[MALLOC_STATS_SITES];
+static struct stats_chunk stats_chunks[MALLOC_STATS_CHUNKS];
+
+/** @brief Chunks in stats_chunks, which keeps at least one slot empty */
+static unsigned int stats_tracked;
+
+/** @brief Multiplicative hash of an address, wrapping the word */
+#define STATS_HASH(p, n) \
+	((unsigned int)((((size_t)(p) >> 3) * (size_t)2654435761UL) >> 8) % (n))
+
+/** @brief Slot of a call site, added if new */
+static unsigned int stats_site(void *site)
+{
+	unsigned int n = MALLOC_STATS_SITES - 1;
+	unsigned int i = STATS_HASH(site, n), probes;
+
+	for (probes = 0; probes < n; probes++, i = (i + 1) % n)
+	{
+		if (stats_sites[i].site == site)
+			return i;
+		if (!stats_sites[i].site)
+		{
+			stats_sites[i].site = site;
+			return i;
+		}
+	}
+	return n;
+}
+
+/** @brief Slot of a live chunk, or the empty slot where it would go */
+static unsigned int stats_slot(void *buf)
+{
+	unsigned int i = STATS_HASH(buf, MALLOC_STATS_CHUNKS);
+
+	while (stats_chunks[i].buf && stats_chunks[i].buf != buf)
+		i = (i + 1) % MALLOC_STATS_CHUNKS;
+	return i;
+}
+
+/** @brief Empty a slot, moving back the chunks that probed past it */
+static void stats_unslot(unsigned int hole)
+{
+	unsigned int i = hole, home;
+
+	stats_chunks[hole].buf = 0;
+	for (;;)
+	{
+		i = (i + 1) % MALLOC_STATS_CHUNKS;
+		if (!stats_chunks[i].buf)
+			return;
+		home = STATS_HASH(stats_chunks[i].buf, MALLOC_STATS_CHUNKS);
+		/* Stays if its home lies cyclically in (hole, i] */
+		if (hole < i ? (home > hole && home <= i)
+			     : (home > hole || home <= i))
+			continue;
+		stats_chunks[hole] = stats_chunks[i];
+		stats_chunks[i].buf = 0;
+		hole = i;
+	}
+}
+
+/** @brief Class of a chunk from _malloc_at() or _memalign() */
+static unsigned int stats_class(void *buf)
+{
+	size_t word = ((size_t *)buf)[-1];
+
+	return (word & SLAB_CHUNK) ? (word & SLAB_CLASS_MASK) : SLAB_CLASSES;
+}
+
+/** @brief Record a chunk handed out
+ *
+ *  @param buf The chunk, after its size word
+ *  @param size Bytes asked for
+ *  @param site Where the allocating call returns to
+ *  @return void
+ */
+void _stats_alloc(void *buf, size_t size, void *site)
+{
+	unsigned int class = stats_class(buf), s, i;
+
+	_malloc_lock();
+	stats.classes[class].allocs++;
+	stats.classes[class].bytes += size;
+
+	if (stats_tracked == MALLOC_STATS_CHUNKS - 1)
+		stats.untracked++;
+	else
+	{
+		s = stats_site(site);
+		stats_sites[s].chunks++;
+		stats_sites[s].bytes += size;
+
+		i = stats_slot(buf);
+		stats_chunks[i].buf = buf;
+		stats_chunks[i].size = size;
+		stats_chunks[i].site = s;
+		stats_chunks[i].class = class;
+		stats_tracked++;
+
+		stats.classes[class].live_bytes += size;
+		stats.live_bytes += size;
+		if (stats.live_bytes > stats.peak_bytes)
+			stats.peak_bytes = stats.live_bytes;
+	}
+	_malloc_unlock();
+}
+
+/** @brief Record a chunk given back, before it is freed
+ *
+ *  @param buf The chunk, after its size word
+ *  @return void
+ */
+void _stats_free(void *buf)
+{
+	struct stats_chunk *c;
+	unsigned int i;
+
+	_malloc_lock();
+	i = stats_slot(buf);
+	c = &stats_chunks[i];
+	if (!c->buf)
+	{
+		stats.classes[stats_class(buf)].frees++;
+		if (stats.untracked)
+			stats.untracked--;
+	}
+	else
+	{
+		stats.classes[c->class].frees++;
+		stats.classes[c->class].live_bytes -= c->size;
+		stats.live_bytes -= c->size;
+		stats_sites[c->site].chunks--;
+		stats_sites[c->site].bytes -= c->size;
+		stats_unslot(i);
+		stats_tracked--;
+	}
+	_malloc_unlock();
+}
+
+int malloc_stats_get(malloc_stats_t *out)
+{
+	vm_offset_t addr = 0;
+	vm_size_t size;
+	lmm_flags_t flags;
+	unsigned int i;
+
+	_malloc_lock();
+	*out = stats;
+	out->free_bytes = lmm_avail(&malloc_lmm, 0);
+	/* lmm_find_free() does not see the pages free in buddy arenas */
+	out->largest_free = lmm_buddy_largest(&malloc_lmm, 0);
+	for (;;)
+	{
+		lmm_find_free(&malloc_lmm, &addr, &size, &flags);
+		if (size == 0)
+			break;
+		if (size > out->largest_free)
+			out->largest_free = size;
+		addr += size;
+	}
+	_malloc_unlock();
+
+	for (i = 0; i < SLAB_CLASSES; i++)
+		out->classes[i].size = _slab_class_size(i) - sizeof(size_t);
+	out->classes[SLAB_CLASSES].size = 0;
+	return 0;
+}
+
+int malloc_stats_sites(malloc_site_stats_t *out, int max)
+{
+	malloc_site_stats_t *s;
+	int i, j, n = 0;
+
+	_malloc_lock();
+	for (i = 0; i < MALLOC_STATS_SITES; i++)
+	{
+		s = &stats_sites[i];
+		if (!s->chunks || (n == max && (max == 0 ||
+					       out[max - 1].bytes >= s->bytes)))
+			continue;
+		/* Insertion by bytes, the smallest falls off a full array */
+		for (j = n < max ? n++ : max - 1;
+		     j > 0 && out[j - 1].bytes < s->bytes; j--)
+			out[j] = out[j - 1];
+		out[j] = *s;
+		if (i == MALLOC_STATS_SITES - 1)
+			out[j].site = 0;
+	}
+	_malloc_unlock();
+	return n;
+}
+
+void malloc_stats_dump(void)
+{
+	malloc_site_stats_t sites[16];
+	malloc_class_stats_t *c;
+	malloc_stats_t st;
+	int i, n;
+
+	malloc_stats_get(&st);
+	lprintf("malloc: %u bytes live, peak %u, %u free, largest free block %u",
+		(unsigned int)st.live_bytes, (unsigned int)st.peak_bytes,
+		(unsigned int)st.free_bytes, (unsigned int)st.largest_free);
+	/* Share of the free space outside the largest block */
+	if (st.free_bytes >= 100)
+		lprintf("malloc: free space %u%% fragmented",
+			(unsigned int)((st.free_bytes - st.largest_free)
+				       / (st.free_bytes / 100)));
+	for (i = 0; i < MALLOC_STATS_CLASSES; i++)
+	{
+		c = &st.classes[i];
+		if (!c->allocs)
+			continue;
+		if (c->size)
+			lprintf("  up to %4u bytes: %u allocs, %u frees, "
+				"%u bytes asked, %u live", (unsigned int)c->size,
+				c->allocs, c->frees, (unsigned int)c->bytes,
+				(unsigned int)c->live_bytes);
+		else
+			lprintf("  lmm chunks:       %u allocs, %u frees, "
+				"%u bytes asked, %u live", c->allocs, c->frees,
+				(unsigned int)c->bytes, (unsigned int)c->live_bytes);
+	}
+
+	n = malloc_stats_sites(sites, sizeof(sites) / sizeof(sites[0]));
+	lprintf("malloc: live chunks by call site%s", n ? "" : ": none");
+	for (i = 0; i < n; i++)
+	{
+		if (sites[i].site)
+			lprintf("  0x%08lx: %u chunks, %u bytes",
+				(unsigned long)sites[i].site, sites[i].chunks,
+				(unsigned int)sites[i].bytes);
+		else
+			lprintf("  other sites: %u chunks, %u bytes",
+				sites[i].chunks, (unsigned int)sites[i].bytes);
+	}
+	if (st.untracked)
+		lprintf("  %u more chunks not tracked", st.untracked);
+}
+
+#else /* !MALLOC_STATS */
+
+int malloc_stats_get(malloc_stats_t *out)
+{
+	return -1;
+}
+
+int malloc_stats_sites(malloc_site_stats_t *out, int max)
+{
+	return -1;
+}
+
+void malloc_stats_dump(void)
+{
+	lprintf("malloc: statistics not built in, set MALLOC_STATS = 1 "
+		"in config.mk");
+}
+
+#endif /* MALLOC_STATS */
@@ -0,0 +1,87 @@
+/** @file malloc/malloc_stats.h
+ *  @brief Allocation accounting for malloc
+ *
+ *  With MALLOC_STATS = 1 in config.mk, malloc, calloc, realloc,
+ *  memalign and free keep counts and bytes per size class, the most
+ *  bytes ever live, and every live chunk with the call site it was
+ *  allocated from.  smalloc() and smemalign() chunks are not counted,
+ *  their caller keeps track of them.  Without it these functions still
+ *  exist but report nothing.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Live chunks beyond MALLOC_STATS_CHUNKS are counted in their
+ *  class but not in the leak report
+ */
+
+#ifndef _MALLOC_STATS_H_
+#define _MALLOC_STATS_H_
+
+#include <types.h>
+#include <malloc/malloc_internal.h>
+
+/** @brief Size classes and one for the chunks that go straight to lmm */
+#define MALLOC_STATS_CLASSES	(SLAB_CLASSES + 1)
+
+/** @brief Live chunks the leak report can tell apart */
+#define MALLOC_STATS_CHUNKS	8192
+
+/** @brief Call sites it can tell apart; the last one takes the rest */
+#define MALLOC_STATS_SITES	128
+
+/** @brief Accounting of one size class */
+typedef struct malloc_class_stats {
+	/** @brief Largest request it serves, 0 for the lmm class */
+	size_t size;
+	/** @brief Chunks allocated and freed */
+	unsigned int allocs;
+	unsigned int frees;
+	/** @brief Bytes asked for, in all and still live */
+	size_t bytes;
+	size_t live_bytes;
+} malloc_class_stats_t;
+
+/** @brief Accounting of the whole heap */
+typedef struct malloc_stats {
+	malloc_class_stats_t classes[MALLOC_STATS_CLASSES];
+	/** @brief Bytes asked for that are live, now and at most */
+	size_t live_bytes;
+	size_t peak_bytes;
+	/** @brief Free bytes in malloc_lmm and the largest free block,
+	 *  both counting the pages free in its buddy arenas */
+	size_t free_bytes;
+	size_t largest_free;
+	/** @brief Live chunks left out of the leak report */
+	unsigned int untracked;
+} malloc_stats_t;
+
+/** @brief Live chunks of one call site */
+typedef struct malloc_site_stats {
+	/** @brief Address the allocating call returns to, 0 for the rest */
+	void *site;
+	/** @brief Chunks and bytes */
+	unsigned int chunks;
+	size_t bytes;
+} malloc_site_stats_t;
+
+/** @brief Read the accounting
+ *
+ *  @param stats Filled in
+ *  @return 0, -1 if malloc was built without MALLOC_STATS
+ */
+int malloc_stats_get(malloc_stats_t *stats);
+
+/** @brief Call sites with live chunks, most bytes first
+ *
+ *  @param sites Filled in
+ *  @param max Entries it has room for
+ *  @return Entries filled in, -1 if built without MALLOC_STATS
+ */
+int malloc_stats_sites(malloc_site_stats_t *sites, int max);
+
+/** @brief Log the accounting and the leak report with lprintf()
+ *
+ *  @return void
+ */
+void malloc_stats_dump(void);
+
+#endif /* _MALLOC_STATS_H_ */
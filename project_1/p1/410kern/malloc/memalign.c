@@ -35,13 +35,18 @@ void *_memalign(size_t alignment, size_t size)
 	 * and an offset such that the memory block we return will be aligned
 	 * after we add our size field to the beginning of it.
 	 */
-	size += sizeof(size_t);
+	size += sizeof(size_t) + MALLOC_DEBUG_EXTRA;
 
-	if (!(chunk = lmm_alloc_aligned(&malloc_lmm, size, 0, shift,
-					   (1 << shift) - sizeof(size_t))))
+	_malloc_lock();
+	chunk = lmm_alloc_aligned(&malloc_lmm, size, 0, shift,
+				  (1 << shift) - sizeof(size_t) -
+				  MALLOC_DEBUG_HEAD);
+	_malloc_unlock();
+	if (!chunk)
         return NULL;
 
 	*chunk = size;
-	return chunk+1;
+	_stats_alloc(chunk+1, size - sizeof(size_t), MALLOC_SITE());
+	return _debug_alloc(chunk+1, size - sizeof(size_t) - MALLOC_DEBUG_EXTRA);
 }
 
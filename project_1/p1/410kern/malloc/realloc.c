@@ -24,28 +24,66 @@
 
 #include "malloc_internal.h"
 
-/* XX could be made smarter, so it doesn't always copy to a new block.  */
 void *_realloc(void *buf, size_t new_size)
 {
-	vm_size_t *op;
-	vm_size_t old_size;
-	vm_size_t *np;
+	size_t old_size;
+	void *np;
+#ifndef MALLOC_DEBUG
+	size_t *op, size;
+	int done;
+#endif
 
 	if (buf == 0)
-		return _malloc(new_size);
+		return _malloc_at(new_size, MALLOC_SITE());
 
-	op = (vm_size_t*)buf;
-	old_size = *--op;
+#ifdef MALLOC_DEBUG
+	/* Always move, so that stale pointers to the old chunk land in the
+	   quarantine */
+	old_size = _debug_size(buf);
+#else
+	op = (size_t*)buf - 1;
+	size = new_size + sizeof(size_t);
 
-	new_size += sizeof(vm_size_t);
-	if (!(np = lmm_alloc(&malloc_lmm, new_size, 0)))
+	/* Stay put if the chunk still fits and is not mostly wasted, or if
+	   lmm can grow or shrink a large chunk where it is.  */
+	if (*op & SLAB_CHUNK)
+	{
+		old_size = _slab_chunk_size(op);
+		if (size <= old_size && size > old_size / 2)
+		{
+			_stats_free(buf);
+			_stats_alloc(buf, new_size, MALLOC_SITE());
+			return buf;
+		}
+	}
+	else
+	{
+		old_size = *op;
+		if (size > SLAB_MAX_CHUNK)
+		{
+			_malloc_lock();
+			done = lmm_resize(&malloc_lmm, op, old_size, size);
+			_malloc_unlock();
+			if (done)
+			{
+				*op = size;
+				_stats_free(buf);
+				_stats_alloc(buf, new_size, MALLOC_SITE());
+				return buf;
+			}
+		}
+	}
+	old_size -= sizeof(size_t);
+#endif /* MALLOC_DEBUG */
+
+	/* The chunk may be small or large either side, so go through
+	   _malloc() and _free() rather than straight to lmm.  */
+	if (!(np = _malloc_at(new_size, MALLOC_SITE())))
 	    return NULL;
 
-	memcpy(np, op, old_size < new_size ? old_size : new_size);
+	memcpy(np, buf, old_size < new_size ? old_size : new_size);
 
-	lmm_free(&malloc_lmm, op, old_size);
-	
-	*np++ = new_size;
+	_free(buf);
 	return np;
 }
 
@@ -26,6 +26,8 @@
 
 void _sfree(void *chunk, size_t size)
 {
+	_malloc_lock();
 	lmm_free(&malloc_lmm, chunk, size);
+	_malloc_unlock();
 }
 
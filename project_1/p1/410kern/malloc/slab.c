@@ -0,0 +1,242 @@
+/** @file malloc/slab.c
+ *  @brief Size-class front end for small malloc() chunks
+ *
+ *  lmm_alloc() walks every region and free node on each call and
+ *  lmm_free() walks the sorted free list to insert, which is what made
+ *  small mallocs slow.  Chunks of up to SLAB_MAX_CHUNK bytes (the size
+ *  word included) instead come from slabs: naturally aligned blocks of
+ *  one or more pages taken from malloc_lmm and cut into chunks of one
+ *  size class.  A slab keeps its free chunks on a list threaded through
+ *  the chunks themselves, so allocating and freeing are a pop and a
+ *  push.
+ *
+ *  Each class keeps the slabs that have free chunks on a doubly linked
+ *  list.  A slab leaves the list when it fills up and comes back when a
+ *  chunk of it is freed.  A slab whose chunks are all free goes back to
+ *  malloc_lmm, except that each class keeps one so that a malloc/free
+ *  pair at the edge of a slab does not take and return a page each time.
+ *
+ *  The slab header sits at the start of the slab, found by masking the
+ *  chunk address with the slab size of the class.  Chunks reach
+ *  _malloc() and _free() through the per-context magazines of
+ *  magazine.c, which take and return them here in batches.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Callers hold the malloc lock
+ */
+
+#include <stddef.h>
+#include <x86/page.h>
+#include "malloc_internal.h"
+
+/** @brief Header at the start of every slab */
+struct slab
+{
+	/** @brief Slabs of the class with free chunks */
+	struct slab *next;
+	struct slab *prev;
+	/** @brief Free chunks of this slab, linked through their first word */
+	void *free;
+	/** @brief Chunks handed out */
+	unsigned int inuse;
+	/** @brief Index into slab_classes */
+	unsigned int class;
+};
+
+/** @brief Chunks start this far into a slab, keeping lmm's alignment */
+#define SLAB_HEADER_SIZE \
+	((sizeof(struct slab) + sizeof(struct slab *) * 2 - 1) & \
+	 ~(sizeof(struct slab *) * 2 - 1))
+
+/** @brief One size class */
+struct slab_class
+{
+	/** @brief Chunk size, size word included */
+	size_t size;
+	/** @brief log2 of the slab size */
+	unsigned int shift;
+	/** @brief Slabs with free chunks */
+	struct slab *partial;
+	/** @brief Slabs on that list with no chunk in use */
+	unsigned int empty;
+};
+
+/* From 32 bytes on, sizes step by a quarter to a half so that at most a
+   third of a chunk is wasted; the larger classes use bigger slabs so
+   that a slab holds enough chunks to be worth its header. */
+static struct slab_class slab_classes[SLAB_CLASSES] =
+{
+	{ 16,	PAGE_SHIFT },
+	{ 32,	PAGE_SHIFT },
+	{ 48,	PAGE_SHIFT },
+	{ 64,	PAGE_SHIFT },
+	{ 96,	PAGE_SHIFT },
+	{ 128,	PAGE_SHIFT },
+	{ 192,	PAGE_SHIFT },
+	{ 256,	PAGE_SHIFT },
+	{ 384,	PAGE_SHIFT },
+	{ 512,	PAGE_SHIFT },
+	{ 768,	PAGE_SHIFT + 2 },
+	{ 1024,	PAGE_SHIFT + 2 },
+	{ 1536,	PAGE_SHIFT + 2 },
+	{ 2048,	PAGE_SHIFT + 3 },
+};
+
+/** @brief Granularity of slab_class_of */
+#define SLAB_STEP_SHIFT	4
+
+/** @brief Smallest class that fits a chunk size, by size / 16 rounded up */
+static unsigned char slab_class_of[(SLAB_MAX_CHUNK >> SLAB_STEP_SHIFT) + 1];
+
+/** @brief Whether slab_class_of has been filled in */
+static int slab_ready;
+
+/** @brief Fill in slab_class_of */
+static void slab_init(void)
+{
+	unsigned int i, class = 0;
+
+	for (i = 0; i <= (SLAB_MAX_CHUNK >> SLAB_STEP_SHIFT); i++)
+	{
+		while (slab_classes[class].size < (i << SLAB_STEP_SHIFT))
+			class++;
+		slab_class_of[i] = class;
+	}
+	slab_ready = 1;
+}
+
+/** @brief Put a slab at the head of its class's list */
+static void slab_link(struct slab_class *c, struct slab *s)
+{
+	s->prev = NULL;
+	s->next = c->partial;
+	if (s->next)
+		s->next->prev = s;
+	c->partial = s;
+}
+
+/** @brief Take a slab off its class's list */
+static void slab_unlink(struct slab_class *c, struct slab *s)
+{
+	if (s->prev)
+		s->prev->next = s->next;
+	else
+		c->partial = s->next;
+	if (s->next)
+		s->next->prev = s->prev;
+}
+
+/** @brief Get a new slab for a class from malloc_lmm
+ *
+ *  @return The slab, on the class's list, or NULL if lmm has no room
+ */
+static struct slab *slab_grow(unsigned int class)
+{
+	struct slab_class *c = &slab_classes[class];
+	vm_size_t bytes = (vm_size_t)1 << c->shift;
+	struct slab *s;
+	char *chunk, *end;
+	void **tail;
+
+	/* For one-page slabs this is lmm_alloc_page() */
+	if (!(s = lmm_alloc_aligned(&malloc_lmm, bytes, 0, c->shift, 0)))
+		return NULL;
+
+	s->inuse = 0;
+	s->class = class;
+	tail = &s->free;
+	end = (char *)s + bytes - c->size;
+	for (chunk = (char *)s + SLAB_HEADER_SIZE; chunk <= end;
+	     chunk += c->size)
+	{
+		*tail = chunk;
+		tail = (void **)chunk;
+	}
+	*tail = NULL;
+
+	slab_link(c, s);
+	c->empty++;
+	return s;
+}
+
+/** @brief Smallest class that fits a chunk
+ *
+ *  @param size Chunk size, size word included, up to SLAB_MAX_CHUNK
+ *  @return Index of the class
+ */
+unsigned int _slab_class(size_t size)
+{
+	if (!slab_ready)
+		slab_init();
+
+	return slab_class_of[(size + (1 << SLAB_STEP_SHIFT) - 1)
+			     >> SLAB_STEP_SHIFT];
+}
+
+/** @brief Allocate a chunk of a class
+ *
+ *  @param class From _slab_class()
+ *  @return The chunk, at its size word, NULL if out of memory
+ */
+size_t *_slab_alloc(unsigned int class)
+{
+	struct slab_class *c = &slab_classes[class];
+	struct slab *s;
+	size_t *chunk;
+
+	if (!(s = c->partial) && !(s = slab_grow(class)))
+		return NULL;
+
+	chunk = s->free;
+	s->free = *(void **)chunk;
+	if (s->inuse++ == 0)
+		c->empty--;
+	if (!s->free)
+		slab_unlink(c, s);
+	return chunk;
+}
+
+/** @brief Free a chunk from _slab_alloc()
+ *
+ *  @param chunk The chunk, at its size word
+ *  @param class Its class
+ *  @return void
+ */
+void _slab_free(size_t *chunk, unsigned int class)
+{
+	struct slab_class *c = &slab_classes[class];
+	struct slab *s = (struct slab *)
+		((vm_offset_t)chunk & ~(((vm_offset_t)1 << c->shift) - 1));
+
+	if (!s->free)
+		slab_link(c, s);
+	*(void **)chunk = s->free;
+	s->free = chunk;
+
+	if (--s->inuse == 0)
+	{
+		if (c->empty)
+		{
+			slab_unlink(c, s);
+			lmm_free(&malloc_lmm, s, (vm_size_t)1 << c->shift);
+		}
+		else
+			c->empty++;
+	}
+}
+
+/** @brief Chunk size of a class, size word included */
+size_t _slab_class_size(unsigned int class)
+{
+	return slab_classes[class].size;
+}
+
+/** @brief Size of a chunk from _slab_alloc()
+ *
+ *  @param chunk The chunk, at its size word
+ *  @return Its class's chunk size, size word included
+ */
+size_t _slab_chunk_size(size_t *chunk)
+{
+	return slab_classes[*chunk & SLAB_CLASS_MASK].size;
+}
@@ -31,7 +31,10 @@ void *_smalloc(size_t size)
 {
 	void *chunk;
 
-	if (!(chunk = lmm_alloc(&malloc_lmm, size, 0)))
+	_malloc_lock();
+	chunk = lmm_alloc(&malloc_lmm, size, 0);
+	_malloc_unlock();
+	if (!chunk)
         return NULL;
 
 	return chunk;
@@ -44,7 +44,10 @@ void *_smemalign(size_t alignment, size_t size)
 	 * Allocate a chunk of LMM memory with the specified alignment shift
 	 * and an offset such that the memory block we return will be aligned.
 	 */
-	if (!(chunk = lmm_alloc_aligned(&malloc_lmm, size, 0, shift, 0)))
+	_malloc_lock();
+	chunk = lmm_alloc_aligned(&malloc_lmm, size, 0, shift, 0);
+	_malloc_unlock();
+	if (!chunk)
 		return NULL;
 
 	return chunk;
@@ -0,0 +1,74 @@
+/** @file malloc/zero_pool.c
+ *  @brief Pool of pages of malloc_lmm that are already zeroed
+ *
+ *  A stack of pages taken with lmm_alloc_page() and cleared with the
+ *  rep stos bzero.  The stack is changed under the malloc lock; the
+ *  zeroing itself is not, so a context filling the pool does not hold
+ *  off the others.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug See zero_pool.h
+ */
+
+#include <stddef.h>
+#include <lmm/lmm.h>
+#include <x86/page.h>
+#include <string/string.h>
+#include "malloc_internal.h"
+#include "zero_pool.h"
+
+/** @brief Zeroed pages, zero_pages[0..zero_count) */
+static void *zero_pages[ZERO_POOL_PAGES];
+static volatile int zero_count;
+
+int zero_pool_fill(int max)
+{
+	void *page;
+	int added = 0;
+
+	while (added < max && zero_count < ZERO_POOL_PAGES)
+	{
+		_malloc_lock();
+		page = lmm_alloc_page(&malloc_lmm, 0);
+		_malloc_unlock();
+		if (!page)
+			break;
+		bzero(page, PAGE_SIZE);
+
+		_malloc_lock();
+		if (zero_count < ZERO_POOL_PAGES)
+		{
+			zero_pages[zero_count++] = page;
+			page = NULL;
+		}
+		else
+			lmm_free_page(&malloc_lmm, page);
+		_malloc_unlock();
+		if (page)
+			break;
+		added++;
+	}
+	return added;
+}
+
+void *zero_pool_page(void)
+{
+	void *page = NULL;
+
+	_malloc_lock();
+	if (zero_count > 0)
+		page = zero_pages[--zero_count];
+	else if ((page = lmm_alloc_page(&malloc_lmm, 0)))
+	{
+		_malloc_unlock();
+		bzero(page, PAGE_SIZE);
+		return page;
+	}
+	_malloc_unlock();
+	return page;
+}
+
+int zero_pool_count(void)
+{
+	return zero_count;
+}
@@ -0,0 +1,42 @@
+/** @file malloc/zero_pool.h
+ *  @brief Pool of pages of malloc_lmm that are already zeroed
+ *
+ *  The kernel zeroes pages while it waits for a key, so that calloc()
+ *  of a chunk between SLAB_MAX_CHUNK and a page, and code that wants a
+ *  zeroed page, do not zero it on their own path.  When the pool is
+ *  empty the page is zeroed on the spot.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Only single pages are pooled; calloc() of more than a page
+ *  still zeroes it on the spot
+ */
+
+#ifndef _ZERO_POOL_H_
+#define _ZERO_POOL_H_
+
+/** @brief Most pages the pool holds */
+#define ZERO_POOL_PAGES	16
+
+/** @brief Zero pages into the pool, for when there is nothing else to do
+ *
+ *  @param max Most pages to zero
+ *  @return Pages added, 0 if the pool is full or malloc_lmm is out of
+ *  pages
+ */
+int zero_pool_fill(int max);
+
+/** @brief Take a zeroed page
+ *
+ *  The page is freed with sfree(page, PAGE_SIZE) or lmm_free_page().
+ *
+ *  @return The page, NULL if malloc_lmm is out of pages
+ */
+void *zero_pool_page(void);
+
+/** @brief Pages in the pool
+ *
+ *  @return Pages ready to hand out
+ */
+int zero_pool_count(void);
+
+#endif /* _ZERO_POOL_H_ */
@@ -7,6 +7,22 @@
 #include <x86/pic.h>
 #include <x86/asm.h>
 
+    /** @brief Cached mask registers (OCW1), bit n set masks line n.
+     *         Master in the low byte, slave in the high byte.
+     */
+static unsigned short pic_mask_cache = 0xFFFF;
+
+    /** @brief Write the cached mask of the PIC owning a line. */
+static void
+pic_write_mask(unsigned char irq)
+{
+    if ( irq <= 7 ) {
+        outb( MASTER_OCW, pic_mask_cache & 0xFF );
+    } else {
+        outb(  SLAVE_OCW, pic_mask_cache >> 8 );
+    }
+}
+
     /** @brief Bring up the PICs on this system.
      * 
      * @param master_base is the offset into the IDT that the first PIC
@@ -16,9 +32,8 @@
      * @param slave_base is the offset into the IDT that the slave PIC
      *        uses for its IRQ0.
      *
-     * @post This function will enable IRQs on the PICs; EFLAGS:IF still
-     *       can be used to disable interrupts.  It is therefore suggested
-     *       that this be called before IF is enabled the first time.
+     * @post This function leaves every IRQ but the cascade masked;
+     *       drivers enable their lines with pic_unmask().
      *
      * @note This function assumes that there are only two PICs and that
      *       they are layed out as is conventional in IO space and that
@@ -50,9 +65,76 @@ pic_init( unsigned char master_base, unsigned char slave_base )
     outb( MASTER_ICW, NON_SPEC_EOI );
     outb(  SLAVE_ICW, NON_SPEC_EOI );
 
-    /* Enable all IRQs on master and slave */
-    outb (  SLAVE_OCW, 0 );
-    outb ( MASTER_OCW, 0 );
+    /* Mask every line but the cascade; drivers unmask their own lines
+     * so that unused ones never cost an interrupt.
+     */
+    pic_mask_cache = (unsigned short)~(1 << PIC_CASCADE_IRQ);
+    outb (  SLAVE_OCW, pic_mask_cache >> 8 );
+    outb ( MASTER_OCW, pic_mask_cache & 0xFF );
+}
+
+    /** @brief Mask an IRQ line.
+     *
+     * Only the PIC owning the line is written, from the cached mask,
+     * so no inb round trip is needed.
+     *
+     * @param irq The IRQ, 0-7 on the master and 8-15 on the slave.
+     */
+void
+pic_mask(unsigned char irq)
+{
+    if ( irq > 15 )
+        return;
+    pic_mask_cache |= (1 << irq);
+    pic_write_mask(irq);
+}
+
+    /** @brief Unmask an IRQ line.
+     *
+     * Unmasking a slave line also unmasks the cascade on the master.
+     *
+     * @param irq The IRQ, 0-7 on the master and 8-15 on the slave.
+     */
+void
+pic_unmask(unsigned char irq)
+{
+    if ( irq > 15 )
+        return;
+    pic_mask_cache &= ~(1 << irq);
+    pic_write_mask(irq);
+    if ( irq > 7 && (pic_mask_cache & (1 << PIC_CASCADE_IRQ)) ) {
+        pic_mask_cache &= ~(1 << PIC_CASCADE_IRQ);
+        pic_write_mask(PIC_CASCADE_IRQ);
+    }
+}
+
+    /** @brief The cached mask of both PICs, master in the low byte. */
+unsigned short
+pic_get_mask(void)
+{
+    return pic_mask_cache;
+}
+
+    /** @brief Tell whether an IRQ is in service, from the ISR register.
+     *
+     * Used to tell a real IRQ7/IRQ15 from a spurious one: the PIC raises
+     * the lowest priority line of a chip when a request goes away before
+     * it is acknowledged, without setting its bit in the ISR.
+     *
+     * @param irq The IRQ, 0-7 on the master and 8-15 on the slave.
+     * @return Non zero if the IRQ is in service.
+     */
+int
+pic_in_service(unsigned char irq)
+{
+    if ( irq <= 7 ) {
+        outb( MASTER_ICW, OCW_TEMPLATE | READ_NEXT_RD | READ_IS_ONRD );
+        return inb( MASTER_ICW ) & (1 << irq);
+    } else if ( irq <= 15 ) {
+        outb(  SLAVE_ICW, OCW_TEMPLATE | READ_NEXT_RD | READ_IS_ONRD );
+        return inb(  SLAVE_ICW ) & (1 << (irq & 0x07));
+    }
+    return 0;
 }
 
     /** @brief Acknowledge the master or slave correctly, based on the
@@ -211,12 +211,25 @@ WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
     /** @brief Default location of the slave  PIC's interrupts in the IDT */
 #define X86_PIC_SLAVE_IRQ_BASE      0x28
 
+    /** @brief Master line the slave PIC is wired to */
+#define PIC_CASCADE_IRQ             2
+    /** @brief Lowest priority line of the master, where it signals spurious
+     *         interrupts */
+#define PIC_SPURIOUS_MASTER_IRQ     7
+    /** @brief Lowest priority line of the slave, where it signals spurious
+     *         interrupts */
+#define PIC_SPURIOUS_SLAVE_IRQ      15
+
 #ifndef ASSEMBLER
 
 void pic_init( unsigned char , unsigned char );
 void pic_acknowledge( unsigned char );
 void pic_acknowledge_any_master(void);
 void pic_acknowledge_any_slave(void);
+void pic_mask( unsigned char );
+void pic_unmask( unsigned char );
+unsigned short pic_get_mask(void);
+int pic_in_service( unsigned char );
 
 #endif  /* !ASSEMBLER */
 
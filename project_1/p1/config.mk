@@ -30,8 +30,9 @@ TABSTOP = 8
 # the object files which make up your drivers.
 ##################################################
 #
-COMMON_OBJS = console_driver.o timer_driver.o timer_driver_asm.o interrupt_handlers.o \
-keyboard_driver.o keyboard_driver_asm.o 
+COMMON_OBJS = console_driver.o timer_driver.o timer_wheel.o interrupt_handlers.o \
+keyboard_driver.o work_queue.o irq.o irq_stubs.o \
+clock.o lapic.o lapic_asm.o 
 
 ##################################################
 # Object files from 410kern/ for just the game
@@ -48,7 +49,49 @@ keyboard_driver.o keyboard_driver_asm.o
 # multiple parts.
 ##################################################
 #
-KERN_GAME_OBJS = game.o game_helper.o
+KERN_GAME_OBJS = game.o game_helper.o flood.o bitboard.o solver.o hint.o \
+status_line.o replay.o leaderboard.o
+
+##################################################
+# Memory manager behind malloc: "list" keeps each
+# region's free blocks on one address ordered list,
+# "segregated" on size bins plus an address treap
+# (410kern/lmm/lmm_seg.c). Run make clean after
+# changing it.
+##################################################
+#
+LMM_VARIANT = segregated
+
+##################################################
+# MALLOC_STATS = 1 makes malloc count chunks and
+# bytes per size class and keep every live chunk
+# with its call site; the 'l' key on the title
+# screen logs it (410kern/malloc/malloc_stats.h).
+# Run make clean after changing it.
+##################################################
+#
+MALLOC_STATS = 0
+
+##################################################
+# MALLOC_DEBUG = 1 builds malloc with a debug heap:
+# red zones, canaries, poisoning of freed chunks
+# and a quarantine, audited every few seconds while
+# the game waits for or reads a key, arenas
+# included (malloc_debug.h).
+# Run make clean after changing it.
+##################################################
+#
+MALLOC_DEBUG = 0
+
+##################################################
+# Timer behind the game: "pit" keeps the 8259 and
+# the PIT, "lapic" moves it to the local APIC timer
+# where CPUID reports one (e.g. QEMU with -machine
+# q35), falling back to the PIT where it does not
+# (kern/lapic.h). Run make clean after changing it.
+##################################################
+#
+TIMER_BACKEND = pit
 
 ##################################################
 # Object files from 410kern/ for just the tester
@@ -0,0 +1,204 @@
+/** @file bitboard.c
+ *
+ *  @brief Implementation of the bitboard game state
+ *
+ *  What it contains :
+ *
+ *  -- Dilation: a set grows by one block in every direction with word
+ *  shifts. Left and right are shifts by one bit, up and down are
+ *  shifts by one row (16 bits) carried between words. The result is
+ *  masked with the blocks the region may take over
+ *  -- Flooding repeats the dilation until the set stops changing, each
+ *  round is BITBOARD_WORDS words of straight line code
+ *  -- The frontier (blocks next to the region) is kept up to date, so a
+ *  move only floods from the frontier blocks of its colour and costs
+ *  as many rounds as the blocks it gains are wide
+ *  -- Counting uses a SWAR popcount, so no libgcc helper is needed
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "bitboard.h"
+
+/** @brief Bits in the lower half of a word, one row */
+#define ROW_BITS 16
+
+/** @brief Number of bits set in a word */
+static int popcount32(uint32_t x)
+{
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0F0F0F0F;
+	return (x * 0x01010101) >> 24;
+}
+
+/** @brief A set and the blocks next to it
+ */
+void bitset_dilate(const bitset_t *set, bitset_t *out)
+{
+	uint32_t prev = 0,next;
+	int i;
+
+	for (i = 0; i < BITBOARD_WORDS; i++)
+	{
+		next = i + 1 < BITBOARD_WORDS ? set->w[i + 1] : 0;
+		out->w[i] = set->w[i] | (set->w[i] << 1) | (set->w[i] >> 1) |
+			(set->w[i] << ROW_BITS) | (prev >> ROW_BITS) |
+			(set->w[i] >> ROW_BITS) | (next << ROW_BITS);
+		prev = set->w[i];
+	}
+}
+
+/** @brief Grow a set until it covers its connected part of allowed
+ */
+void bitset_flood(bitset_t *set, const bitset_t *allowed)
+{
+	bitset_t grown;
+	uint32_t changed;
+	int i;
+
+	do
+	{
+		changed = 0;
+		bitset_dilate(set,&grown);
+		for (i = 0; i < BITBOARD_WORDS; i++)
+		{
+			grown.w[i] &= allowed->w[i];
+			changed |= grown.w[i] ^ set->w[i];
+			set->w[i] = grown.w[i];
+		}
+	} while (changed);
+}
+
+/** @brief Number of blocks in a set
+ */
+int bitset_count(const bitset_t *set)
+{
+	int i,count = 0;
+	for (i = 0; i < BITBOARD_WORDS; i++)
+		count += popcount32(set->w[i]);
+	return count;
+}
+
+/** @brief Whether a block is in a set
+ */
+int bitset_test(const bitset_t *set, int row, int col)
+{
+	int bit = row * BITBOARD_STRIDE + col;
+	return (set->w[bit >> 5] >> (bit & 31)) & 1;
+}
+
+/** @brief Blocks that join the region when it takes a colour
+ *
+ *  Grows the frontier blocks of that colour within the colour plane,
+ *  so the cost depends on the blocks gained, not on the region.
+ *
+ *  @param board Board
+ *  @param plane Plane of the colour
+ *  @param gained Where the blocks are stored
+ */
+static void bitboard_gained(const bitboard_t *board, int plane,
+		bitset_t *gained)
+{
+	bitset_t allowed;
+	uint32_t any = 0;
+	int i;
+
+	for (i = 0; i < BITBOARD_WORDS; i++)
+	{
+		gained->w[i] = board->frontier.w[i] & board->plane[plane].w[i];
+		allowed.w[i] = board->plane[plane].w[i] & ~board->region.w[i];
+		any |= gained->w[i];
+	}
+	if (any)
+		bitset_flood(gained,&allowed);
+}
+
+/** @brief Recompute the frontier around a set that joined the region
+ *
+ *  @param board Board, with the region already grown
+ *  @param added Blocks that joined
+ */
+static void bitboard_frontier(bitboard_t *board, const bitset_t *added)
+{
+	bitset_t around;
+	int i;
+
+	bitset_dilate(added,&around);
+	for (i = 0; i < BITBOARD_WORDS; i++)
+		board->frontier.w[i] = (board->frontier.w[i] | around.w[i]) &
+			board->mask.w[i] & ~board->region.w[i];
+}
+
+/** @brief Build a board from one BGND_* colour per block
+ */
+int bitboard_load(bitboard_t *board, const uint8_t *cells, int rows,
+		int cols)
+{
+	int row,col,bit;
+	bitset_t *plane;
+
+	if (rows <= 0 || cols <= 0 || rows > BITBOARD_MAX_ROWS ||
+			cols > BITBOARD_MAX_COLS)
+		return -1;
+	memset(board,0,sizeof(*board));
+	for (row = 0; row < rows; row++)
+	{
+		for (col = 0; col < cols; col++)
+		{
+			bit = row * BITBOARD_STRIDE + col;
+			plane = &board->plane[BITBOARD_PLANE(cells[row * cols + col])];
+			plane->w[bit >> 5] |= 1u << (bit & 31);
+			board->mask.w[bit >> 5] |= 1u << (bit & 31);
+		}
+	}
+	board->cells = rows * cols;
+	board->color = BITBOARD_PLANE(cells[0]);
+	board->region.w[0] = 1;
+	bitset_flood(&board->region,&board->plane[board->color]);
+	bitboard_frontier(board,&board->region);
+	return 1;
+}
+
+/** @brief Flood the region with a colour
+ */
+int bitboard_move(bitboard_t *board, int plane)
+{
+	bitset_t gained;
+	int i;
+
+	if (plane == board->color)
+		return 0;
+	bitboard_gained(board,plane,&gained);
+	for (i = 0; i < BITBOARD_WORDS; i++)
+	{
+		board->plane[board->color].w[i] &= ~board->region.w[i];
+		board->plane[plane].w[i] |= board->region.w[i];
+		board->region.w[i] |= gained.w[i];
+	}
+	board->color = plane;
+	bitboard_frontier(board,&gained);
+	return bitset_count(&gained);
+}
+
+/** @brief Blocks a move would add to the region, without making it
+ */
+int bitboard_gain(const bitboard_t *board, int plane)
+{
+	bitset_t gained;
+
+	if (plane == board->color)
+		return 0;
+	bitboard_gained(board,plane,&gained);
+	return bitset_count(&gained);
+}
+
+/** @brief Whether the region covers the board
+ */
+int bitboard_is_done(const bitboard_t *board)
+{
+	return bitset_count(&board->region) == board->cells;
+}
@@ -0,0 +1,133 @@
+/** @file bitboard.h
+ *  @brief Bitboard representation of the game board
+ *
+ *  Every colour has a plane with one bit per block of that colour,
+ *  and one more set holds the flooded region (the blocks connected to
+ *  the top left block). A move recolours the region and grows it by
+ *  shift and mask dilation against the plane of the new colour, so it
+ *  needs no per-block branches. The game is over when the region
+ *  holds every block.
+ *
+ *  Block (row, col) is bit row * BITBOARD_STRIDE + col. Rows are 16
+ *  bits apart and at most 15 columns are used, so the spare column
+ *  keeps a horizontal shift from leaking into the next row.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _BITBOARD_H_
+#define _BITBOARD_H_
+
+#include <stdint.h>
+
+/** @brief Bits between the start of two rows */
+#define BITBOARD_STRIDE 16
+
+/** @brief Largest number of rows */
+#define BITBOARD_MAX_ROWS 16
+
+/** @brief Largest number of columns, one less than the stride */
+#define BITBOARD_MAX_COLS (BITBOARD_STRIDE - 1)
+
+/** @brief 32 bit words in a set */
+#define BITBOARD_WORDS (BITBOARD_MAX_ROWS * BITBOARD_STRIDE / 32)
+
+/** @brief Number of colour planes */
+#define BITBOARD_COLORS 8
+
+/** @brief Plane of a BGND_* block colour */
+#define BITBOARD_PLANE(color) (((color) >> 4) & (BITBOARD_COLORS - 1))
+
+/** @brief BGND_* block colour of a plane */
+#define BITBOARD_COLOR(plane) ((plane) << 4)
+
+/** @brief Set of blocks */
+typedef struct bitset {
+	/** @brief Two rows per word, the even row in the low half */
+	uint32_t w[BITBOARD_WORDS];
+} bitset_t;
+
+/** @brief Game board */
+typedef struct bitboard {
+	/** @brief Blocks of each colour */
+	bitset_t plane[BITBOARD_COLORS];
+	/** @brief Blocks connected to the top left block */
+	bitset_t region;
+	/** @brief Blocks next to the region, not in it */
+	bitset_t frontier;
+	/** @brief Blocks on the board */
+	bitset_t mask;
+	/** @brief Number of blocks on the board */
+	int cells;
+	/** @brief Plane of the region */
+	int color;
+} bitboard_t;
+
+/** @brief Number of blocks in a set
+ *
+ *  @param set Set
+ *  @return Number of bits set
+ */
+int bitset_count(const bitset_t *set);
+
+/** @brief Whether a block is in a set
+ *
+ *  @param set Set
+ *  @param row Row of the block
+ *  @param col Column of the block
+ *  @return Non zero if it is
+ */
+int bitset_test(const bitset_t *set, int row, int col);
+
+/** @brief A set and the blocks next to it
+ *
+ *  @param set Set
+ *  @param out Where the grown set is stored, not masked with the board
+ *  @return void
+ */
+void bitset_dilate(const bitset_t *set, bitset_t *out);
+
+/** @brief Grow a set until it covers its connected part of allowed
+ *
+ *  @param set Set, must be a subset of allowed
+ *  @param allowed Blocks the set may grow into
+ *  @return void
+ */
+void bitset_flood(bitset_t *set, const bitset_t *allowed);
+
+/** @brief Build a board from one BGND_* colour per block
+ *
+ *  @param board Board to fill in
+ *  @param cells Colours, row major
+ *  @param rows Rows, at most BITBOARD_MAX_ROWS
+ *  @param cols Columns, at most BITBOARD_MAX_COLS
+ *  @return 1 on success, -1 if the board is too large
+ */
+int bitboard_load(bitboard_t *board, const uint8_t *cells, int rows,
+		int cols);
+
+/** @brief Flood the region with a colour
+ *
+ *  @param board Board
+ *  @param plane Plane of the new colour
+ *  @return Number of blocks that joined the region
+ */
+int bitboard_move(bitboard_t *board, int plane);
+
+/** @brief Blocks a move would add to the region, without making it
+ *
+ *  @param board Board
+ *  @param plane Plane of the colour
+ *  @return Number of blocks that would join the region
+ */
+int bitboard_gain(const bitboard_t *board, int plane);
+
+/** @brief Whether the region covers the board
+ *
+ *  @param board Board
+ *  @return Non zero if the game is over
+ */
+int bitboard_is_done(const bitboard_t *board);
+
+#endif /* _BITBOARD_H_ */
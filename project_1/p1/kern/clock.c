@@ -0,0 +1,119 @@
+/** @file clock.c
+ *
+ *  @brief Implementation of the TSC based clock source
+ *
+ *  What it contains :
+ *
+ *  1. Calibration :
+ *
+ *  -- PIT channel 2 is loaded in one-shot mode for
+ *  CLOCK_CALIBRATE_COUNTS counts and the TSC is read when it is
+ *  started and when its output goes high
+ *  -- Channel 2 is gated through port 0x61, so channel 0 (the timer
+ *  interrupt) is left alone
+ *  -- The shortest of a few runs is kept, a longer one means we were
+ *  held up between reading the TSC and the port
+ *
+ *  2. Conversion :
+ *
+ *  -- Nanoseconds are (cycles * mult) >> CLOCK_SHIFT with mult
+ *  computed once from the calibrated frequency
+ *  -- The cycles are split at CLOCK_SHIFT so that the product does
+ *  not overflow 64 bits however long the kernel runs
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Assumes an invariant TSC (constant rate, not stopped in halt)
+ */
+
+#include <asm.h>
+#include <eflags.h>
+#include "clock.h"
+
+/** @brief Calibrated TSC frequency in Hz */
+static uint64_t clock_freq = 0;
+
+/** @brief Cycles to nanoseconds factor, shifted by CLOCK_SHIFT */
+static uint64_t clock_mult = 0;
+
+/** @brief TSC read at the end of the calibration */
+static uint64_t clock_base = 0;
+
+/** @brief Measure one calibration run
+ *
+ *  @return TSC cycles taken by CLOCK_CALIBRATE_COUNTS PIT counts
+ */
+static uint64_t clock_calibrate_run()
+{
+	uint64_t start,end;
+	uint8_t gate;
+
+	/* Gate low while loading so the count does not start early */
+	gate = inb(CLOCK_GATE_PORT) & ~(CLOCK_GATE_BIT | CLOCK_SPEAKER_BIT);
+	outb(CLOCK_GATE_PORT,gate);
+	outb(TIMER_MODE_IO_PORT,CLOCK_PIT_CH2_ONE_SHOT);
+	outb(CLOCK_PIT_CH2_PORT,CLOCK_CALIBRATE_COUNTS & 0xFF);
+	outb(CLOCK_PIT_CH2_PORT,(CLOCK_CALIBRATE_COUNTS >> 8) & 0xFF);
+
+	outb(CLOCK_GATE_PORT,gate | CLOCK_GATE_BIT);
+	start = rdtsc();
+	while (!(inb(CLOCK_GATE_PORT) & CLOCK_OUT2_BIT))
+		continue;
+	end = rdtsc();
+
+	outb(CLOCK_GATE_PORT,gate);
+	return end - start;
+}
+
+/** @brief Calibrate the TSC against the PIT
+ */
+void clock_init(void)
+{
+	uint32_t flags;
+	uint64_t cycles,best = 0;
+	int i;
+
+	flags = get_eflags();
+	disable_interrupts();
+	for (i = 0; i < CLOCK_CALIBRATE_RUNS; i++)
+	{
+		cycles = clock_calibrate_run();
+		if (best == 0 || cycles < best)
+			best = cycles;
+	}
+	clock_base = rdtsc();
+	set_eflags(flags);
+
+	clock_freq = best * TIMER_RATE / CLOCK_CALIBRATE_COUNTS;
+	if (clock_freq != 0)
+		clock_mult = (CLOCK_NS_PER_SEC << CLOCK_SHIFT) / clock_freq;
+}
+
+/** @brief Calibrated TSC frequency
+ */
+uint64_t clock_hz(void)
+{
+	return clock_freq;
+}
+
+/** @brief Cycles elapsed since clock_init()
+ */
+uint64_t clock_cycles(void)
+{
+	return rdtsc() - clock_base;
+}
+
+/** @brief Convert TSC cycles to nanoseconds
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+	uint64_t high = cycles >> CLOCK_SHIFT;
+	uint64_t low = cycles & ((1ULL << CLOCK_SHIFT) - 1);
+	return high * clock_mult + ((low * clock_mult) >> CLOCK_SHIFT);
+}
+
+/** @brief Nanoseconds elapsed since clock_init()
+ */
+uint64_t clock_ns(void)
+{
+	return clock_cycles_to_ns(clock_cycles());
+}
@@ -0,0 +1,82 @@
+/** @file clock.h
+ *  @brief TSC based clock source
+ *
+ *  The time stamp counter is calibrated once against PIT channel 2.
+ *  After that, reading the clock is a single rdtsc and a multiply,
+ *  without any port I/O.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Assumes an invariant TSC (constant rate, not stopped in halt)
+ */
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <stdint.h>
+#include <timer_defines.h>
+
+/** @brief Data port of PIT channel 2 */
+#define CLOCK_PIT_CH2_PORT 0x42
+
+/** @brief PIT command: channel 2, low then high byte, mode 0, binary */
+#define CLOCK_PIT_CH2_ONE_SHOT 0xB0
+
+/** @brief System control port B, gates PIT channel 2 */
+#define CLOCK_GATE_PORT 0x61
+
+/** @brief Gate input of PIT channel 2 in port B */
+#define CLOCK_GATE_BIT 0x01
+
+/** @brief Speaker enable in port B, kept off while calibrating */
+#define CLOCK_SPEAKER_BIT 0x02
+
+/** @brief Output of PIT channel 2 as read back from port B */
+#define CLOCK_OUT2_BIT 0x20
+
+/** @brief PIT counts of one calibration run (10 ms) */
+#define CLOCK_CALIBRATE_COUNTS (TIMER_RATE / 100)
+
+/** @brief Calibration runs, the shortest one is kept */
+#define CLOCK_CALIBRATE_RUNS 3
+
+/** @brief Fixed point shift of the cycles to nanoseconds factor */
+#define CLOCK_SHIFT 24
+
+/** @brief Nanoseconds in a second */
+#define CLOCK_NS_PER_SEC 1000000000ULL
+
+/** @brief Calibrate the TSC against the PIT
+ *
+ *  Called from handler_install(). Busy waits for about
+ *  CLOCK_CALIBRATE_RUNS * 10 ms with interrupts disabled.
+ *
+ *  @return void
+ */
+void clock_init(void);
+
+/** @brief Calibrated TSC frequency
+ *
+ *  @return TSC cycles per second, 0 before clock_init()
+ */
+uint64_t clock_hz(void);
+
+/** @brief Cycles elapsed since clock_init()
+ *
+ *  @return TSC cycles
+ */
+uint64_t clock_cycles(void);
+
+/** @brief Convert TSC cycles to nanoseconds
+ *
+ *  @param cycles Cycles to convert
+ *  @return Nanoseconds, 0 before clock_init()
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/** @brief Nanoseconds elapsed since clock_init()
+ *
+ *  @return Nanoseconds
+ */
+uint64_t clock_ns(void);
+
+#endif /* _CLOCK_H_ */
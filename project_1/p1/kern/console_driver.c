@@ -66,6 +66,8 @@
 #include <video_defines.h>/* Contains all constants related to console */
 #include <string.h>/*Contains string related functions*/
 #include <malloc.h>
+#include <malloc/arena.h>
+#include "console_driver.h"
 
 #define TRUE 1 
 #define FALSE 0 
@@ -84,6 +86,9 @@
 /** @brief Terminal color variable */
 uint8_t terminal_color = FGND_WHITE | BGND_BLACK; /*Default terminal color*/
 
+/** @brief Scratch memory of scroll_one_line(), reset after every scroll */
+static arena_t console_arena;
+
 /** @brief Hide location of cursor
  *
  * This macro defines the first hidden location for cursor
@@ -392,7 +397,7 @@ void clear_console_mem(void * addr, int num_char)
 void scroll_one_line()
 {
 	int buflen = 2*(CONSOLE_HEIGHT-1) *(CONSOLE_WIDTH);
-	void * buf = malloc(buflen);
+	void * buf = arena_alloc(&console_arena,buflen);
 	if (buf == NULL)
 	{
 		return;
@@ -402,15 +407,16 @@ void scroll_one_line()
 	void * temp = memcpy(buf,mem_start_cpy,buflen);
 	if (temp == NULL)
 	{
+		arena_reset(&console_arena);
 		return;
 	}
 	temp = memcpy((void *)CONSOLE_MEM_BASE,(const void *)buf,buflen);
 
+	arena_reset(&console_arena);
 	if (temp == NULL)
 	{
 		return;
 	}
-	free(buf);
 	/*Clearing the last line is pending */
 	void * start_mem = (void*) CONSOLE_MEM_BASE + buflen;
 	clear_console_mem(start_mem,CONSOLE_WIDTH);
@@ -703,6 +709,58 @@ draw_char( int row, int col, int ch, int color )
 	}
 }
 
+/** @brief Draw a run of identical characters on one row
+ *
+ *  Writes the cells straight to video memory, without going through
+ *  the cursor registers for each of them like draw_char() does. The
+ *  run is clipped to the row.
+ *
+ *  @param row Row of the run
+ *  @param col First column of the run
+ *  @param len Number of characters
+ *  @param ch Character
+ *  @param color Color of the characters
+ *  @return void
+ */
+void draw_char_span(int row, int col, int len, int ch, int color)
+{
+	volatile uint16_t *cell;
+	uint16_t value = (uint16_t)((GET_LSB(color) << EIGHT) | GET_LSB(ch));
+
+	if (row < 0 || row >= CONSOLE_HEIGHT || col < 0 || col >= CONSOLE_WIDTH)
+		return;
+	if (len > CONSOLE_WIDTH - col)
+		len = CONSOLE_WIDTH - col;
+	cell = (volatile uint16_t *)CONSOLE_MEM_BASE + row * CONSOLE_WIDTH + col;
+	while (len-- > 0)
+		*cell++ = value;
+}
+
+/** @brief Draw a string on one row
+ *
+ *  Like draw_char_span(), but with a different character per cell.
+ *
+ *  @param row Row of the string
+ *  @param col First column of the string
+ *  @param str Characters, need not be NUL terminated
+ *  @param len Number of characters
+ *  @param color Color of the characters
+ *  @return void
+ */
+void draw_char_run(int row, int col, const char *str, int len, int color)
+{
+	volatile uint16_t *cell;
+	uint16_t attr = (uint16_t)(GET_LSB(color) << EIGHT);
+
+	if (row < 0 || row >= CONSOLE_HEIGHT || col < 0 || col >= CONSOLE_WIDTH)
+		return;
+	if (len > CONSOLE_WIDTH - col)
+		len = CONSOLE_WIDTH - col;
+	cell = (volatile uint16_t *)CONSOLE_MEM_BASE + row * CONSOLE_WIDTH + col;
+	while (len-- > 0)
+		*cell++ = attr | (uint8_t)*str++;
+}
+
 /*
  * Gets the character from console location 
  */
@@ -0,0 +1,33 @@
+/** @file console_driver.h
+ *  @brief Console helpers beyond the p1kern.h interface
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _CONSOLE_DRIVER_H_
+#define _CONSOLE_DRIVER_H_
+
+/** @brief Draw a run of identical characters on one row
+ *
+ *  @param row Row of the run
+ *  @param col First column of the run
+ *  @param len Number of characters, clipped to the row
+ *  @param ch Character
+ *  @param color Color of the characters
+ *  @return void
+ */
+void draw_char_span(int row, int col, int len, int ch, int color);
+
+/** @brief Draw a string on one row
+ *
+ *  @param row Row of the string
+ *  @param col First column of the string
+ *  @param str Characters, need not be NUL terminated
+ *  @param len Number of characters, clipped to the row
+ *  @param color Color of the characters
+ *  @return void
+ */
+void draw_char_run(int row, int col, const char *str, int len, int color);
+
+#endif /* _CONSOLE_DRIVER_H_ */
@@ -0,0 +1,109 @@
+/** @file flood.c
+ *
+ *  @brief Implementation of the scanline flood fill
+ *
+ *  What it contains :
+ *
+ *  -- Span filling: a popped span is extended to the left, then every
+ *  run of old colour cells under it is painted in one go
+ *  -- The row the span came from is only searched again where the run
+ *  sticks out beyond the span, so each cell is read a small constant
+ *  number of times
+ *  -- Pending spans live on a fixed array, never on the kernel stack
+ *  -- Every painted run is handed to the span callback, which lets the
+ *  console be updated one row run at a time
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include "flood.h"
+
+/** @brief Pending spans of the fill */
+static flood_span_t flood_stack[FLOOD_MAX_SPANS];
+
+/** @brief Whether a cell is inside the board and still the old colour */
+#define FLOOD_INSIDE(x,y) ((x) >= 0 && (x) < cols && \
+		board[(y) * cols + (x)] == old_color)
+
+/** @brief Push a span, dropping rows outside the board */
+#define FLOOD_PUSH(a,b,row,d) do { \
+	if ((row) >= 0 && (row) < rows) \
+	{ \
+		if (top == FLOOD_MAX_SPANS) \
+			return FLOOD_OVERFLOW; \
+		flood_stack[top].x1 = (a); \
+		flood_stack[top].x2 = (b); \
+		flood_stack[top].y = (row); \
+		flood_stack[top].dy = (d); \
+		top++; \
+	} \
+} while (0)
+
+/** @brief Recolour the region connected to a cell
+ */
+int flood_fill(uint8_t *board, int rows, int cols, int row, int col,
+		uint8_t new_color, flood_span_fn span_fn, void *arg)
+{
+	uint8_t old_color;
+	uint8_t *line;
+	int top = 0,filled = 0;
+	int x,x1,x2,y,dy;
+
+	if (row < 0 || row >= rows || col < 0 || col >= cols)
+		return 0;
+	old_color = board[row * cols + col];
+	if (old_color == new_color)
+		return 0;
+
+	FLOOD_PUSH(col,col,row,1);
+	FLOOD_PUSH(col,col,row - 1,-1);
+	while (top > 0)
+	{
+		top--;
+		x1 = flood_stack[top].x1;
+		x2 = flood_stack[top].x2;
+		y = flood_stack[top].y;
+		dy = flood_stack[top].dy;
+		line = board + y * cols;
+		x = x1;
+
+		/* Extend to the left of the span */
+		if (FLOOD_INSIDE(x,y))
+		{
+			while (FLOOD_INSIDE(x - 1,y))
+			{
+				x--;
+				line[x] = new_color;
+			}
+			if (x < x1)
+				FLOOD_PUSH(x,x1 - 1,y - dy,-dy);
+		}
+		while (x1 <= x2)
+		{
+			/* Paint the run starting at x1 */
+			while (FLOOD_INSIDE(x1,y))
+			{
+				line[x1] = new_color;
+				x1++;
+			}
+			if (x1 > x)
+			{
+				filled += x1 - x;
+				if (span_fn != NULL)
+					(*span_fn)(y,x,x1 - 1,new_color,arg);
+				FLOOD_PUSH(x,x1 - 1,y + dy,dy);
+				/* Where the run sticks out, look back as well */
+				if (x1 - 1 > x2)
+					FLOOD_PUSH(x2 + 1,x1 - 1,y - dy,-dy);
+			}
+			/* Skip to the next run under the span */
+			x1++;
+			while (x1 < x2 && !FLOOD_INSIDE(x1,y))
+				x1++;
+			x = x1;
+		}
+	}
+	return filled;
+}
@@ -0,0 +1,70 @@
+/** @file flood.h
+ *  @brief Scanline flood fill over the game board
+ *
+ *  The board is one byte per cell, row major, as kept in
+ *  game_state_buf. The fill needs no console and no recursion, so it
+ *  also builds on the host (see tests/flood_bench.c).
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _FLOOD_H_
+#define _FLOOD_H_
+
+#include <stdint.h>
+
+/** @brief Spans the fill can have pending at once
+ *
+ *  Every pending span is a run of filled cells, and each one queues
+ *  at most two spans above and below it, so rows * (cols + 1) always
+ *  suffices. Large host boards override this at build time.
+ */
+#ifndef FLOOD_MAX_SPANS
+#define FLOOD_MAX_SPANS 1024
+#endif
+
+/** @brief Returned when the span stack ran out */
+#define FLOOD_OVERFLOW -1
+
+/** @brief Called for every run of cells the fill recolours
+ *
+ *  @param row Row of the run
+ *  @param col_start First column of the run
+ *  @param col_end Last column of the run
+ *  @param color New colour of the run
+ *  @param arg Argument given to flood_fill()
+ */
+typedef void (*flood_span_fn)(int row, int col_start, int col_end,
+		uint8_t color, void *arg);
+
+/** @brief Pending span of the fill */
+typedef struct flood_span {
+	/** @brief First column to look at */
+	int16_t x1;
+	/** @brief Last column to look at */
+	int16_t x2;
+	/** @brief Row to look at */
+	int16_t y;
+	/** @brief Direction (+1/-1) of the row it came from */
+	int16_t dy;
+} flood_span_t;
+
+/** @brief Recolour the region connected to a cell
+ *
+ *  @param board Cells, row major
+ *  @param rows Rows of the board
+ *  @param cols Columns of the board
+ *  @param row Row of the start cell
+ *  @param col Column of the start cell
+ *  @param new_color Colour the region is painted with
+ *  @param span_fn Called for every recoloured run, may be NULL
+ *  @param arg Argument to span_fn
+ *
+ *  @return Cells recoloured, or FLOOD_OVERFLOW if the span stack ran
+ *  out (the region is then only partly recoloured)
+ */
+int flood_fill(uint8_t *board, int rows, int cols, int row, int col,
+		uint8_t new_color, flood_span_fn span_fn, void *arg);
+
+#endif /* _FLOOD_H_ */
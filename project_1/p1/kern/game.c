@@ -28,6 +28,7 @@
 #include <string.h>
 #include <mt19937int.h>
 #include "game_helper.h"
+#include "timer_driver.h"
 
 
 /** @brief Kernel entrypoint.
@@ -44,6 +45,17 @@ int kernel_main(mbinfo_t *mbinfo, int argc, char **argv, char **envp)
      */
     handler_install(tick);
 
+#ifdef TIMER_LAPIC
+	/* TIMER_BACKEND = lapic in config.mk: use the local APIC timer where 
+	 * there is one, it is cheaper to acknowledge than the 8259 */
+	if (timer_set_backend(TIMER_BACKEND_LAPIC) < 0)
+		lprintf("No local APIC, timer stays on the PIT");
+#endif
+
+	/* The game only has work once a second, so let the timer 
+	 * interrupt on deadlines rather than on every tick */
+	timer_set_mode(TIMER_MODE_DEADLINE,NUMBER_CYCLES);
+
     /*
      * When kernel_main() begins, interrupts are DISABLED.
      * You should delete this comment, and enable them --
@@ -33,8 +33,22 @@
  *  @bug No known bugs
  */
 
+#include <stdlib.h>
 #include "game_helper.h"
 #include "game_helper_private.h"
+#include "timer_driver.h"
+#include "interrupt_handlers.h"
+#include "flood.h"
+#include "console_driver.h"
+#include "solver.h"
+#include "hint.h"
+#include "status_line.h"
+#include "replay.h"
+#include "leaderboard.h"
+#include "clock.h"
+#include <malloc/malloc_debug.h>
+#include <malloc/malloc_stats.h>
+#include <malloc/zero_pool.h>
 
 /** @brief Wait for the input character
  *  
@@ -52,7 +66,9 @@ void wait_char(char ch)
 	char read; 
 	while((read=readchar()) != ch)
 	{
-		continue;
+		/* Nothing else to do: zero a page for calloc */
+		zero_pool_fill(1);
+		heap_audit_poll();
 	}
 }
 
@@ -71,16 +87,15 @@ char wait_key_press()
 	char read = readchar();
 	while((read=readchar()) == ERROR)
 	{
-		continue;
+		zero_pool_fill(1);
+		heap_audit_poll();
 	}
 	return read;
 }
 /** @brief Tick function, to be called by the timer interrupt handler
  * 
- *  This function helps in following actions : 
- *
- *  1. This is used for running the timer
- *  2. This is used for blinking the cursor
+ *  Records the current tick. The periodic work is done by the 
+ *  clock_tick() and blink_tick() timers registered on the timer wheel.
  *
  *  @param numTicks Number of timer interrupts  
  *
@@ -88,36 +103,92 @@ char wait_key_press()
 void tick(unsigned int numTicks)
 {
 	timer_ticks = numTicks;
-    if (numTicks % NUMBER_CYCLES == 0)
-    {
-		int actual_cursor_row,actual_cursor_col;
-		if (!pause) 
+}
+
+/** @brief Clock timer, runs once a second
+ *
+ *  Runs the game clock and refreshes the time and iteration fields.
+ *  The fields write to video memory directly, the cursor is left
+ *  alone.
+ *
+ *  @param arg Unused
+ *  @return void
+ */
+void clock_tick(void *arg)
+{
+	char text[STATUS_FIELD_MAX];
+	int len;
+	if (!pause) 
+	{
+		seconds++;
+	} 
+	if (start)
+	{
+		/* MM:SS, only the digits that changed reach the console */
+		len = status_append_uint(text,0,seconds/SIXTY_SECONDS,2);
+		len = status_append_str(text,len,":");
+		len = status_append_uint(text,len,seconds%SIXTY_SECONDS,2);
+		status_field_set(&time_field,text,len);
+
+		len = status_append_str(text,0,"Current Iteration:");
+		len = status_append_uint(text,len,curr_user_iteration+1,1);
+		len = status_append_str(text,len,"/");
+		len = status_append_uint(text,len,max_iterations,1);
+		status_field_set(&iteration_field,text,len);
+	}
+}
+
+/** @brief Blink timer, toggles the cursor
+ *
+ *  @param arg Unused
+ *  @return void
+ */
+void blink_tick(void *arg)
+{
+	if (start)
+	{
+		if(cursor_hidden)
 		{
-			seconds++;
-		} 
-		if (start)
+			cursor_hidden = FALSE;
+			show_cursor();
+		} else 
 		{
-			get_cursor(&actual_cursor_row,&actual_cursor_col);
-			set_cursor(start_y-1,end_x + VAL_SEPARATOR);
-			printf("%02d:%02d",seconds/SIXTY_SECONDS,
-					seconds%SIXTY_SECONDS);
-			set_cursor(end_y+4,start_x+matrix_wid/2-8);
-			printf("Current Iteration:%d/%d",curr_user_iteration+1,max_iterations);
-			set_cursor(actual_cursor_row,actual_cursor_col);
-
-			/* Blink */
-			if(cursor_hidden)
-			{
-				cursor_hidden = FALSE;
-				show_cursor();
-			} else 
-			{
-				cursor_hidden = TRUE;
-				hide_cursor();
-			}
+			cursor_hidden = TRUE;
+			hide_cursor();
 		}
+	}
+}
+
+/** @brief Set by heap_audit_tick(), cleared by heap_audit_poll() */
+static volatile int heap_audit_due;
+
+/** @brief Audit timer, marks an audit of the debug heap as due
+ *
+ *  Registered only when malloc is built with MALLOC_DEBUG. It runs in
+ *  the timer interrupt, which may have interrupted malloc, so the audit
+ *  itself is left to heap_audit_poll().
+ *
+ *  @param arg Unused
+ *  @return void
+ */
+void heap_audit_tick(void *arg)
+{
+	heap_audit_due = 1;
+}
 
-    }
+/** @brief Audit the debug heap if the audit timer asked for it
+ *
+ *  Called from the loops waiting for a key and from the game's key
+ *  loop between keys, outside any handler and any malloc call; corruption panics from inside the audit.
+ *
+ *  @return void
+ */
+void heap_audit_poll()
+{
+	if (!heap_audit_due)
+		return;
+	heap_audit_due = 0;
+	malloc_debug_audit();
 }
 
 /** @brief Clear one row 
@@ -271,9 +342,63 @@ void draw_screen_sidebar()
 	set_cursor(start_y+4,end_x + VAL_SEPARATOR);
 	printf("quit");
 
+	set_cursor(start_y+5,end_x + TEXT_SEPARATOR);
+	printf("n");
+
+	set_cursor(start_y+5,end_x + VAL_SEPARATOR);
+	printf("hint");
+
+	/* The console under the status fields is blank again */
+	status_field_init(&time_field,start_y-1,end_x + VAL_SEPARATOR,
+			DEFAULT_COLOR);
+	status_field_init(&iteration_field,end_y+4,start_x+matrix_wid/2-8,
+			DEFAULT_COLOR);
+
 	set_cursor(actual_cursor_row,actual_cursor_col);
 }
 
+/** @brief Show the colour to play next
+ *
+ *  Paints a swatch of the colour hint_best() picks next to the "hint"
+ *  entry of the sidebar. The search is bounded by HINT_BUDGET_NS, so
+ *  it answers within one timer tick.
+ */
+void show_hint()
+{
+	int plane;
+	plane = hint_best(&game_board,clock_ns,HINT_BUDGET_NS,NULL);
+	if (plane < 0)
+		return;
+	draw_char_span(start_y+5,end_x + VAL_SEPARATOR + HINT_SWATCH_OFFSET,
+			HINT_SWATCH_WIDTH,SPACE,FGND_WHITE|BITBOARD_COLOR(plane));
+}
+
+/** @brief Remove the hint swatch, it is stale after a move */
+void clear_hint()
+{
+	draw_char_span(start_y+5,end_x + VAL_SEPARATOR + HINT_SWATCH_OFFSET,
+			HINT_SWATCH_WIDTH,SPACE,DEFAULT_COLOR);
+}
+
+/** @brief Set the move limit of the new board
+ *
+ *  Solves game_board within SOLVER_BUDGET_NS and gives the player
+ *  SOLVER_SLACK moves on top of the solution. mark() fails the game
+ *  on the move that reaches max_iterations, hence the one extra.
+ *  The max_iter table value set with the options stays if the solver
+ *  finds nothing.
+ */
+void set_move_limit()
+{
+	uint8_t moves[SOLVER_MAX_MOVES];
+	int solution;
+
+	solution = solver_solve(&game_board,moves,SOLVER_MAX_MOVES,clock_ns,
+			SOLVER_BUDGET_NS,NULL);
+	if (solution >= 0)
+		max_iterations = solution + SOLVER_SLACK + 1;
+}
+
 /** @brief generates game panel 
  *  This function does following :
  *
@@ -341,6 +466,8 @@ void draw_game_panel(uint8_t len, uint8_t width,uint8_t num_colors)
 			draw_char(end_y + 1,i,'-',DEFAULT_COLOR);
 		}	
 	}/* set the cursor to the first element */
+	bitboard_load(&game_board,game_state_buf,len,width);
+	set_move_limit();
 	/* Draw side bar menu */
 
 	draw_screen_sidebar();
@@ -428,81 +555,115 @@ void update_elem_bg_color(int row,int col,int color)
 	game_state_buf[elem_index] = color;
 }
 
-/** @brief Reccurisve function call to flood colors
+/** @brief Draw a run of flooded blocks
  *
- *  This function recursively looks for elements which are 
- *  reachable and changes the color of all those elements 
+ *  Span callback of flood_fill(), turns board coordinates back into
+ *  console coordinates
+ *
+ *  @param row Board row
+ *  @param col_start First board column
+ *  @param col_end Last board column
+ *  @param color New color of the run
+ *  @param arg Unused
+ */
+static void flood_draw_span(int row, int col_start, int col_end,
+		uint8_t color, void *arg)
+{
+	draw_char_span(start_y + row,start_x + col_start,
+			col_end - col_start + 1,SPACE,FGND_WHITE|color);
+}
+
+/** @brief Flood colors from a block
+ *
+ *  Recolours all the blocks reachable from (row,column) with a
+ *  scanline fill over game_state_buf, and draws them a row run at
+ *  a time
  *  
  *  @param row row
  *  @param column column 
  *  @param new_color color new
- *  @param old_color old color
+ *  @param old_color old color, must be the color of the block
  */
 void flood_it(int row,int column,int new_color,int old_color)
 {
-	/*Get the old color associated with this element */
-	int curr_elem_color = get_elem_bg_color(row,column);
-	/* Check if new color matches old color */
-	if (old_color != curr_elem_color)
+	if (get_elem_bg_color(row,column) != old_color)
 		return;
-	else 
-	{
-		/* Update the elem with new color */
-		draw_char(row,column,SPACE,FGND_WHITE|new_color);
-		update_elem_bg_color(row,column,new_color);
-		/*Check if next elem to its right is valid */
-		if ((column + 1) <= end_x)
-		{
-			flood_it(row,column+1,new_color,curr_elem_color);
-		}
-		/*Check if next elem in down direction is valid */
-		if ((row + 1) <= end_y)
-		{
-			flood_it(row+1,column,new_color,curr_elem_color);
-		}
-		/*Check if next elem in up dir is valid */
-		if ((row - 1) >= start_y)
-		{
-			flood_it(row-1,column,new_color,curr_elem_color);
-		}
-		/*Check if next elem to its left is valid */
-		if ((column - 1) >= start_x)
-		{
-			flood_it(row,column-1,new_color,curr_elem_color);
-		}
-	}
+	if (flood_fill(game_state_buf,matrix_len,matrix_wid,row - start_y,
+			column - start_x,new_color,flood_draw_span,NULL) < 0)
+		panic("flood_it: span stack overflow");
 }
 
 /** @brief Checks if the game is over
  *  
- *  Checks if the game is over 
+ *  The game is over when the flooded region of game_board holds
+ *  every block, one popcount over the region
  *
  *  @param top_elem_color Top left element 
- *  @return void
+ *  @return TRUE if the game is over, FALSE otherwise
  */
 
 int is_game_over(int top_elem_color)
 {
-	int item_index = 0;
-	int total_elems = matrix_len * matrix_wid;
-	int i,j,block_color;
-	for	(i=start_y;i <= end_y ; i++) 
-	{
-	   for (j= start_x;j<=end_x; j++)
-	   {
-		   block_color=game_state_buf[item_index];
-		   if (block_color == top_elem_color)
-			   item_index++;
-		   else 
-			   break;
-	   }	   
-	}
-	if (total_elems == item_index)
+	if (bitboard_is_done(&game_board))
 		return TRUE;
 	else 
 		return FALSE;
 }
 
+/** @brief Add the finished game to the leaderboard
+ *
+ *  The table is saved to its reserved page right away, so it is there
+ *  when kernel_main() starts again.
+ */
+void record_score()
+{
+	int rank = leaderboard_insert(&game_leaderboard,curr_user_iteration,
+			seconds,matrix_len,num_colors);
+	leaderboard_save(&game_leaderboard,(void *)LEADERBOARD_SAVE_ADDR,
+			LEADERBOARD_SAVE_SIZE);
+	lprintf("Score: %d moves in %d s, rank %d",curr_user_iteration,seconds,
+			rank + 1);
+}
+
+/** @brief Draw one row of the leaderboard on the title screen
+ *
+ *  Each field is formatted into a small buffer and drawn with one
+ *  draw_char_run(), without moving the cursor.
+ *
+ *  @param row Console row
+ *  @param column Console column of the table
+ *  @param rank Rank to draw, from 0
+ */
+void draw_score_row(int row,int column,int rank)
+{
+	char text[STATUS_FIELD_MAX];
+	int len;
+	leaderboard_entry_t *e = &game_leaderboard.entries[rank];
+
+	len = status_append_uint(text,0,rank+1,1);
+	draw_char_run(row,column+3,text,len,DEFAULT_COLOR);
+	if (rank >= game_leaderboard.count)
+	{
+		draw_char_run(row,column+SCORE_MOVES_COL+3,"-",1,DEFAULT_COLOR);
+		return;
+	}
+	len = status_append_uint(text,0,e->moves,1);
+	draw_char_run(row,column+SCORE_MOVES_COL+3,text,len,DEFAULT_COLOR);
+
+	len = status_append_uint(text,0,e->seconds/SIXTY_SECONDS,2);
+	len = status_append_str(text,len,":");
+	len = status_append_uint(text,len,e->seconds%SIXTY_SECONDS,2);
+	draw_char_run(row,column+SCORE_TIME_COL+3,text,len,DEFAULT_COLOR);
+
+	len = status_append_uint(text,0,e->size,1);
+	len = status_append_str(text,len,"x");
+	len = status_append_uint(text,len,e->size,1);
+	len = status_append_str(text,len,", ");
+	len = status_append_uint(text,len,e->colors,1);
+	len = status_append_str(text,len," colors");
+	draw_char_run(row,column+SCORE_BOARD_COL,text,len,DEFAULT_COLOR);
+}
+
 /** @brief Flood operation initiator
  *
  *  This function initiates flood operation and checks 
@@ -525,21 +686,22 @@ void mark(int color)
 			pause = TRUE;
 			start = FALSE;
 			hide_cursor();
-			iterations_used[game_index]=curr_user_iteration;
-			completion_time[game_index]= seconds;
 			lprintf("Failed");
+			interrupt_stats_dump();
 			return ;
 		}
 		flood_it(start_y,start_x,color,top_elem_color);
+		bitboard_move(&game_board,BITBOARD_PLANE(color));
+		clear_hint();
 		finish = is_game_over(color);
 		if (finish)
 		{
 			start = FALSE;
 			pause = TRUE;
 			hide_cursor();
-			iterations_used[game_index]=curr_user_iteration;
-			completion_time[game_index]= seconds;
+			record_score();
 			lprintf("Finsihed");
+			interrupt_stats_dump();
 			return;
 		}
 	}
@@ -636,6 +798,8 @@ void help_menu_game_screen()
 			"2. Hit space on an element which color should be flooded");
 	put_str(row+4,column,
 			"3.For color to flood, select elem with color diff. than Top Left");
+	put_str(row+5,column,
+			"4. Press 'n' for a hint, its color shows next to \"hint\"");
 
 
 	put_str(row+6,column,
@@ -744,6 +908,10 @@ void move_cursor(char ch)
 			quit_op();
 			break;
 
+		case 'n':
+			show_hint();
+			break;
+
 		default :
 			break;
 	}
@@ -769,6 +937,8 @@ int help_menu()
 			"2. Hit space on an element which color should be flooded");
 	put_str(row+4,column,
 			"3.For color to flood, select elem with color diff. than Top Left");
+	put_str(row+5,column,
+			"4. Press 'n' for a hint, its color shows next to \"hint\"");
 
 
 	put_str(row+6,column,
@@ -782,9 +952,10 @@ int help_menu()
 /** @brief generate title screen 
  *  
  *  This function appears first when the game starts 
- *  It lists down the most recent scores 
+ *  It lists down the best scores 
  *
  *  You can press 'b' to move to options page 
+ *  or 'l' to log the interrupt statistics
  */
 
 void title_screen()
@@ -796,37 +967,34 @@ void title_screen()
 	column = PANEL_X;
 	put_str(row,column,"Author: ISHANT DAWER");
 	
-	/* Display the fields of last 5 games */
+	/* Display the best games */
 	row = row + 4;
 	column = PANEL_X -20 ;
-	put_str(row,column,"Sequence");
-	
-	for (i=0;i< MAX_ENTRIES;i++)
-	{
-		set_cursor(row+i+1,column+3);
-		printf("%d",i+1);
-	}
-	column += 20;
-	put_str(row,column,"Flood Count");
-
-	for (i=0;i< MAX_ENTRIES;i++)
-	{
-		set_cursor(row+i+1,column+3);
-		printf("%d",iterations_used[i]);
-	}
-	column += 20;
-	put_str(row,column,"Completion Time");
+	put_str(row,column,"Rank");
+	put_str(row,column+SCORE_MOVES_COL,"Flood Count");
+	put_str(row,column+SCORE_TIME_COL,"Completion Time");
+	put_str(row,column+SCORE_BOARD_COL,"Board");
 	for (i=0;i< MAX_ENTRIES;i++)
 	{
-		set_cursor(row+i+1,column+3);
-		printf("%02d:%02d",completion_time[i]/SIXTY_SECONDS,completion_time[i]%SIXTY_SECONDS);
+		draw_score_row(row+i+1,column,i);
 	}
 
 	/*EDIT:Add data in sometime */
 	row = PANEL_Y + 7;
 	column = PANEL_X - 15;
 	put_str(row,column,"Press 'b' to start the game or 'h' to open help menu");
+	put_str(row+1,column,"Press 'l' to log interrupt statistics");
+
+}
 
+/** @brief Close the replay log of the game and dump it
+ *
+ *  @param outcome REPLAY_* value of how the game ended
+ */
+void end_replay(int outcome)
+{
+	replay_end(&game_replay,outcome,curr_user_iteration);
+	replay_dump(&game_replay);
 }
 
 /** @brief Select board size and color by pressing (1-5) twice*/
@@ -874,7 +1042,7 @@ int select_board_size_and_color()
 	}
 
 	/* Generate random event */
-	time1 = timer_ticks;
+	time1 = timer_get_ticks();
 	/*Press again 1-5 to select number of color */
 	ch = wait_key_press();
 	switch(ch) 
@@ -886,29 +1054,30 @@ int select_board_size_and_color()
 			break;
 		case '2':
 			/*Select 5 colors*/
-			num_colors=MATRIX_EIGHT;
+			num_colors=FIVE_COLORS;
 			index_num_color = 1;
 			break;
 		case '3':
 			/*Select 6 colors*/
-			num_colors=MATRIX_TEN;
+			num_colors=SIX_COLORS;
 			index_num_color = 2;
 			break;
 		case '4':
 			/*Select 7 colors*/
-			num_colors=MATRIX_TWELVE;
+			num_colors=SEVEN_COLORS;
 			index_num_color = 3;
 			break;
 		case '5':
 			/*Select 8 colors*/
-			num_colors=MATRIX_FOURTEEN;
+			num_colors=EIGHT_COLORS;
 			index_num_color = 4;
 			break;
 		default:
 			return ERROR;
 	}
-	time2 = timer_ticks;
-	sgenrand(time2-time1);
+	time2 = timer_get_ticks();
+	game_seed = time2-time1;
+	sgenrand(game_seed);
 	max_iterations = max_iter[index_board][index_num_color];	
 	return OK; 
 }
@@ -1012,6 +1181,20 @@ void handle_fail()
 
 void game_run()
 {
+	/* Scores saved before kernel_main() last started */
+	if (leaderboard_restore(&game_leaderboard,(void *)LEADERBOARD_SAVE_ADDR,
+			LEADERBOARD_SAVE_SIZE) < 0)
+		leaderboard_init(&game_leaderboard);
+	else
+		lprintf("Restored %d scores",game_leaderboard.count);
+
+	/* Game clock and cursor blink run off the timer wheel */
+	timer_add(NUMBER_CYCLES,NUMBER_CYCLES,clock_tick,NULL);
+	timer_add(BLINK_CYCLES,BLINK_CYCLES,blink_tick,NULL);
+	/* Debug heap audit, run by the key loops; -1 if not built in */
+	if (malloc_debug_audit() >= 0)
+		timer_add(HEAP_AUDIT_CYCLES,HEAP_AUDIT_CYCLES,heap_audit_tick,NULL);
+
 	/* TC 1 */
 	while (TRUE) 
 	{
@@ -1038,53 +1221,66 @@ void game_run()
 				status = help_menu(FALSE);
 				break;
 
+			case 'l':
+				/* Dump the interrupt and malloc statistics, stay on
+				 * title */
+				interrupt_stats_dump();
+				malloc_stats_dump();
+				status = ERROR;
+				break;
+
 			default:
 				status = ERROR;
 		}
 		if (status != ERROR)
 		{
 			/* Prepare Game panel page */
-			game_state_buf =(uint8_t*) malloc(matrix_len*matrix_wid
-					*sizeof(uint8_t));
+			game_state_buf =(uint8_t*) arena_alloc(&game_arena,
+					matrix_len*matrix_wid*sizeof(uint8_t));
 			clear_console();
 			draw_game_panel(matrix_len,matrix_wid,num_colors);
+			replay_start(&game_replay,game_seed,matrix_len,matrix_wid,
+					num_colors,max_iterations,timer_get_ticks());
 			start = TRUE;
-			if (game_index  > 4)
-			{
-				game_index = 0;
-			}
-			game_index++;
 			while (1) 
 			{
 				char ch=readchar();
 				/* Free state buffer */
 				if (ch != ERROR)
+				{
+					replay_record(&game_replay,timer_get_ticks(),ch);
 					move_cursor(ch);
+				}
+				else
+					heap_audit_poll();
 				if (fail)
 				{	
 					char ch1='r'; 
+					end_replay(REPLAY_FAILED);
 					handle_fail();
 					wait_char(ch1);
 					fail = FALSE;
 					curr_user_iteration = 0;
-					free(game_state_buf);
+					arena_reset(&game_arena);
 					break;
 				}
 				if (finish)
 				{	
 					char ch1='r'; 
+					end_replay(REPLAY_FINISHED);
 					handle_finish();
 					wait_char(ch1);
 					finish = FALSE;
 					curr_user_iteration = 0;
-					free(game_state_buf);
+					arena_reset(&game_arena);
 					break;
 				}
 				if (quit)
 				{	
+					end_replay(REPLAY_QUIT);
 					quit = FALSE;
 					curr_user_iteration = 0;
-					free(game_state_buf);
+					arena_reset(&game_arena);
 					break;
 				}
 				if (help)
@@ -17,6 +17,9 @@
 #define ERROR -1
 #define DIVIDE_BY_TWO 2
 #define NUMBER_CYCLES 100
+#define BLINK_CYCLES NUMBER_CYCLES
+/* Ticks between two audits of the debug heap */
+#define HEAP_AUDIT_CYCLES (5 * NUMBER_CYCLES)
 #define MINUS_ONE -1
 
  
@@ -62,6 +65,33 @@ char wait_key_press();
  */
 void tick(unsigned int numTicks);
 
+/** @brief Clock timer, runs once a second
+ *
+ * @param arg Unused
+ * @return void
+ */
+void clock_tick(void *arg);
+
+/** @brief Blink timer, toggles the cursor
+ *
+ * @param arg Unused
+ * @return void
+ */
+void blink_tick(void *arg);
+
+/** @brief Audit timer, marks an audit of the debug heap as due
+ *
+ * @param arg Unused
+ * @return void
+ */
+void heap_audit_tick(void *arg);
+
+/** @brief Audit the debug heap if the audit timer asked for it
+ *
+ * @return void
+ */
+void heap_audit_poll();
+
 /** @brief move_cursor 
  *
  * @param char ch
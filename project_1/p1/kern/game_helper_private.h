@@ -10,12 +10,17 @@
 
 #include<video_defines.h>
 #include<malloc.h>
+#include<malloc/arena.h>
 
 #include<contracts.h>
 #include<simics.h>
 #include<mt19937int.h>
 #include<stdio.h>
 #include<string.h>
+#include "bitboard.h"
+#include "status_line.h"
+#include "replay.h"
+#include "leaderboard.h"
 
 #define PANEL_X ((CONSOLE_WIDTH)/2 -10)  /*Column*/
 #define PANEL_Y ((CONSOLE_HEIGHT)/2 -3)  /*ROW*/
@@ -28,7 +33,9 @@
 #define SEPARATOR 12
 #define VAL_SEPARATOR 14
 #define TEXT_SEPARATOR 7
-#define SIDE_ITEMS 6
+#define SIDE_ITEMS 7
+#define HINT_SWATCH_OFFSET 5 /* From the start of "hint" */
+#define HINT_SWATCH_WIDTH 2
 #define EQUAL_CHARACTER '='
 #define TRUE 1
 #define FALSE 0
@@ -72,7 +79,6 @@ uint8_t matrix_wid;
 uint8_t num_colors;
 uint8_t max_iterations;
 uint8_t curr_user_iteration;
-int game_index=-1;
 uint8_t cursor_hidden = FALSE;
 /* Panel first and last element coordinates */
 uint8_t start_x;
@@ -92,14 +98,31 @@ uint8_t help = FALSE;
 unsigned int seconds = 0;
 unsigned int timer_ticks = 0;
 
+/* Status fields refreshed by clock_tick() */
+status_field_t time_field;
+status_field_t iteration_field;
+
 /* Game state buffer */
 
 uint8_t * game_state_buf;
 
+/** @brief Arena of game_state_buf, reset when a game ends and its pages
+ *  reused by the next one */
+arena_t game_arena;
+
+/* Same board as colour planes, used for game over and move evaluation */
+bitboard_t game_board;
+
+/* Seed of the board and keys of the game, for replay */
+uint32_t game_seed;
+replay_log_t game_replay;
+
 
-/* Top 5 items in the buffer */
+/* Top 5 entries of the leaderboard on the title screen */
 #define MAX_ENTRIES 5
-int iterations_used[MAX_ENTRIES];
-int completion_time[MAX_ENTRIES];
+#define SCORE_MOVES_COL 14
+#define SCORE_TIME_COL 30
+#define SCORE_BOARD_COL 50
+leaderboard_t game_leaderboard;
 
 
@@ -0,0 +1,111 @@
+/** @file hint.c
+ *
+ *  @brief Implementation of the hint engine
+ *
+ *  What it contains :
+ *
+ *  -- Candidates are only the colours of the frontier blocks, scored
+ *  with bitboard_gain(), which floods from the frontier instead of
+ *  the whole region
+ *  -- The last move of a line is only scored, never played, so a
+ *  search k moves deep plays the board k - 1 moves deep
+ *  -- A line that floods the board scores above any line that does
+ *  not, and sooner above later
+ *  -- The clock is read at every played move; once the budget is gone
+ *  the search unwinds and its partial answer is dropped
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include "hint.h"
+
+/** @brief Clock of the running search */
+static solver_clock_fn hint_clock;
+
+/** @brief When the running search has to stop */
+static uint64_t hint_deadline;
+
+/** @brief Whether the running search ran out of time */
+static int hint_expired;
+
+/** @brief Score of a line
+ *
+ *  @param count Blocks in the region at its end
+ *  @param cells Blocks on the board
+ *  @param left Moves of the line not needed to flood the board
+ */
+static int hint_score(int count, int cells, int left)
+{
+	if (count == cells)
+		return (cells + 1 + left) * (HINT_MAX_DEPTH + 1);
+	return count * (HINT_MAX_DEPTH + 1);
+}
+
+/** @brief Best score reachable in a number of moves
+ *
+ *  @param board Board
+ *  @param depth Moves to look at, at least 1
+ *  @param best Where the best first move is stored, may be NULL
+ *  @return Score, -1 if the search ran out of time
+ */
+static int hint_search(const bitboard_t *board, int depth, int *best)
+{
+	bitboard_t child;
+	int p,gain,score,top = -1,top_gain = 0;
+	int count = bitset_count(&board->region);
+
+	for (p = 0; p < BITBOARD_COLORS; p++)
+	{
+		gain = bitboard_gain(board,p);
+		if (gain == 0)
+			continue;
+		if (depth == 1 || count + gain == board->cells)
+			score = hint_score(count + gain,board->cells,depth - 1);
+		else
+		{
+			if (hint_clock != NULL && (*hint_clock)() > hint_deadline)
+				hint_expired = 1;
+			if (hint_expired)
+				return -1;
+			child = *board;
+			bitboard_move(&child,p);
+			score = hint_search(&child,depth - 1,NULL);
+			if (score < 0)
+				return -1;
+		}
+		/* The immediate gain breaks ties */
+		if (score > top || (score == top && gain > top_gain))
+		{
+			top = score;
+			top_gain = gain;
+			if (best != NULL)
+				*best = p;
+		}
+	}
+	return top;
+}
+
+/** @brief Colour to play next
+ */
+int hint_best(const bitboard_t *board, solver_clock_fn now_ns,
+		uint64_t budget_ns, int *depth)
+{
+	int d,plane,answer = -1,answer_depth = 0;
+
+	hint_clock = now_ns;
+	hint_deadline = now_ns != NULL ? (*now_ns)() + budget_ns : 0;
+	hint_expired = 0;
+	for (d = 1; d <= HINT_MAX_DEPTH; d++)
+	{
+		plane = -1;
+		if (hint_search(board,d,&plane) < 0 || plane < 0)
+			break;
+		answer = plane;
+		answer_depth = d;
+	}
+	if (depth != NULL)
+		*depth = answer_depth;
+	return answer;
+}
@@ -0,0 +1,39 @@
+/** @file hint.h
+ *  @brief Hint engine, the colour that grows the region the most
+ *
+ *  Moves are looked at up to HINT_MAX_DEPTH deep. The search deepens
+ *  one move at a time and keeps the answer of the deepest search that
+ *  finished within the time budget, so a hint never takes longer than
+ *  the budget.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HINT_H_
+#define _HINT_H_
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "solver.h"
+
+/** @brief Deepest lookahead, in moves */
+#define HINT_MAX_DEPTH 4
+
+/** @brief Time a hint may take, half of a 10 ms timer tick */
+#define HINT_BUDGET_NS 5000000ULL
+
+/** @brief Colour to play next
+ *
+ *  @param board Board
+ *  @param now_ns Clock for the budget, NULL to always search
+ *  HINT_MAX_DEPTH moves deep
+ *  @param budget_ns Time after which the search stops
+ *  @param depth Where the depth of the answer is stored, may be NULL
+ *
+ *  @return Plane of the colour, -1 if the board is already flooded
+ */
+int hint_best(const bitboard_t *board, solver_clock_fn now_ns,
+		uint64_t budget_ns, int *depth);
+
+#endif /* _HINT_H_ */
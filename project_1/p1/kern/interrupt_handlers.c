@@ -8,6 +8,12 @@
  *  What it contains : 
  *  1. Timer Interrupt installer 
  *  2. Keyboard Interrupt installer
+ *  3. Work queue set up and interrupt statistics
+ *  4. Calibration of the TSC clock source
+ *  5. Per vector histograms of handler cost, fed by the common 
+ *  interrupt entry with the time stamp taken on entry, and of latency,
+ *  which only the timer in deadline mode records: it is the one source
+ *  with a deadline to measure from
  *
  *  @author Ishant Dawer (idawer)
  *  @bug No known bugs 
@@ -15,12 +21,94 @@
 
 #include "timer_driver.h"
 #include "keyboard_driver.h"
+#include "interrupt_handlers.h"
+#include "clock.h"
+#include "irq.h"
 #define OK 1
 #define ERROR -1
 
+/** @brief Statistics of every interrupt vector */
+static irq_vector_stats_t irq_stats[IRQ_STATS_VECTORS];
+
+/** @brief Add a sample to a histogram
+ *
+ *  @param hist Histogram
+ *  @param ns Sample in ns
+ */
+static void irq_hist_record(irq_hist_t *hist, uint32_t ns)
+{
+	int bucket = 0;
+	if (ns != 0)
+		bucket = 31 - __builtin_clz(ns);
+	if (hist->count == 0 || ns < hist->min_ns)
+		hist->min_ns = ns;
+	if (ns > hist->max_ns)
+		hist->max_ns = ns;
+	hist->count++;
+	hist->total_ns += ns;
+	hist->buckets[bucket]++;
+}
+
+/** @brief Log a histogram
+ *
+ *  @param vector Interrupt vector
+ *  @param name What the histogram measures
+ *  @param hist Histogram
+ */
+static void irq_hist_dump(unsigned int vector, char *name, irq_hist_t *hist)
+{
+	int i;
+	if (hist->count == 0)
+		return;
+	lprintf("vector 0x%02x %s: %u samples, min %u ns, avg %u ns, max %u ns%s",
+			vector,name,hist->count,(unsigned int)hist->min_ns,
+			(unsigned int)(hist->total_ns / hist->count),
+			(unsigned int)hist->max_ns,
+			hist->max_ns > IRQ_BUDGET_NS ? " OVER BUDGET" : "");
+	for (i = 0; i < IRQ_HIST_BUCKETS; i++)
+	{
+		if (hist->buckets[i] != 0)
+			lprintf("    [%u ns, %u ns) %u",1u << i,
+					i < 31 ? (1u << (i + 1)) : ~0u,hist->buckets[i]);
+	}
+}
+
+/** @brief Account one run of a handler
+ */
+void interrupt_stats_exit(unsigned int vector, uint64_t entry)
+{
+	uint64_t ns = clock_cycles_to_ns(rdtsc() - entry);
+	uint32_t flags;
+	if (vector >= IRQ_STATS_VECTORS)
+		return;
+	/* Trap gates leave interrupts enabled, keep a nested one from 
+	 * updating the same histogram */
+	flags = get_eflags();
+	disable_interrupts();
+	irq_hist_record(&irq_stats[vector].cost,
+			ns > ~0u ? ~0u : (uint32_t)ns);
+	set_eflags(flags);
+}
+
+/** @brief Account how late an interrupt was served
+ */
+void interrupt_latency_record(unsigned int vector, uint32_t ns)
+{
+	if (vector >= IRQ_STATS_VECTORS)
+		return;
+	irq_hist_record(&irq_stats[vector].latency,ns);
+}
+
 int handler_install(void (*tickback)(unsigned int))
 {
 	int status_timer,status_keybd;
+	/* Calibrate before the timer starts using channel 0 */
+	clock_init();
+	lprintf("TSC calibrated at %u kHz",(unsigned int)(clock_hz() / 1000));
+	/* Handlers push work as soon as they are installed */
+	work_queue_init();
+	/* Every vector goes through the common dispatcher */
+	irq_init();
 	status_timer = handler_install_timer(tickback);
 	status_keybd = handler_install_keybd();
 	if (status_timer && status_keybd)
@@ -28,3 +116,43 @@ int handler_install(void (*tickback)(unsigned int))
 	else 
 		return ERROR;
 }
+
+/** @brief Log the interrupt statistics
+ *
+ *  Top half durations of the timer and keyboard handlers, the 
+ *  depth of the deferred work queue and the per vector histograms 
+ *  go to the simics console.
+ */
+void interrupt_stats_dump()
+{
+	work_queue_stats_t stats;
+	unsigned int vector;
+	work_queue_get_stats(&stats);
+	lprintf("timer isr: %u irqs, max %u ns, avg %u ns",
+			timer_isr_stats.count,
+			(unsigned int)clock_cycles_to_ns(timer_isr_stats.cycles_max),
+			timer_isr_stats.count ? (unsigned int)clock_cycles_to_ns(
+				timer_isr_stats.cycles_total / timer_isr_stats.count) : 0);
+	lprintf("keybd isr: %u irqs, max %u ns, avg %u ns",
+			keybd_isr_stats.count,
+			(unsigned int)clock_cycles_to_ns(keybd_isr_stats.cycles_max),
+			keybd_isr_stats.count ? (unsigned int)clock_cycles_to_ns(
+				keybd_isr_stats.cycles_total / keybd_isr_stats.count) : 0);
+	lprintf("work queue: %u queued, %u run, %u dropped, max depth %u",
+			stats.queued,stats.run,stats.dropped,stats.depth_max);
+
+	lprintf("irq mask 0x%04x, %u spurious",pic_get_mask(),
+			irq_spurious_count());
+	for (vector = 0; vector < IRQ_LINES; vector++)
+	{
+		if (irq_count(vector) != 0)
+			lprintf("irq %u: %u interrupts",vector,irq_count(vector));
+	}
+	/* Empty histograms are skipped */
+	lprintf("latency: timer in deadline mode only");
+	for (vector = 0; vector < IRQ_STATS_VECTORS; vector++)
+	{
+		irq_hist_dump(vector,"cost",&irq_stats[vector].cost);
+		irq_hist_dump(vector,"latency",&irq_stats[vector].latency);
+	}
+}
@@ -0,0 +1,84 @@
+/** @file interrupt_handlers.h
+ *  @brief Declarations for the interrupt handler installer
+ *
+ *  handler_install() itself is declared in p1kern.h.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _INTERRUPT_HANDLERS_H_
+#define _INTERRUPT_HANDLERS_H_
+
+#include <stdint.h>
+
+/** @brief Number of interrupt vectors with statistics */
+#define IRQ_STATS_VECTORS 256
+
+/** @brief Buckets of a histogram, bucket n counts [2^n, 2^(n+1)) ns */
+#define IRQ_HIST_BUCKETS 32
+
+/** @brief Handler cost above which the dump flags a vector */
+#define IRQ_BUDGET_NS 50000
+
+/** @brief Nanoseconds per PIT count (1e9 / TIMER_RATE) */
+#define PIT_COUNT_NS 838
+
+/** @brief Log2 histogram of durations in ns */
+typedef struct irq_hist {
+	/** @brief Samples taken */
+	unsigned int count;
+	/** @brief Shortest sample */
+	uint32_t min_ns;
+	/** @brief Longest sample */
+	uint32_t max_ns;
+	/** @brief Sum of all samples */
+	uint64_t total_ns;
+	/** @brief Samples per power of two */
+	unsigned int buckets[IRQ_HIST_BUCKETS];
+} irq_hist_t;
+
+/** @brief Statistics of one interrupt vector */
+typedef struct irq_vector_stats {
+	/** @brief Time from entry to the EOI, deferred work excluded */
+	irq_hist_t cost;
+	/** @brief Time from the device raising the interrupt to entry, only
+	 *  recorded by the timer in deadline mode */
+	irq_hist_t latency;
+} irq_vector_stats_t;
+
+/** @brief Account one run of a handler
+ *
+ *  Called from irq_dispatch() once the handler has returned and the 
+ *  interrupt is acknowledged, before the deferred work runs.
+ *
+ *  @param vector Interrupt vector
+ *  @param entry Time stamp read when the wrapper was entered
+ *  @return void
+ */
+void interrupt_stats_exit(unsigned int vector, uint64_t entry);
+
+/** @brief Account how late an interrupt was served
+ *
+ *  Only the timer in deadline mode calls it, on either backend; the 
+ *  keyboard and the periodic timer have no deadline to measure from.
+ *
+ *  @param vector Interrupt vector
+ *  @param ns Nanoseconds between the device event and the handler
+ *  @return void
+ */
+void interrupt_latency_record(unsigned int vector, uint32_t ns);
+
+/** @brief Log the interrupt statistics
+ *
+ *  Logs the top half duration of the timer and keyboard handlers, 
+ *  the statistics of the deferred work queue and the histograms of 
+ *  every vector taken so far, skipping empty ones: only the timer in 
+ *  deadline mode has a latency histogram. Vectors whose handler took 
+ *  longer than IRQ_BUDGET_NS are flagged.
+ *
+ *  @return void
+ */
+void interrupt_stats_dump();
+
+#endif /* _INTERRUPT_HANDLERS_H_ */
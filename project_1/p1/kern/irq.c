@@ -0,0 +1,199 @@
+/** @file irq.c
+ *
+ *  @brief Implementation of the interrupt dispatch layer
+ *
+ *  What it contains :
+ *
+ *  1. Gate installation :
+ *
+ *  -- idt_install_gate() encodes a trap or interrupt gate for any
+ *  vector, so drivers no longer write IDT words themselves
+ *  -- irq_init() points all IDT_ENTS vectors to their generated stubs
+ *
+ *  2. Dispatch :
+ *
+ *  -- irq_dispatch() counts the vector and calls the handler that was
+ *  registered for it: one indirect call per interrupt
+ *  -- IRQ lines are acknowledged with a specific EOI once the handler
+ *  returns, the handler's cost is accounted, then the deferred work
+ *  queue is run, so its work is not billed to the vector
+ *  -- Other vectors above the exceptions come from the local APIC
+ *  (when enabled) and are acknowledged through its EOI register;
+ *  its spurious vector is never acknowledged
+ *  -- An exception nobody registered for panics instead of faulting
+ *  again forever
+ *
+ *  3. Masking :
+ *
+ *  -- pic_init() leaves every line but the cascade masked; a line is
+ *  unmasked when a handler is registered for it, so unused lines never
+ *  interrupt
+ *  -- A spurious IRQ7/IRQ15 (bit not set in the ISR register) is
+ *  counted and dropped without an EOI for it
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <asm.h>
+#include <eflags.h>
+#include <stdlib.h>
+#include "irq.h"
+#include "work_queue.h"
+#include "lapic.h"
+#include "interrupt_handlers.h"
+
+/** @brief Dispatch table, indexed by vector */
+static irq_action_t irq_table[IDT_ENTS];
+
+/** @brief Spurious IRQ7/IRQ15 taken and dropped */
+static unsigned int irq_spurious = 0;
+
+/** @brief Write one IDT gate
+ */
+int idt_install_gate(int vector, void *handler, int type)
+{
+	unsigned int *gate;
+	if (vector < 0 || vector >= IDT_ENTS)
+		return -1;
+	gate = (unsigned int *)idt_base() + 2 * vector;
+	gate[0] = IDT_GATE_LOW(handler);
+	gate[1] = IDT_GATE_HIGH(handler,type);
+	return 1;
+}
+
+/** @brief Point every IDT vector to its entry stub
+ */
+void irq_init(void)
+{
+	int vector;
+	for (vector = 0; vector < IDT_ENTS; vector++)
+		idt_install_gate(vector,irq_stubs + vector * IRQ_STUB_SIZE,
+				IDT_TRAP_GATE);
+}
+
+/** @brief Register the handler of an IRQ line
+ */
+int irq_register(int irq, irq_handler_t fn, void *arg)
+{
+	irq_action_t *action;
+	if (irq < 0 || irq >= IRQ_LINES)
+		return -1;
+	action = &irq_table[IRQ_VECTOR(irq)];
+	if (fn == NULL)
+		irq_mask(irq);
+	/* Argument first, the handler may be taken as soon as it is set */
+	action->arg = arg;
+	action->fn = fn;
+	if (fn != NULL)
+		irq_unmask(irq);
+	return 1;
+}
+
+/** @brief Register the handler of a vector with no PIC line
+ */
+int irq_register_vector(int vector, irq_handler_t fn, void *arg)
+{
+	irq_action_t *action;
+	if (vector < IDT_USER_START || vector >= IDT_ENTS)
+		return -1;
+	action = &irq_table[vector];
+	action->arg = arg;
+	action->fn = fn;
+	return 1;
+}
+
+/** @brief Mask an IRQ line
+ */
+void irq_mask(int irq)
+{
+	uint32_t flags;
+	if (irq < 0 || irq >= IRQ_LINES)
+		return;
+	flags = get_eflags();
+	disable_interrupts();
+	pic_mask(irq);
+	set_eflags(flags);
+}
+
+/** @brief Unmask an IRQ line
+ */
+void irq_unmask(int irq)
+{
+	uint32_t flags;
+	if (irq < 0 || irq >= IRQ_LINES)
+		return;
+	flags = get_eflags();
+	disable_interrupts();
+	pic_unmask(irq);
+	set_eflags(flags);
+}
+
+/** @brief Spurious interrupts dropped
+ */
+unsigned int irq_spurious_count(void)
+{
+	return irq_spurious;
+}
+
+/** @brief Times an IRQ line was taken
+ */
+unsigned int irq_count(int irq)
+{
+	if (irq < 0 || irq >= IRQ_LINES)
+		return 0;
+	return irq_table[IRQ_VECTOR(irq)].count;
+}
+
+/** @brief Common C entry of all the vectors
+ */
+void irq_dispatch(unsigned int vector, uint64_t entry)
+{
+	irq_action_t *action = &irq_table[vector];
+	int irq = -1;
+
+	if (vector >= X86_PIC_MASTER_IRQ_BASE &&
+			vector < X86_PIC_MASTER_IRQ_BASE + 8)
+		irq = vector - X86_PIC_MASTER_IRQ_BASE;
+	else if (vector >= X86_PIC_SLAVE_IRQ_BASE &&
+			vector < X86_PIC_SLAVE_IRQ_BASE + 8)
+		irq = vector - X86_PIC_SLAVE_IRQ_BASE + 8;
+
+	/* A spurious IRQ7/IRQ15 is not in service: no EOI for it, but 
+	 * the master did see the slave's cascade line */
+	if ((irq == PIC_SPURIOUS_MASTER_IRQ || irq == PIC_SPURIOUS_SLAVE_IRQ) &&
+			!pic_in_service(irq))
+	{
+		irq_spurious++;
+		if (irq == PIC_SPURIOUS_SLAVE_IRQ)
+			pic_acknowledge(PIC_CASCADE_IRQ);
+		interrupt_stats_exit(vector,entry);
+		return;
+	}
+
+	action->count++;
+
+	if (action->fn != NULL)
+		(*action->fn)(action->arg);
+	else if (vector < IDT_USER_START)
+		panic("Unhandled exception %u",vector);
+
+	if (irq >= 0)
+		pic_acknowledge(irq);
+	else if (vector >= IDT_USER_START && 
+			vector != LAPIC_SPURIOUS_VECTOR && lapic_enabled())
+		/* Delivered by the local APIC: one store to its EOI register */
+		lapic_eoi();
+	else
+	{
+		interrupt_stats_exit(vector,entry);
+		return;
+	}
+
+	/* The handler's cost ends with the EOI. Slow work runs after it, 
+	 * so other lines are not held off by it, and is not billed to 
+	 * this vector */
+	interrupt_stats_exit(vector,entry);
+	work_queue_run();
+}
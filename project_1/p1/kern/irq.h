@@ -0,0 +1,155 @@
+/** @file irq.h
+ *  @brief Interrupt dispatch layer
+ *
+ *  Every IDT vector points to a small generated stub (irq_stubs.S)
+ *  which pushes its vector number and jumps to one common entry.
+ *  The common entry saves the registers and calls irq_dispatch(),
+ *  which looks the vector up in a table of registered handlers.
+ *
+ *  Drivers register a C function with irq_register() and only do the
+ *  device work in it; the dispatcher acknowledges the PIC and runs the
+ *  deferred work queue.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _IRQ_H_
+#define _IRQ_H_
+
+#include <stdint.h>
+#include <x86/idt.h>
+#include <x86/pic.h>
+#include <seg.h>
+
+/** @brief Number of IRQ lines on the two PICs */
+#define IRQ_LINES 16
+
+/** @brief IRQ line of the PIT */
+#define IRQ_TIMER 0
+
+/** @brief IRQ line of the keyboard */
+#define IRQ_KEYBOARD 1
+
+/** @brief IRQ line the slave PIC cascades into */
+#define IRQ_CASCADE 2
+
+/** @brief IDT vector of an IRQ line */
+#define IRQ_VECTOR(irq) ((irq) < 8 ? X86_PIC_MASTER_IRQ_BASE + (irq) : \
+		X86_PIC_SLAVE_IRQ_BASE + (irq) - 8)
+
+/** @brief Bytes reserved for each generated entry stub */
+#define IRQ_STUB_SIZE 16
+
+/** @brief Gate type bits of a trap gate (present, DPL 0, 32 bit) */
+#define IDT_TRAP_GATE 0x8F00
+
+/** @brief Gate type bits of an interrupt gate (present, DPL 0, 32 bit) */
+#define IDT_INTERRUPT_GATE 0x8E00
+
+/** @brief Lower 32 bits of a gate: segment selector and offset 15..0 */
+#define IDT_GATE_LOW(x) (((SEGSEL_KERNEL_CS) << 16) | \
+		(((unsigned int)(x)) & 0xFFFF))
+
+/** @brief Upper 32 bits of a gate: offset 31..16 and type */
+#define IDT_GATE_HIGH(x,type) ((((unsigned int)(x)) & 0xFFFF0000) | (type))
+
+/** @brief Handler of an interrupt vector */
+typedef void (*irq_handler_t)(void *arg);
+
+/** @brief Entry of the dispatch table */
+typedef struct irq_action {
+	/** @brief Registered handler, NULL if none */
+	irq_handler_t fn;
+	/** @brief Argument to the handler */
+	void *arg;
+	/** @brief Times the vector was taken */
+	unsigned int count;
+} irq_action_t;
+
+/** @brief First generated entry stub, the one of vector 0 */
+extern char irq_stubs[];
+
+/** @brief Point every IDT vector to its entry stub
+ *
+ *  @return void
+ */
+void irq_init(void);
+
+/** @brief Write one IDT gate
+ *
+ *  @param vector IDT vector
+ *  @param handler Entry point of the gate
+ *  @param type IDT_TRAP_GATE or IDT_INTERRUPT_GATE
+ *
+ *  @return 1 on success, -1 if the vector is out of range
+ */
+int idt_install_gate(int vector, void *handler, int type);
+
+/** @brief Register the handler of an IRQ line
+ *
+ *  The handler runs from the interrupt; the PIC is acknowledged after
+ *  it returns. The line is unmasked once a handler is set and masked
+ *  again when it is removed.
+ *
+ *  @param irq IRQ line, 0 to 15
+ *  @param fn Handler, NULL to remove it
+ *  @param arg Argument to the handler
+ *
+ *  @return 1 on success, -1 if the line is out of range
+ */
+int irq_register(int irq, irq_handler_t fn, void *arg);
+
+/** @brief Register the handler of a vector with no PIC line
+ *
+ *  Used for local APIC sources; the dispatcher acknowledges them with
+ *  lapic_eoi().
+ *
+ *  @param vector IDT vector, IDT_USER_START or above
+ *  @param fn Handler, NULL to remove it
+ *  @param arg Argument to the handler
+ *
+ *  @return 1 on success, -1 if the vector is out of range
+ */
+int irq_register_vector(int vector, irq_handler_t fn, void *arg);
+
+/** @brief Mask an IRQ line
+ *
+ *  Uses the cached mask of the PICs, no inb round trip.
+ *
+ *  @param irq IRQ line, 0 to 15
+ *  @return void
+ */
+void irq_mask(int irq);
+
+/** @brief Unmask an IRQ line
+ *
+ *  @param irq IRQ line, 0 to 15
+ *  @return void
+ */
+void irq_unmask(int irq);
+
+/** @brief Spurious IRQ7/IRQ15 interrupts dropped
+ *
+ *  @return Count
+ */
+unsigned int irq_spurious_count(void);
+
+/** @brief Times an IRQ line was taken
+ *
+ *  @param irq IRQ line, 0 to 15
+ *  @return Count, 0 if the line is out of range
+ */
+unsigned int irq_count(int irq);
+
+/** @brief Common C entry of all the vectors
+ *
+ *  Called from the assembly entry with the registers saved.
+ *
+ *  @param vector IDT vector taken
+ *  @param entry Time stamp read by the assembly entry
+ *  @return void
+ */
+void irq_dispatch(unsigned int vector, uint64_t entry);
+
+#endif /* _IRQ_H_ */
@@ -5,10 +5,8 @@
  *  This file contains following things:
  *  1. Keyboard Install handler: 
  *
- *  --This handler installs the keyboard interrupt entry in the 
- *  IDT table
- *  -- This handler defines the assemnly wrapper to execute when
- *  interrupt is received 
+ *  --This handler registers the keyboard interrupt handler with 
+ *  the dispatch layer (irq.c)
  *  -- Defines a handler in C which basically keeps on adding 
  *  items read from the keyboard in the circular buffer. 
  *  Once the buffer gets filled,it takes a circular loop and overwrites
@@ -51,6 +49,9 @@
 /** @brief Circular buffer to store keyboard events data */
 char buf[BUFFER_ITEMS];
 
+/** @brief Time spent in the top half of the keyboard handler */
+isr_stats_t keybd_isr_stats;
+
 /* Buffer iterator */
 /** @brief put pointer to buf */
 volatile char * put_buf_iter = buf;
@@ -68,38 +69,13 @@ volatile char * rem_buf_iter = buf;
  * 
  *	This handler does following things : 
  *
- *	1. Install entry into IDT table 
- *	2. Define it as a Trap gate
- *	3. Defines the assembly handler
+ *	1. Registers keyboard_event_handler() for IRQ_KEYBOARD 
+ *	with the dispatch layer, which owns the IDT gate
  */
 int handler_install_keybd()
 {
-    /*
-     * Step1: Install the IDT table entry 
-     */
-
-    /* Get the IDT base address */
-    void * idt_base_addr = idt_base();
-    void * assembly_wrapper = keybd_wrapper_asm;
-    /* Index is mentioned in the timer defines library*/
-
-    unsigned int index = KEY_IDT_ENTRY * SIZE_2_WORDS;
-
-    /* Writing IDT entry for timer handler */
-    *(unsigned int*)(idt_base_addr + index) = LOWER_32(assembly_wrapper);
-    *(unsigned int*)(idt_base_addr + index + SIZE_UINT) = UPPER_32(assembly_wrapper);
-    return 1;
-}
-
-/** @brief Send acknowledge to PIC
- *
- * This function writes to PIC after handling the 
- * handler 
- */
-
-void send_ack_pic1()
-{
-	outb(INT_CTL_PORT,INT_ACK_CURRENT);
+    /* Register the C handler for the keyboard line */
+    return irq_register(IRQ_KEYBOARD,keyboard_event_handler,NULL);
 }
 
 /** @brief keyboard event handler
@@ -110,11 +86,14 @@ void send_ack_pic1()
  *  captured by remove pointer 
  *  2. If yes, then stops
  *  3. Installs the keyboard event into circular buffer
- *  4. Sends back the acknowledgement
+ *
+ *  The dispatcher sends the acknowledgement and runs the deferred 
+ *  work queue once it returns.
  */
 
-void keyboard_event_handler()
+void keyboard_event_handler(void *arg)
 {
+	uint64_t start = rdtsc();
 	/* Read the keyboard event scancode */
 	char event_scancode = inb(KEYBOARD_PORT);
 
@@ -130,8 +109,7 @@ void keyboard_event_handler()
 			put_buf_iter = buf;
 		}
 	}
-	/*Send ack signal to PIC */
-	send_ack_pic1();	
+	isr_stats_record(&keybd_isr_stats,start);
 }
 
 /** @brief Read character library function
@@ -21,30 +21,11 @@
 #include <asm.h>
 #include <interrupt_defines.h>
 #include <seg.h>
+#include "work_queue.h"
+#include "irq.h"
 
-/** @brief Get the size of 2 words */
-
-#define SIZE_2_WORDS ((2)*(sizeof(void *)))
-
-/** @brief Get offset for first 16 bits */
-
-#define OFFSET_FIRST(x) (((unsigned int)(x)) & (0xFFFF))                    
-#define OFFSET_SECOND(x) (((unsigned int)(x)) & (0xFFFF0000)) 
-
-
-/** @brief Higher 32 bits with D=1*/
-#define TRAP_GATE_REM_BITS 0x8F00
-
-/** @brief Higher 32 bits of Trap gate */
-
-#define UPPER_32(x) (TRAP_GATE_REM_BITS | OFFSET_SECOND(x))
-
-/** @brief Lower 32 bits of Trap gate */
-
-#define LOWER_32(x) (((SEGSEL_KERNEL_CS) << 16) | OFFSET_FIRST(x))
-
-/** @brief Size of unsigned int */
-#define SIZE_UINT sizeof(unsigned int)
+/** @brief Time spent in the top half of the keyboard handler */
+extern isr_stats_t keybd_isr_stats;
 
 /** @brief Handler keyboard 
  *
@@ -57,37 +38,13 @@ int handler_install_keybd();
 
 /** @brief Keyboard event handler 
  *	
- *	This handler does following things : 
+ *	Registered with irq_register() for IRQ_KEYBOARD. Reads the 
+ *	scancode into the circular buffer; the dispatcher 
+ *	acknowledges the PIC after it returns.
  *
- *	1. Install entry into IDT table 
- *	2. Define it as a Trap gate
- *	3. Defines the assembly handler
-
- *	@param none 
+ *	@param arg Unused
  *
  *	@return Void
  */
 
-void keyboard_event_handler();
-
-/** @brief Send ack signal to interrupt
- * This function writes to PIC after handling the 
- * handler 
- */
-void send_ack_pic1();
-
-/** @brief Key board wrapper in assembly
- *
- *	This is an assembly wrapper whose task is to 
- *	store all the general purpose registers 
- *	and retrieve them after its execution
- *	and perform IRET which will restore all the 
- *	Flag regsisters and others.
- *  
- *  @param none 
- *
- *  @return void
- */
-
-
-void keybd_wrapper_asm();
+void keyboard_event_handler(void *arg);
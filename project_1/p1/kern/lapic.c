@@ -0,0 +1,173 @@
+/** @file lapic.c
+ *
+ *  @brief Implementation of the local APIC timer backend
+ *
+ *  What it contains :
+ *
+ *  1. Detection and set up :
+ *
+ *  -- CPUID.1 tells whether there is a local APIC and whether its
+ *  timer has TSC-deadline mode
+ *  -- The APIC is enabled through MSR_APIC_BASE and the SVR. LINT0 is
+ *  set to ExtINT so the 8259 (keyboard) keeps working
+ *  -- Paging is off, so the registers are used at their physical
+ *  address
+ *
+ *  2. Timer :
+ *
+ *  -- The APIC timer rate is calibrated against the TSC
+ *  -- Deadlines are given as TSC values; in TSC-deadline mode they go
+ *  straight to MSR_TSC_DEADLINE, otherwise they are turned into an
+ *  initial count for one-shot mode
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No I/O APIC support, legacy lines still go through the 8259
+ */
+
+#include <stddef.h>
+#include <asm.h>
+#include <eflags.h>
+#include "lapic.h"
+#include "clock.h"
+
+/** @brief Access a register of the local APIC */
+#define LAPIC_REG(off) (*(volatile uint32_t *)(lapic_base + (off)))
+
+/** @brief Base address of the local APIC registers, NULL if disabled */
+static volatile char *lapic_base = NULL;
+
+/** @brief Whether the timer runs in TSC-deadline mode */
+static int lapic_tsc_deadline = 0;
+
+/** @brief APIC timer counts per TSC cycle, shifted left by 32 */
+static uint64_t lapic_counts_per_cycle = 0;
+
+/** @brief Turn TSC cycles into APIC timer counts
+ *
+ *  @param cycles TSC cycles
+ *  @return APIC timer counts, at least 1
+ */
+static uint32_t lapic_cycles_to_counts(uint64_t cycles)
+{
+	uint64_t counts;
+	/* Keep the product within 64 bits */
+	if (cycles > 0xFFFFFFFFULL)
+		cycles = 0xFFFFFFFFULL;
+	counts = (cycles * lapic_counts_per_cycle) >> 32;
+	if (counts == 0)
+		counts = 1;
+	if (counts > 0xFFFFFFFFULL)
+		counts = 0xFFFFFFFFULL;
+	return (uint32_t)counts;
+}
+
+/** @brief Measure the rate of the APIC timer against the TSC
+ */
+static void lapic_calibrate()
+{
+	uint64_t start,cycles = clock_hz() / 100;
+	uint32_t counted;
+
+	LAPIC_REG(LAPIC_TIMER_DIVIDE) = LAPIC_DIVIDE_16;
+	LAPIC_REG(LAPIC_LVT_TIMER) = LAPIC_LVT_MASKED | LAPIC_TIMER_ONE_SHOT;
+	LAPIC_REG(LAPIC_TIMER_INITIAL) = 0xFFFFFFFF;
+	start = rdtsc();
+	while (rdtsc() - start < cycles)
+		continue;
+	counted = 0xFFFFFFFF - LAPIC_REG(LAPIC_TIMER_CURRENT);
+	LAPIC_REG(LAPIC_TIMER_INITIAL) = 0;
+
+	if (cycles != 0)
+		lapic_counts_per_cycle = ((uint64_t)counted << 32) / cycles;
+}
+
+/** @brief Find and enable the local APIC
+ */
+int lapic_init(void)
+{
+	uint32_t regs[4];
+	uint32_t flags;
+	uint64_t base;
+
+	if (lapic_base != NULL)
+		return 1;
+	cpuid_regs(CPUID_FEATURES,regs);
+	if (!(regs[3] & CPUID_EDX_APIC) || clock_hz() == 0)
+		return -1;
+	lapic_tsc_deadline = (regs[2] & CPUID_ECX_TSC_DEADLINE) != 0;
+
+	flags = get_eflags();
+	disable_interrupts();
+	base = rdmsr(MSR_APIC_BASE);
+	wrmsr(MSR_APIC_BASE,base | MSR_APIC_BASE_ENABLE);
+	lapic_base = (volatile char *)(uint32_t)(base & MSR_APIC_BASE_ADDR);
+
+	LAPIC_REG(LAPIC_TPR) = 0;
+	/* Virtual wire mode: the 8259 keeps delivering through LINT0 */
+	LAPIC_REG(LAPIC_LVT_LINT0) = LAPIC_LVT_EXTINT;
+	LAPIC_REG(LAPIC_LVT_LINT1) = LAPIC_LVT_NMI;
+	LAPIC_REG(LAPIC_SVR) = LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR;
+
+	lapic_calibrate();
+	set_eflags(flags);
+	return 1;
+}
+
+/** @brief Whether lapic_init() enabled the local APIC
+ */
+int lapic_enabled(void)
+{
+	return lapic_base != NULL;
+}
+
+/** @brief Whether the timer runs in TSC-deadline mode
+ */
+int lapic_has_tsc_deadline(void)
+{
+	return lapic_tsc_deadline;
+}
+
+/** @brief Signal the end of an interrupt to the local APIC
+ */
+void lapic_eoi(void)
+{
+	LAPIC_REG(LAPIC_EOI) = 0;
+}
+
+/** @brief Interrupt every period TSC cycles
+ */
+void lapic_timer_periodic(uint64_t cycles)
+{
+	LAPIC_REG(LAPIC_TIMER_DIVIDE) = LAPIC_DIVIDE_16;
+	LAPIC_REG(LAPIC_LVT_TIMER) = LAPIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC;
+	LAPIC_REG(LAPIC_TIMER_INITIAL) = lapic_cycles_to_counts(cycles);
+}
+
+/** @brief Interrupt once when the TSC reaches a deadline
+ */
+void lapic_timer_one_shot(uint64_t deadline)
+{
+	uint64_t now;
+	if (lapic_tsc_deadline)
+	{
+		LAPIC_REG(LAPIC_LVT_TIMER) = LAPIC_TIMER_VECTOR |
+			LAPIC_TIMER_TSC_DEADLINE;
+		wrmsr(MSR_TSC_DEADLINE,deadline);
+		return;
+	}
+	now = rdtsc();
+	LAPIC_REG(LAPIC_TIMER_DIVIDE) = LAPIC_DIVIDE_16;
+	LAPIC_REG(LAPIC_LVT_TIMER) = LAPIC_TIMER_VECTOR | LAPIC_TIMER_ONE_SHOT;
+	LAPIC_REG(LAPIC_TIMER_INITIAL) =
+		lapic_cycles_to_counts(deadline > now ? deadline - now : 1);
+}
+
+/** @brief Stop the APIC timer
+ */
+void lapic_timer_stop(void)
+{
+	if (lapic_tsc_deadline)
+		wrmsr(MSR_TSC_DEADLINE,0);
+	LAPIC_REG(LAPIC_LVT_TIMER) = LAPIC_LVT_MASKED;
+	LAPIC_REG(LAPIC_TIMER_INITIAL) = 0;
+}
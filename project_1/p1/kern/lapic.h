@@ -0,0 +1,168 @@
+/** @file lapic.h
+ *  @brief Local APIC and APIC timer
+ *
+ *  Optional backend for the timer driver. The local APIC is found
+ *  with CPUID, its timer runs in TSC-deadline mode when the CPU has
+ *  it and in one-shot mode otherwise, and the end of interrupt is a
+ *  single store to its memory mapped EOI register.
+ *
+ *  The keyboard stays on the 8259, which reaches the CPU through
+ *  LINT0 in virtual wire mode.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No I/O APIC support, legacy lines still go through the 8259
+ */
+
+#ifndef _LAPIC_H_
+#define _LAPIC_H_
+
+#include <stdint.h>
+
+/** @brief CPUID leaf with the feature flags */
+#define CPUID_FEATURES 1
+
+/** @brief CPUID.1:EDX, the CPU has a local APIC */
+#define CPUID_EDX_APIC (1 << 9)
+
+/** @brief CPUID.1:ECX, the APIC timer has TSC-deadline mode */
+#define CPUID_ECX_TSC_DEADLINE (1 << 24)
+
+/** @brief MSR holding the APIC base address */
+#define MSR_APIC_BASE 0x1B
+
+/** @brief Global enable bit of MSR_APIC_BASE */
+#define MSR_APIC_BASE_ENABLE (1 << 11)
+
+/** @brief Address bits of MSR_APIC_BASE */
+#define MSR_APIC_BASE_ADDR 0xFFFFF000
+
+/** @brief MSR the TSC deadline is written to */
+#define MSR_TSC_DEADLINE 0x6E0
+
+/** @brief Task priority register */
+#define LAPIC_TPR 0x080
+
+/** @brief End of interrupt register */
+#define LAPIC_EOI 0x0B0
+
+/** @brief Spurious interrupt vector register */
+#define LAPIC_SVR 0x0F0
+
+/** @brief LVT timer register */
+#define LAPIC_LVT_TIMER 0x320
+
+/** @brief LVT LINT0 register */
+#define LAPIC_LVT_LINT0 0x350
+
+/** @brief LVT LINT1 register */
+#define LAPIC_LVT_LINT1 0x360
+
+/** @brief Timer initial count register */
+#define LAPIC_TIMER_INITIAL 0x380
+
+/** @brief Timer current count register */
+#define LAPIC_TIMER_CURRENT 0x390
+
+/** @brief Timer divide configuration register */
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+/** @brief Software enable bit of the SVR */
+#define LAPIC_SVR_ENABLE 0x100
+
+/** @brief LVT entry masked */
+#define LAPIC_LVT_MASKED (1 << 16)
+
+/** @brief LVT delivery mode NMI */
+#define LAPIC_LVT_NMI 0x400
+
+/** @brief LVT delivery mode ExtINT (8259 in virtual wire mode) */
+#define LAPIC_LVT_EXTINT 0x700
+
+/** @brief LVT timer one-shot mode */
+#define LAPIC_TIMER_ONE_SHOT (0 << 17)
+
+/** @brief LVT timer periodic mode */
+#define LAPIC_TIMER_PERIODIC (1 << 17)
+
+/** @brief LVT timer TSC-deadline mode */
+#define LAPIC_TIMER_TSC_DEADLINE (2 << 17)
+
+/** @brief Divide configuration: divide by 16 */
+#define LAPIC_DIVIDE_16 0x3
+
+/** @brief Vector of the APIC timer, right above the PIC vectors */
+#define LAPIC_TIMER_VECTOR 0x30
+
+/** @brief Vector of APIC spurious interrupts, never acknowledged */
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+/** @brief Run the CPUID instruction
+ *
+ *  @param leaf Value of EAX
+ *  @param regs Where EAX, EBX, ECX and EDX are stored
+ *  @return void
+ */
+void cpuid_regs(uint32_t leaf, uint32_t regs[4]);
+
+/** @brief Read a model specific register
+ *
+ *  @param msr Register
+ *  @return Value
+ */
+uint64_t rdmsr(uint32_t msr);
+
+/** @brief Write a model specific register
+ *
+ *  @param msr Register
+ *  @param value Value
+ *  @return void
+ */
+void wrmsr(uint32_t msr, uint64_t value);
+
+/** @brief Find and enable the local APIC
+ *
+ *  Needs the TSC clock (clock_init()) to calibrate the APIC timer.
+ *
+ *  @return 1 on success, -1 if the CPU has no local APIC
+ */
+int lapic_init(void);
+
+/** @brief Whether lapic_init() enabled the local APIC
+ *
+ *  @return Non zero if enabled
+ */
+int lapic_enabled(void);
+
+/** @brief Whether the timer runs in TSC-deadline mode
+ *
+ *  @return Non zero if so
+ */
+int lapic_has_tsc_deadline(void);
+
+/** @brief Signal the end of an interrupt to the local APIC
+ *
+ *  @return void
+ */
+void lapic_eoi(void);
+
+/** @brief Interrupt every period TSC cycles
+ *
+ *  @param cycles Period in TSC cycles
+ *  @return void
+ */
+void lapic_timer_periodic(uint64_t cycles);
+
+/** @brief Interrupt once when the TSC reaches a deadline
+ *
+ *  @param deadline Absolute TSC value
+ *  @return void
+ */
+void lapic_timer_one_shot(uint64_t deadline);
+
+/** @brief Stop the APIC timer
+ *
+ *  @return void
+ */
+void lapic_timer_stop(void);
+
+#endif /* _LAPIC_H_ */
@@ -0,0 +1,139 @@
+/** @file leaderboard.c
+ *
+ *  @brief Implementation of the high score table
+ *
+ *  What it contains :
+ *
+ *  -- Entries compare by moves and then by seconds. The insert
+ *  position is the first entry that is strictly worse, found with a
+ *  binary search; memmove() makes room for it
+ *  -- A saved table is a header (magic, version, count, checksum)
+ *  followed by the entries. The checksum is a Fletcher-32 over the
+ *  count and the entries
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "leaderboard.h"
+
+/** @brief Header of a saved table */
+typedef struct leaderboard_header {
+	/** @brief LEADERBOARD_MAGIC */
+	uint32_t magic;
+	/** @brief LEADERBOARD_VERSION */
+	uint32_t version;
+	/** @brief Entries that follow */
+	uint32_t count;
+	/** @brief Fletcher-32 of count and entries */
+	uint32_t checksum;
+} leaderboard_header_t;
+
+/** @brief Whether entry a ranks below a game with moves and seconds */
+static int leaderboard_worse(const leaderboard_entry_t *a, int moves,
+		int seconds)
+{
+	if (a->moves != moves)
+		return a->moves > moves;
+	return a->seconds > seconds;
+}
+
+/** @brief Fletcher-32 of a saved table
+ *
+ *  @param count Number of entries
+ *  @param entries Entries
+ */
+static uint32_t leaderboard_checksum(uint32_t count,
+		const leaderboard_entry_t *entries)
+{
+	const uint16_t *words = (const uint16_t *)entries;
+	uint32_t a = count & 0xFFFF,b = a;
+	uint32_t i,n = count * sizeof(*entries) / sizeof(uint16_t);
+
+	for (i = 0; i < n; i++)
+	{
+		a = (a + words[i]) % 0xFFFF;
+		b = (b + a) % 0xFFFF;
+	}
+	return (b << 16) | a;
+}
+
+/** @brief Empty a table
+ */
+void leaderboard_init(leaderboard_t *board)
+{
+	memset(board,0,sizeof(*board));
+}
+
+/** @brief Add a finished game
+ */
+int leaderboard_insert(leaderboard_t *board, int moves, int seconds,
+		int size, int colors)
+{
+	int lo = 0,hi = board->count,mid;
+	leaderboard_entry_t *e;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (leaderboard_worse(&board->entries[mid],moves,seconds))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	if (lo == LEADERBOARD_CAPACITY)
+		return -1;
+	if (board->count < LEADERBOARD_CAPACITY)
+		board->count++;
+	memmove(&board->entries[lo + 1],&board->entries[lo],
+			(board->count - 1 - lo) * sizeof(board->entries[0]));
+	e = &board->entries[lo];
+	e->moves = moves;
+	e->seconds = seconds;
+	e->size = size;
+	e->colors = colors;
+	e->pad = 0;
+	return lo;
+}
+
+/** @brief Save a table to memory
+ */
+int leaderboard_save(const leaderboard_t *board, void *mem, int len)
+{
+	leaderboard_header_t *h = mem;
+
+	if (len < (int)(sizeof(*h) + sizeof(board->entries)))
+		return -1;
+	h->magic = LEADERBOARD_MAGIC;
+	h->version = LEADERBOARD_VERSION;
+	h->count = board->count;
+	memcpy(h + 1,board->entries,board->count * sizeof(board->entries[0]));
+	h->checksum = leaderboard_checksum(h->count,
+			(const leaderboard_entry_t *)(h + 1));
+	return 1;
+}
+
+/** @brief Restore a table saved with leaderboard_save()
+ */
+int leaderboard_restore(leaderboard_t *board, const void *mem, int len)
+{
+	const leaderboard_header_t *h = mem;
+	const leaderboard_entry_t *entries = (const leaderboard_entry_t *)(h + 1);
+	uint32_t i;
+
+	if (len < (int)(sizeof(*h) + sizeof(board->entries)) ||
+			h->magic != LEADERBOARD_MAGIC || h->version != LEADERBOARD_VERSION ||
+			h->count > LEADERBOARD_CAPACITY ||
+			h->checksum != leaderboard_checksum(h->count,entries))
+		return -1;
+	/* A valid table is sorted, anything else did not come from here */
+	for (i = 1; i < h->count; i++)
+		if (leaderboard_worse(&entries[i - 1],entries[i].moves,
+				entries[i].seconds))
+			return -1;
+	board->count = h->count;
+	memcpy(board->entries,entries,h->count * sizeof(board->entries[0]));
+	return 1;
+}
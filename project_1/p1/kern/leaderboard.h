@@ -0,0 +1,99 @@
+/** @file leaderboard.h
+ *  @brief High score table kept sorted by moves, then time
+ *
+ *  Entries live in a fixed array in rank order. An insert finds its
+ *  rank with a binary search and shifts the worse entries down one,
+ *  dropping the last one when the table is full.
+ *
+ *  The table can be saved to and restored from a block of memory,
+ *  with a magic number and a checksum to tell a saved table from
+ *  whatever the memory held before. The game keeps it in a page below
+ *  1 MB, which the allocator never hands out (see 410kern/entry.c),
+ *  so the scores outlive a restart of kernel_main().
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _LEADERBOARD_H_
+#define _LEADERBOARD_H_
+
+#include <stdint.h>
+
+/** @brief Entries the table holds */
+#define LEADERBOARD_CAPACITY 16
+
+/** @brief Marks a saved table, "LDRB" */
+#define LEADERBOARD_MAGIC 0x4C445242
+
+/** @brief Layout version of a saved table */
+#define LEADERBOARD_VERSION 1
+
+/** @brief Physical page the game saves the table in */
+#define LEADERBOARD_SAVE_ADDR 0x7000
+
+/** @brief Size of that page */
+#define LEADERBOARD_SAVE_SIZE 0x1000
+
+/** @brief Finished game */
+typedef struct leaderboard_entry {
+	/** @brief Moves used */
+	uint16_t moves;
+	/** @brief Seconds taken */
+	uint16_t seconds;
+	/** @brief Rows (and columns) of the board */
+	uint8_t size;
+	/** @brief Number of colors */
+	uint8_t colors;
+	/** @brief Unused, keeps entries 8 bytes */
+	uint16_t pad;
+} leaderboard_entry_t;
+
+/** @brief High score table */
+typedef struct leaderboard {
+	/** @brief Entries in use */
+	int count;
+	/** @brief Entries, best first */
+	leaderboard_entry_t entries[LEADERBOARD_CAPACITY];
+} leaderboard_t;
+
+/** @brief Empty a table
+ *
+ *  @param board Table
+ *  @return void
+ */
+void leaderboard_init(leaderboard_t *board);
+
+/** @brief Add a finished game
+ *
+ *  Ties go after the entries already in the table.
+ *
+ *  @param board Table
+ *  @param moves Moves used
+ *  @param seconds Seconds taken
+ *  @param size Rows of the board
+ *  @param colors Number of colors
+ *  @return Rank (0 is best), -1 if the table is full of better games
+ */
+int leaderboard_insert(leaderboard_t *board, int moves, int seconds,
+		int size, int colors);
+
+/** @brief Save a table to memory
+ *
+ *  @param board Table
+ *  @param mem Where to save it
+ *  @param len Bytes at mem
+ *  @return 1 on success, -1 if len is too small
+ */
+int leaderboard_save(const leaderboard_t *board, void *mem, int len);
+
+/** @brief Restore a table saved with leaderboard_save()
+ *
+ *  @param board Table, left alone on failure
+ *  @param mem Where it was saved
+ *  @param len Bytes at mem
+ *  @return 1 on success, -1 if mem holds no valid table
+ */
+int leaderboard_restore(leaderboard_t *board, const void *mem, int len);
+
+#endif /* _LEADERBOARD_H_ */
@@ -0,0 +1,215 @@
+/** @file replay.c
+ *
+ *  @brief Implementation of session recording and replay
+ *
+ *  What it contains :
+ *
+ *  1. Recording :
+ *
+ *  -- An event is the key and the ticks since the previous one, three
+ *  bytes, in a fixed array; nothing is allocated while playing
+ *  -- The dump goes through lprintf() a line at a time, so it ends up
+ *  in the simics log next to the interrupt statistics
+ *
+ *  2. Replay :
+ *
+ *  -- The board is drawn again from the seed in the order
+ *  draw_game_panel() uses, one genrand() per block. choose_bg_color()
+ *  maps colour index i to BGND colour i << 4, which is BITBOARD_COLOR()
+ *  -- Keys follow move_cursor(): w,a,s,d move inside the board, space
+ *  marks the colour under the cursor, q quits. The other keys do not
+ *  change the board
+ *  -- A mark is mark(): count the move, fail when the count reaches
+ *  the limit, otherwise flood_fill() the board, move the bitboard and
+ *  finish when its region covers the board
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <simics.h>
+#include <mt19937int.h>
+#include "replay.h"
+#include "flood.h"
+#include "bitboard.h"
+
+/** @brief Characters of one event in the dump, "65535:ff " */
+#define REPLAY_EVENT_CHARS 9
+
+/** @brief Hex digits */
+static const char replay_hex[] = "0123456789abcdef";
+
+/** @brief Board of the replay, one BGND colour per block */
+static uint8_t replay_board[BITBOARD_MAX_ROWS * BITBOARD_MAX_COLS];
+
+/** @brief Bitboard of the replay */
+static bitboard_t replay_bits;
+
+/** @brief Start recording a session
+ */
+void replay_start(replay_log_t *log, uint32_t seed, int rows, int cols,
+		int colors, int limit, unsigned int tick)
+{
+	log->seed = seed;
+	log->rows = rows;
+	log->cols = cols;
+	log->colors = colors;
+	log->limit = limit;
+	log->moves = 0;
+	log->outcome = REPLAY_PLAYING;
+	log->count = 0;
+	log->last_tick = tick;
+}
+
+/** @brief Record a key
+ */
+int replay_record(replay_log_t *log, unsigned int tick, char key)
+{
+	unsigned int delta = tick - log->last_tick;
+	if (log->count == REPLAY_MAX_EVENTS)
+		return -1;
+	if (delta > REPLAY_MAX_DELTA)
+		delta = REPLAY_MAX_DELTA;
+	log->events[log->count].delta = delta;
+	log->events[log->count].key = key;
+	log->count++;
+	log->last_tick = tick;
+	return 1;
+}
+
+/** @brief Record how the session ended
+ */
+void replay_end(replay_log_t *log, int outcome, int moves)
+{
+	log->outcome = outcome;
+	log->moves = moves;
+}
+
+/** @brief Append an event to a dump line
+ *
+ *  @return Characters written
+ */
+static int replay_format_event(char *buf, const replay_event_t *event)
+{
+	char digits[5];
+	unsigned int delta = event->delta;
+	uint8_t key = event->key;
+	int n = 0,len = 0;
+
+	do
+	{
+		digits[n++] = '0' + delta % 10;
+		delta /= 10;
+	} while (delta != 0);
+	while (n > 0)
+		buf[len++] = digits[--n];
+	buf[len++] = ':';
+	buf[len++] = replay_hex[key >> 4];
+	buf[len++] = replay_hex[key & 0xF];
+	buf[len++] = ' ';
+	return len;
+}
+
+/** @brief Write a log to the simics log
+ */
+void replay_dump(const replay_log_t *log)
+{
+	char line[REPLAY_EVENTS_PER_LINE * REPLAY_EVENT_CHARS + 16];
+	int i,len = 0;
+
+	lprintf("replay v1 seed=%u size=%dx%d colors=%d limit=%d events=%d "
+			"moves=%d outcome=%d",(unsigned int)log->seed,log->rows,log->cols,
+			log->colors,log->limit,log->count,log->moves,log->outcome);
+	for (i = 0; i < log->count; i++)
+	{
+		if (len == 0)
+			len = strlen(strcpy(line,"replay ev "));
+		len += replay_format_event(line + len,&log->events[i]);
+		if ((i + 1) % REPLAY_EVENTS_PER_LINE == 0 || i + 1 == log->count)
+		{
+			line[len - 1] = '\0';
+			lprintf("%s",line);
+			len = 0;
+		}
+	}
+}
+
+/** @brief Play a session again without console or timer
+ */
+int replay_run(const replay_log_t *log, replay_result_t *result)
+{
+	int rows = log->rows,cols = log->cols;
+	int i,row = 0,col = 0,moves = 0,outcome = REPLAY_PLAYING;
+	uint32_t hash = 2166136261u;
+	uint8_t color;
+
+	if (rows <= 0 || cols <= 0 || rows > BITBOARD_MAX_ROWS ||
+			cols > BITBOARD_MAX_COLS || log->colors == 0 ||
+			log->colors > BITBOARD_COLORS || log->count > REPLAY_MAX_EVENTS)
+		return -1;
+
+	sgenrand(log->seed);
+	for (i = 0; i < rows * cols; i++)
+		replay_board[i] = BITBOARD_COLOR(genrand() % log->colors);
+	bitboard_load(&replay_bits,replay_board,rows,cols);
+
+	for (i = 0; i < log->count && outcome == REPLAY_PLAYING; i++)
+	{
+		switch (log->events[i].key)
+		{
+			case 'w':
+				if (row > 0)
+					row--;
+				break;
+
+			case 'a':
+				if (col > 0)
+					col--;
+				break;
+
+			case 's':
+				if (row + 1 < rows)
+					row++;
+				break;
+
+			case 'd':
+				if (col + 1 < cols)
+					col++;
+				break;
+
+			case ' ':
+				color = replay_board[row * cols + col];
+				if (color == replay_board[0])
+					break;
+				moves++;
+				if (moves >= log->limit)
+				{
+					outcome = REPLAY_FAILED;
+					break;
+				}
+				flood_fill(replay_board,rows,cols,0,0,color,NULL,NULL);
+				bitboard_move(&replay_bits,BITBOARD_PLANE(color));
+				if (bitboard_is_done(&replay_bits))
+					outcome = REPLAY_FINISHED;
+				break;
+
+			case 'q':
+				outcome = REPLAY_QUIT;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	/* FNV-1a of the final board */
+	for (i = 0; i < rows * cols; i++)
+		hash = (hash ^ replay_board[i]) * 16777619u;
+	result->moves = moves;
+	result->outcome = outcome;
+	result->region = bitset_count(&replay_bits.region);
+	result->checksum = hash;
+	return 1;
+}
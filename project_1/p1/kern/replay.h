@@ -0,0 +1,140 @@
+/** @file replay.h
+ *  @brief Recording and headless replay of game sessions
+ *
+ *  A session is the MT19937 seed the board was generated from, the
+ *  board settings and move limit, and the keys read in game_run()
+ *  with the number of ticks since the previous key. At the end of a
+ *  session the log is written to the simics log with lprintf() in the
+ *  format below, one header line and then lines of events:
+ *
+ *  replay v1 seed=S size=RxC colors=K limit=L events=N moves=M outcome=O
+ *  replay ev DT:KK DT:KK ...
+ *
+ *  where DT is the tick delta in decimal and KK the key in hex.
+ *  replay_run() plays a log again with the game rules but no console
+ *  or timer, which is how tests/replay_bench.c checks and times the
+ *  game logic on the host.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Keys read while paused or in the help screen are not
+ *  recorded, they do not change the board
+ */
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <stdint.h>
+
+/** @brief Most keys recorded per session, later keys are dropped */
+#define REPLAY_MAX_EVENTS 1024
+
+/** @brief Largest tick delta an event can hold */
+#define REPLAY_MAX_DELTA 0xFFFF
+
+/** @brief Events per line of the dump */
+#define REPLAY_EVENTS_PER_LINE 12
+
+/** @brief Session still running */
+#define REPLAY_PLAYING 0
+/** @brief Board flooded within the limit */
+#define REPLAY_FINISHED 1
+/** @brief Move limit reached */
+#define REPLAY_FAILED 2
+/** @brief Player quit */
+#define REPLAY_QUIT 3
+
+/** @brief Key read during a session */
+typedef struct replay_event {
+	/** @brief Ticks since the previous key */
+	uint16_t delta;
+	/** @brief Key */
+	char key;
+} replay_event_t;
+
+/** @brief Recorded session */
+typedef struct replay_log {
+	/** @brief Seed given to sgenrand() */
+	uint32_t seed;
+	/** @brief Rows of the board */
+	uint8_t rows;
+	/** @brief Columns of the board */
+	uint8_t cols;
+	/** @brief Number of colors */
+	uint8_t colors;
+	/** @brief Move limit (max_iterations) */
+	uint8_t limit;
+	/** @brief Moves counted by the game */
+	uint8_t moves;
+	/** @brief How the session ended, REPLAY_* */
+	uint8_t outcome;
+	/** @brief Events recorded */
+	uint16_t count;
+	/** @brief Tick of the last event */
+	uint32_t last_tick;
+	/** @brief Events */
+	replay_event_t events[REPLAY_MAX_EVENTS];
+} replay_log_t;
+
+/** @brief Result of a headless replay */
+typedef struct replay_result {
+	/** @brief Moves counted, as the game counts them */
+	int moves;
+	/** @brief How the session ended, REPLAY_* */
+	int outcome;
+	/** @brief Blocks in the flooded region at the end */
+	int region;
+	/** @brief Hash of the board at the end */
+	uint32_t checksum;
+} replay_result_t;
+
+/** @brief Start recording a session
+ *
+ *  @param log Log
+ *  @param seed Seed given to sgenrand() before the board was drawn
+ *  @param rows Rows of the board
+ *  @param cols Columns of the board
+ *  @param colors Number of colors
+ *  @param limit Move limit
+ *  @param tick Current tick
+ *  @return void
+ */
+void replay_start(replay_log_t *log, uint32_t seed, int rows, int cols,
+		int colors, int limit, unsigned int tick);
+
+/** @brief Record a key
+ *
+ *  @param log Log
+ *  @param tick Current tick
+ *  @param key Key
+ *  @return 1 if recorded, -1 if the log is full
+ */
+int replay_record(replay_log_t *log, unsigned int tick, char key);
+
+/** @brief Record how the session ended
+ *
+ *  @param log Log
+ *  @param outcome REPLAY_*
+ *  @param moves Moves counted by the game
+ *  @return void
+ */
+void replay_end(replay_log_t *log, int outcome, int moves);
+
+/** @brief Write a log to the simics log
+ *
+ *  @param log Log
+ *  @return void
+ */
+void replay_dump(const replay_log_t *log);
+
+/** @brief Play a session again without console or timer
+ *
+ *  Regenerates the board from the seed and applies the keys with the
+ *  rules of move_cursor() and mark(). Reseeds the MT19937 generator.
+ *
+ *  @param log Log
+ *  @param result Where the result is stored
+ *  @return 1 on success, -1 if the log is not a valid session
+ */
+int replay_run(const replay_log_t *log, replay_result_t *result);
+
+#endif /* _REPLAY_H_ */
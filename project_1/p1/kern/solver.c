@@ -0,0 +1,306 @@
+/** @file solver.c
+ *
+ *  @brief Implementation of the Flood-It solver
+ *
+ *  What it contains :
+ *
+ *  1. State :
+ *
+ *  -- Blocks outside the region never change colour, so a state is
+ *  just the region and its colour. The planes of the board it was
+ *  started from give the colour of every other block
+ *  -- A move to plane p floods the region inside plane p | region
+ *
+ *  2. Search :
+ *
+ *  -- Greedy: take the move whose best follow up move gives the
+ *  largest region. This always ends, every chosen move adds a block
+ *  -- Beam: expand every state of a layer with every colour, drop
+ *  moves that add nothing, states seen twice in the layer and states
+ *  that cannot beat the best solution, keep the SOLVER_BEAM_WIDTH
+ *  largest regions (fewer colours left breaks ties)
+ *  -- The first layer holding a solved board ends the search, no
+ *  later layer can hold a shorter one
+ *  -- The clock is checked before every state is expanded
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "solver.h"
+
+/** @brief Children of one layer at most */
+#define SOLVER_CANDIDATES (SOLVER_BEAM_WIDTH * BITBOARD_COLORS)
+
+/** @brief Slots of the duplicate table, a power of two */
+#define SOLVER_HASH_SIZE 1024
+
+/** @brief Empty slot of the duplicate table */
+#define SOLVER_HASH_EMPTY -1
+
+/** @brief Search state */
+typedef struct solver_state {
+	/** @brief Flooded region */
+	bitset_t region;
+	/** @brief Blocks in the region */
+	int16_t count;
+	/** @brief Plane of the region */
+	int8_t color;
+	/** @brief Colours with blocks outside the region */
+	int8_t left;
+	/** @brief Index of the parent in the previous layer */
+	int16_t parent;
+} solver_state_t;
+
+/** @brief Current and next layer of the beam */
+static solver_state_t solver_beam[SOLVER_BEAM_WIDTH];
+
+/** @brief Children of the current layer */
+static solver_state_t solver_cand[SOLVER_CANDIDATES];
+
+/** @brief Children kept for the next layer, best first */
+static int16_t solver_keep[SOLVER_BEAM_WIDTH];
+
+/** @brief Duplicate table, indices into solver_cand */
+static int16_t solver_hash[SOLVER_HASH_SIZE];
+
+/** @brief Parent of each state, per layer */
+static int16_t solver_parent[SOLVER_MAX_MOVES + 1][SOLVER_BEAM_WIDTH];
+
+/** @brief Move that led to each state, per layer */
+static uint8_t solver_move[SOLVER_MAX_MOVES + 1][SOLVER_BEAM_WIDTH];
+
+/** @brief Best solution found so far */
+static uint8_t solver_best[SOLVER_MAX_MOVES];
+
+/** @brief Count the colours with blocks outside a region */
+static int solver_left(const bitboard_t *board, const bitset_t *region)
+{
+	int p,i,left = 0;
+	uint32_t outside;
+	for (p = 0; p < BITBOARD_COLORS; p++)
+	{
+		outside = 0;
+		for (i = 0; i < BITBOARD_WORDS; i++)
+			outside |= board->plane[p].w[i] & ~region->w[i];
+		left += outside != 0;
+	}
+	return left;
+}
+
+/** @brief Play a move from a state
+ *
+ *  @param board Board the search started from
+ *  @param state State to move from
+ *  @param plane Colour of the move
+ *  @param child Where the new state is stored (left is not set)
+ */
+static void solver_play(const bitboard_t *board, const solver_state_t *state,
+		int plane, solver_state_t *child)
+{
+	bitset_t allowed;
+	int i;
+
+	for (i = 0; i < BITBOARD_WORDS; i++)
+		allowed.w[i] = board->plane[plane].w[i] | state->region.w[i];
+	child->region = state->region;
+	bitset_flood(&child->region,&allowed);
+	child->count = bitset_count(&child->region);
+	child->color = plane;
+}
+
+/** @brief Greedy solution with one move of lookahead
+ *
+ *  @return Number of moves, -1 if more than max are needed
+ */
+static int solver_greedy(const bitboard_t *board, const solver_state_t *start,
+		uint8_t *moves, int max)
+{
+	solver_state_t state = *start,child,next,best_child;
+	int p,q,n = 0,score,best_score,best;
+
+	while (state.count < board->cells)
+	{
+		if (n == max)
+			return -1;
+		best = -1;
+		best_score = -1;
+		for (p = 0; p < BITBOARD_COLORS; p++)
+		{
+			if (p == state.color)
+				continue;
+			solver_play(board,&state,p,&child);
+			if (child.count == state.count)
+				continue;
+			score = child.count;
+			if (child.count < board->cells)
+			{
+				for (q = 0; q < BITBOARD_COLORS; q++)
+				{
+					if (q == p)
+						continue;
+					solver_play(board,&child,q,&next);
+					if (next.count > score)
+						score = next.count;
+				}
+			}
+			/* The immediate gain breaks ties */
+			score = score * (BITBOARD_MAX_ROWS * BITBOARD_STRIDE) +
+				child.count;
+			if (score > best_score)
+			{
+				best_score = score;
+				best = p;
+				best_child = child;
+			}
+		}
+		moves[n++] = best;
+		state = best_child;
+	}
+	return n;
+}
+
+/** @brief Rank of a state in the beam, larger is better */
+static int solver_rank(const solver_state_t *state)
+{
+	return state->count * (BITBOARD_COLORS + 1) +
+		(BITBOARD_COLORS - state->left);
+}
+
+/** @brief Find a state with the same region in the duplicate table
+ *
+ *  @return 1 if there is one, 0 if the state was added
+ */
+static int solver_seen(int index)
+{
+	const bitset_t *region = &solver_cand[index].region;
+	uint32_t h = 0;
+	int i,slot;
+
+	for (i = 0; i < BITBOARD_WORDS; i++)
+		h = (h ^ region->w[i]) * 0x9E3779B1;
+	slot = (h >> 16) & (SOLVER_HASH_SIZE - 1);
+	while (solver_hash[slot] != SOLVER_HASH_EMPTY)
+	{
+		if (memcmp(&solver_cand[solver_hash[slot]].region,region,
+				sizeof(*region)) == 0)
+			return 1;
+		slot = (slot + 1) & (SOLVER_HASH_SIZE - 1);
+	}
+	solver_hash[slot] = index;
+	return 0;
+}
+
+/** @brief Keep a child if it ranks among the best of the layer */
+static void solver_select(int index, int *kept)
+{
+	int rank = solver_rank(&solver_cand[index]);
+	int i = *kept;
+
+	if (i == SOLVER_BEAM_WIDTH)
+	{
+		if (rank <= solver_rank(&solver_cand[solver_keep[i - 1]]))
+			return;
+		i--;
+	} else
+		(*kept)++;
+	while (i > 0 && solver_rank(&solver_cand[solver_keep[i - 1]]) < rank)
+	{
+		solver_keep[i] = solver_keep[i - 1];
+		i--;
+	}
+	solver_keep[i] = index;
+}
+
+/** @brief Find a short solution of a board
+ */
+int solver_solve(const bitboard_t *board, uint8_t *moves, int max_moves,
+		solver_clock_fn now_ns, uint64_t budget_ns, solver_stats_t *stats)
+{
+	solver_state_t start,child;
+	solver_stats_t st;
+	uint64_t t0 = now_ns != NULL ? (*now_ns)() : 0;
+	int best,depth,width,kept,ncand,i,p,d,index;
+
+	memset(&st,0,sizeof(st));
+	start.region = board->region;
+	start.count = bitset_count(&board->region);
+	start.color = board->color;
+	start.left = solver_left(board,&board->region);
+	start.parent = 0;
+
+	best = solver_greedy(board,&start,solver_best,SOLVER_MAX_MOVES);
+	st.greedy_moves = best;
+	if (best < 0)
+		goto done;
+
+	solver_beam[0] = start;
+	width = 1;
+	for (depth = 0; depth + 1 < best && width > 0; depth++)
+	{
+		ncand = 0;
+		kept = 0;
+		memset(solver_hash,0xFF,sizeof(solver_hash));
+		for (i = 0; i < width; i++)
+		{
+			if (now_ns != NULL && (*now_ns)() - t0 > budget_ns)
+			{
+				st.timed_out = 1;
+				goto done;
+			}
+			for (p = 0; p < BITBOARD_COLORS; p++)
+			{
+				if (p == solver_beam[i].color)
+					continue;
+				solver_play(board,&solver_beam[i],p,&child);
+				st.nodes++;
+				if (child.count == solver_beam[i].count)
+					continue;
+				if (child.count == board->cells)
+				{
+					/* Shortest the beam can find, trace it back */
+					best = depth + 1;
+					solver_best[depth] = p;
+					index = i;
+					for (d = depth; d > 0; d--)
+					{
+						solver_best[d - 1] = solver_move[d][index];
+						index = solver_parent[d][index];
+					}
+					goto done;
+				}
+				child.left = solver_left(board,&child.region);
+				if (depth + 1 + child.left >= best)
+					continue;
+				child.parent = i;
+				solver_cand[ncand] = child;
+				if (solver_seen(ncand))
+					continue;
+				solver_select(ncand,&kept);
+				ncand++;
+			}
+		}
+		for (i = 0; i < kept; i++)
+		{
+			solver_beam[i] = solver_cand[solver_keep[i]];
+			solver_parent[depth + 1][i] = solver_beam[i].parent;
+			solver_move[depth + 1][i] = solver_beam[i].color;
+		}
+		width = kept;
+		st.layers++;
+	}
+
+done:
+	if (best > max_moves)
+		best = -1;
+	if (best > 0)
+		memcpy(moves,solver_best,best);
+	st.moves = best;
+	if (now_ns != NULL)
+		st.ns = (*now_ns)() - t0;
+	if (stats != NULL)
+		*stats = st;
+	return best;
+}
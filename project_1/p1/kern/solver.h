@@ -0,0 +1,70 @@
+/** @file solver.h
+ *  @brief Flood-It solver used to set the move limit of a board
+ *
+ *  A greedy search with one move of lookahead always gives a
+ *  solution. A beam search then looks for a shorter one until it runs
+ *  out of layers or time. States whose depth plus the number of
+ *  colours left outside the region (each move removes at most one
+ *  colour) is not below the best solution are dropped.
+ *
+ *  The solver only needs the bitboard, so it also builds on the host
+ *  (see tests/solver_bench.c).
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _SOLVER_H_
+#define _SOLVER_H_
+
+#include <stdint.h>
+#include "bitboard.h"
+
+/** @brief Longest solution the solver keeps track of */
+#define SOLVER_MAX_MOVES 64
+
+/** @brief States kept per layer of the beam search */
+#ifndef SOLVER_BEAM_WIDTH
+#define SOLVER_BEAM_WIDTH 48
+#endif
+
+/** @brief Moves the player gets on top of the solver's solution */
+#define SOLVER_SLACK 2
+
+/** @brief Time the game gives the solver for a new board */
+#define SOLVER_BUDGET_NS 50000000ULL
+
+/** @brief Clock used for the time budget, in nanoseconds */
+typedef uint64_t (*solver_clock_fn)(void);
+
+/** @brief What the last search did */
+typedef struct solver_stats {
+	/** @brief Length of the greedy solution */
+	int greedy_moves;
+	/** @brief Length of the solution returned */
+	int moves;
+	/** @brief Beam layers expanded */
+	int layers;
+	/** @brief Moves evaluated */
+	int nodes;
+	/** @brief Whether the time budget cut the search short */
+	int timed_out;
+	/** @brief Time taken, 0 without a clock */
+	uint64_t ns;
+} solver_stats_t;
+
+/** @brief Find a short solution of a board
+ *
+ *  @param board Board, with the region as it is now
+ *  @param moves Where the solution is stored, as colour planes
+ *  @param max_moves Room in moves
+ *  @param now_ns Clock for the budget, NULL to search all layers
+ *  @param budget_ns Time after which the beam search stops
+ *  @param stats Where to store what the search did, may be NULL
+ *
+ *  @return Number of moves, or -1 if no solution fits in max_moves
+ */
+int solver_solve(const bitboard_t *board, uint8_t *moves, int max_moves,
+		solver_clock_fn now_ns, uint64_t budget_ns, solver_stats_t *stats);
+
+#endif /* _SOLVER_H_ */
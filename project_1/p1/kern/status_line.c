@@ -0,0 +1,98 @@
+/** @file status_line.c
+ *
+ *  @brief Implementation of the status fields
+ *
+ *  What it contains :
+ *
+ *  -- The new text is compared with the cached one character by
+ *  character. Every run of differing characters is one
+ *  draw_char_run() call
+ *  -- Text shorter than last time is followed by spaces over the old
+ *  characters
+ *  -- Numbers are converted with a divide by ten loop into a small
+ *  local buffer, no doprnt
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include "status_line.h"
+#include "console_driver.h"
+
+/** @brief Space, what an unused character of a field shows */
+#define STATUS_BLANK ' '
+
+/** @brief Digits of the largest unsigned int */
+#define STATUS_UINT_DIGITS 10
+
+/** @brief Place a field, assuming the console under it is blank
+ */
+void status_field_init(status_field_t *field, int row, int col, int color)
+{
+	field->row = row;
+	field->col = col;
+	field->color = color;
+	field->len = 0;
+}
+
+/** @brief Show new text, writing only the characters that changed
+ */
+int status_field_set(status_field_t *field, const char *text, int len)
+{
+	char next[STATUS_FIELD_MAX];
+	int i,start,end,written = 0;
+
+	if (len > STATUS_FIELD_MAX)
+		len = STATUS_FIELD_MAX;
+	end = len > field->len ? len : field->len;
+	for (i = 0; i < end; i++)
+		next[i] = i < len ? text[i] : STATUS_BLANK;
+
+	i = 0;
+	while (i < end)
+	{
+		if (i < field->len && next[i] == field->text[i])
+		{
+			i++;
+			continue;
+		}
+		start = i;
+		while (i < end && (i >= field->len || next[i] != field->text[i]))
+			i++;
+		draw_char_run(field->row,field->col + start,next + start,i - start,
+				field->color);
+		written += i - start;
+	}
+	for (i = 0; i < len; i++)
+		field->text[i] = next[i];
+	field->len = len;
+	return written;
+}
+
+/** @brief Append a string to a field text
+ */
+int status_append_str(char *buf, int len, const char *str)
+{
+	while (*str != '\0' && len < STATUS_FIELD_MAX)
+		buf[len++] = *str++;
+	return len;
+}
+
+/** @brief Append a number in decimal to a field text
+ */
+int status_append_uint(char *buf, int len, unsigned int value, int width)
+{
+	char digits[STATUS_UINT_DIGITS];
+	int n = 0;
+
+	do
+	{
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	while (n < width && n < STATUS_UINT_DIGITS)
+		digits[n++] = '0';
+	while (n > 0 && len < STATUS_FIELD_MAX)
+		buf[len++] = digits[--n];
+	return len;
+}
@@ -0,0 +1,75 @@
+/** @file status_line.h
+ *  @brief Status fields that only redraw the characters that changed
+ *
+ *  A field remembers the text it last put on the console. Setting new
+ *  text compares it with that copy and writes the runs that differ
+ *  straight to video memory, without touching the hardware cursor.
+ *  The text is built with the small formatters below instead of
+ *  printf().
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _STATUS_LINE_H_
+#define _STATUS_LINE_H_
+
+/** @brief Longest text of a field */
+#define STATUS_FIELD_MAX 32
+
+/** @brief Text field at a fixed console position */
+typedef struct status_field {
+	/** @brief Row of the first character */
+	int row;
+	/** @brief Column of the first character */
+	int col;
+	/** @brief Color of the text */
+	int color;
+	/** @brief Characters on the console */
+	int len;
+	/** @brief Text on the console */
+	char text[STATUS_FIELD_MAX];
+} status_field_t;
+
+/** @brief Place a field, assuming the console under it is blank
+ *
+ *  Also used after the console was cleared, so that the next
+ *  status_field_set() draws the whole text again.
+ *
+ *  @param field Field
+ *  @param row Row of the first character
+ *  @param col Column of the first character
+ *  @param color Color of the text
+ *  @return void
+ */
+void status_field_init(status_field_t *field, int row, int col, int color);
+
+/** @brief Show new text, writing only the characters that changed
+ *
+ *  @param field Field
+ *  @param text Text, need not be NUL terminated
+ *  @param len Length of the text, cut to STATUS_FIELD_MAX
+ *  @return Number of characters written to the console
+ */
+int status_field_set(status_field_t *field, const char *text, int len);
+
+/** @brief Append a string to a field text
+ *
+ *  @param buf Text of STATUS_FIELD_MAX characters
+ *  @param len Length of the text so far
+ *  @param str NUL terminated string
+ *  @return New length
+ */
+int status_append_str(char *buf, int len, const char *str);
+
+/** @brief Append a number in decimal to a field text
+ *
+ *  @param buf Text of STATUS_FIELD_MAX characters
+ *  @param len Length of the text so far
+ *  @param value Number
+ *  @param width Minimum number of digits, padded with zeros
+ *  @return New length
+ */
+int status_append_uint(char *buf, int len, unsigned int value, int width);
+
+#endif /* _STATUS_LINE_H_ */
@@ -8,9 +8,8 @@
  *
  *  1. Install handler : 
  *
- *  -- Installs the entry for timer interrupt into the table
- *  -- Installs it as a trap gate 
- *  -- Defines the assembly handler for action 
+ *  -- Registers the C handler for the timer IRQ with the 
+ *  dispatch layer (irq.c) 
  *  -- Confiures the timer's period during which Interrupts 
  *  will be rcvd
  *
@@ -18,7 +17,36 @@
  *
  *  -- Purpose of the C handler is to call the callback 
  *  function defined by kernel 
- *  -- Sends acknowledgment back to the PIC 
+ *  -- The callback and the timer functions are queued on the work 
+ *  queue; the dispatcher acknowledges the PIC and then runs them 
+ *
+ *  3. Deadline mode : 
+ *
+ *  -- PIT is loaded in one-shot mode (mode 0) for the next pending 
+ *  deadline instead of interrupting every tick 
+ *  -- One load can cover at most TIMER_MAX_CHUNK_TICKS ticks, longer 
+ *  deadlines are reached in chunks 
+ *  -- numTicks is advanced by the ticks covered by each chunk so that 
+ *  it stays a monotonic virtual clock 
+ *  -- Counts by which the interrupt was served late (the counter 
+ *  keeps decrementing past zero) are taken off the next load so that 
+ *  callbacks do not drift 
+ *
+ *  4. Local APIC backend : 
+ *
+ *  -- timer_set_backend() moves the ticks to the APIC timer (lapic.c) 
+ *  -- All bookkeeping stays in PIT counts; timer_load() converts them 
+ *  to TSC cycles and the APIC is armed with a TSC deadline 
+ *  -- The APIC timer stops at zero, so elapsed and late counts are 
+ *  taken from the TSC instead of the PIT counter 
+ *
+ *  5. Timing wheel : 
+ *
+ *  -- Timers registered with timer_add() are kept on the hierarchical 
+ *  timing wheel of timer_wheel.c, advanced to numTicks on every 
+ *  interrupt 
+ *  -- In deadline mode the next occupied level 0 slot (or the next 
+ *  cascade) becomes the deadline the PIT is armed for 
  *
  *  @author Ishant Dawer (idawer)
  *  @bug No known bugs 
@@ -34,69 +62,483 @@
  */
 static unsigned int numTicks = 0;
 
+/** @brief Callback handler definition */
+void (*callback_function_addr)(unsigned int) ;
+
+/** @brief Current mode of the timer (periodic or deadline) */
+static int timer_mode = TIMER_MODE_PERIODIC;
+
+/** @brief Ticks between callbacks in deadline mode */
+static unsigned int deadline_period = 1;
+
+/** @brief Tick at which the periodic callback runs next */
+static unsigned int period_deadline = 0;
+
+/** @brief Time spent in the top half of the timer handler */
+isr_stats_t timer_isr_stats;
+
+/** @brief Earlier deadline requested through timer_set_deadline() */
+static unsigned int requested_deadline = 0;
+
+/** @brief Whether requested_deadline is pending */
+static int deadline_requested = 0;
+
+/** @brief Ticks covered by the current one-shot load */
+static unsigned int armed_ticks = 0;
+
+/** @brief PIT counts loaded for the current one-shot */
+static unsigned int armed_counts = 0;
+
+/** @brief Counts we were late by, carried into the next load */
+static unsigned int carried_counts = 0;
+
+/** @brief Device the ticks come from (PIT or local APIC) */
+static int timer_backend = TIMER_BACKEND_PIT;
+
+/** @brief Vector the timer interrupt arrives on */
+static unsigned int timer_vector = TIMER_IDT_ENTRY;
+
+/** @brief TSC value the armed APIC one-shot expires at */
+static uint64_t lapic_deadline_tsc = 0;
+
+/** @brief TSC cycles per PIT count, shifted left by 16 */
+static uint64_t cycles_per_count = 0;
+
+/** @brief PIT counts per TSC cycle, shifted left by 32 */
+static uint64_t counts_per_cycle = 0;
+
+/** @brief Turn TSC cycles into PIT counts
+ *
+ *  @param cycles TSC cycles
+ *  @return PIT counts
+ */
+
+static unsigned int timer_cycles_to_counts(uint64_t cycles)
+{
+	/* Keep the product within 64 bits (over a second is late enough) */
+	if (cycles > 0xFFFFFFFFULL)
+		cycles = 0xFFFFFFFFULL;
+	return (unsigned int)((cycles * counts_per_cycle) >> 32);
+}
+
+/** @brief Load the timer
+ *
+ *  Counts are always PIT counts; with the local APIC they are turned 
+ *  into TSC cycles and the APIC timer is armed for them.
+ *
+ *  @param mode TIMER_SQUARE_WAVE (periodic) or TIMER_ONE_SHOT
+ *  @param counts Counts to load
+ */
+
+static void timer_load(unsigned char mode,unsigned int counts)
+{
+	uint64_t cycles;
+	if (timer_backend == TIMER_BACKEND_LAPIC)
+	{
+		cycles = ((uint64_t)counts * cycles_per_count) >> 16;
+		if (mode == TIMER_SQUARE_WAVE)
+		{
+			lapic_timer_periodic(cycles);
+		} else 
+		{
+			lapic_deadline_tsc = rdtsc() + cycles;
+			lapic_timer_one_shot(lapic_deadline_tsc);
+		}
+		return;
+	}
+	outb(TIMER_MODE_IO_PORT,mode);
+	outb(TIMER_PERIOD_IO_PORT,GET_LSB(counts));
+	outb(TIMER_PERIOD_IO_PORT,GET_MSB(counts));
+}
+
+/** @brief Read the current count of channel 0
+ *
+ *  @return Count latched from the PIT
+ */
+
+static unsigned int timer_read_count()
+{
+	unsigned int lsb,msb;
+	outb(TIMER_MODE_IO_PORT,TIMER_LATCH_COUNT);
+	lsb = inb(TIMER_PERIOD_IO_PORT);
+	msb = inb(TIMER_PERIOD_IO_PORT);
+	return (msb << 8) | lsb;
+}
+
+/** @brief Counts left before the armed one-shot expires
+ *
+ *  @return Counts left, 0 once it expired
+ */
+
+static unsigned int timer_counts_left()
+{
+	unsigned int count;
+	uint64_t now;
+	if (timer_backend == TIMER_BACKEND_LAPIC)
+	{
+		now = rdtsc();
+		if (now >= lapic_deadline_tsc)
+			return 0;
+		count = timer_cycles_to_counts(lapic_deadline_tsc - now);
+		return count < armed_counts ? count : armed_counts;
+	}
+	count = timer_read_count();
+	/* Past zero the PIT wraps around to TIMER_MAX_COUNT */
+	if (count > armed_counts)
+		return 0;
+	return count;
+}
+
+/** @brief Counts by which the expired one-shot is served late
+ *
+ *  In mode 0 the PIT keeps decrementing after reaching zero, so the 
+ *  count read now tells how late we are. The APIC timer stops at zero,
+ *  so there the TSC is compared against the deadline instead.
+ *
+ *  @return Counts late
+ */
+
+static unsigned int timer_counts_late()
+{
+	unsigned int count;
+	uint64_t now;
+	if (timer_backend == TIMER_BACKEND_LAPIC)
+	{
+		now = rdtsc();
+		if (now <= lapic_deadline_tsc)
+			return 0;
+		return timer_cycles_to_counts(now - lapic_deadline_tsc);
+	}
+	count = timer_read_count();
+	if (count == 0)
+		return 0;
+	return (TIMER_MAX_COUNT + 1) - count;
+}
+
+/** @brief Next pending deadline
+ *
+ *  @return The earlier of the periodic and the requested deadline
+ */
+
+static unsigned int timer_next_deadline()
+{
+	if (deadline_requested &&
+			(int)(requested_deadline - period_deadline) < 0)
+		return requested_deadline;
+	return period_deadline;
+}
+
+/** @brief Arm the PIT for the next pending deadline
+ *
+ *  Loads as many ticks as the counter can hold towards the next 
+ *  deadline and takes off the counts we were late by.
+ */
+
+static void timer_arm_next()
+{
+	unsigned int ticks = timer_next_deadline() - numTicks;
+	unsigned int counts;
+	if ((int)ticks <= 0)
+		ticks = 1;
+	if (ticks > TIMER_MAX_CHUNK_TICKS)
+		ticks = TIMER_MAX_CHUNK_TICKS;
+	counts = ticks * TICK_COUNTS;
+	if (carried_counts < counts)
+		counts -= carried_counts;
+	else 
+		counts = 1;
+	carried_counts = 0;
+	armed_ticks = ticks;
+	armed_counts = counts;
+	timer_load(TIMER_ONE_SHOT,counts);
+}
+
+/** @brief Account for the ticks covered by the expired one-shot
+ *
+ *  Whole ticks the interrupt is served late by go into numTicks, the 
+ *  rest is carried to the next load.
+ */
+
+static void timer_account_expired()
+{
+	unsigned int late = timer_counts_late();
+	interrupt_latency_record(timer_vector,late * PIT_COUNT_NS);
+	numTicks += armed_ticks + late / TICK_COUNTS;
+	carried_counts = late % TICK_COUNTS;
+}
+
+/** @brief Queue the functions of the expired timers
+ *
+ *  The functions run from the work queue once the PIC is acknowledged.
+ */
+
+static void timer_run_expired()
+{
+	void (*fn)(void *);
+	void *arg;
+	while (timer_wheel_pop_expired(&fn,&arg))
+		work_queue_push(fn,arg);
+}
+
+/** @brief Run the user callback from the work queue
+ *
+ *  @param arg Tick count the callback is called with
+ */
+
+static void timer_callback_work(void *arg)
+{
+	(*callback_function_addr)((unsigned int)arg);
+}
+
 /** @brief Timer installer 
  *  
  *	Functions :
  *
- *	1. Installs handler into IDT
- *	2. sets up the callback function
- *	3. Defines the assembly wrapper
+ *	1. sets up the callback function
+ *	2. Registers the C handler for IRQ_TIMER
+ *	3. Programs the PIT for one tick
  */
 
 int handler_install_timer(void (*tickback)(unsigned int))
 {
-	/*
-	 * Step1: Install the IDT table entry 
-	 */
-
-	/* Get the IDT base address */
-	void * idt_base_addr = idt_base();
-	void * assembly_wrapper = timer_wrapper_asm;
 	/*round it up  */
 	unsigned int number_cycles = (TIMER_RATE * INTERRUPT_DELAY);
-	/* Index is mentioned in the timer defines library*/
-
-	unsigned int index = TIMER_IDT_ENTRY * SIZE_2_WORDS;
-	/* Evaluating parameters of the IDT entry */
 	callback_function_addr = tickback;
 
-	/* Writing IDT entry for timer handler */
-	*(unsigned int*)(idt_base_addr + index) = LOWER_32(assembly_wrapper); 
-	*(unsigned int*)(idt_base_addr + index + SIZE_UINT) = UPPER_32(assembly_wrapper); 
+	/* Step1: Register the C handler for the timer line */
+	irq_register(IRQ_TIMER,timer_handler_wrapper,NULL);
+
 	/* Write to IO ports */
 	
-	outb(TIMER_MODE_IO_PORT,TIMER_SQUARE_WAVE);
-	outb(TIMER_PERIOD_IO_PORT,GET_LSB(number_cycles));
-	outb(TIMER_PERIOD_IO_PORT,GET_MSB(number_cycles));
+	timer_mode = TIMER_MODE_PERIODIC;
+	timer_load(TIMER_SQUARE_WAVE,number_cycles);
 	return 1;
 }
 
-/** @brief Send acknowledge to PIC
+/** @brief Switch between periodic and deadline mode
  *
- * This function writes to PIC after handling the 
- * handler 
+ *  Interrupts are held off while the PIT is reprogrammed.
  */
 
-void send_ack_pic()
+int timer_set_mode(int mode, unsigned int period)
 {
-	outb(INT_CTL_PORT,INT_ACK_CURRENT);
+	uint32_t flags;
+	if (mode != TIMER_MODE_PERIODIC && mode != TIMER_MODE_DEADLINE)
+		return -1;
+	if (mode == TIMER_MODE_DEADLINE && period == 0)
+		return -1;
+
+	flags = get_eflags();
+	disable_interrupts();
+	if (mode == TIMER_MODE_DEADLINE)
+	{
+		deadline_period = period;
+		period_deadline = numTicks + period;
+		deadline_requested = 0;
+		carried_counts = 0;
+		timer_mode = TIMER_MODE_DEADLINE;
+		timer_arm_next();
+	} else 
+	{
+		timer_mode = TIMER_MODE_PERIODIC;
+		timer_load(TIMER_SQUARE_WAVE,TICK_COUNTS);
+	}
+	set_eflags(flags);
+	return 1;
+}
+
+/** @brief Move the timer to another device
+ *
+ *  The PIT line is masked while the local APIC drives the ticks, and 
+ *  unmasked again when going back. The current mode is re-armed on 
+ *  the new device.
+ */
+
+int timer_set_backend(int backend)
+{
+	uint32_t flags;
+	uint64_t hz;
+	if (backend != TIMER_BACKEND_PIT && backend != TIMER_BACKEND_LAPIC)
+		return -1;
+	if (backend == timer_backend)
+		return 1;
+	if (backend == TIMER_BACKEND_LAPIC)
+	{
+		if (lapic_init() < 0)
+			return -1;
+		hz = clock_hz();
+		cycles_per_count = (hz << 16) / TIMER_RATE;
+		counts_per_cycle = ((uint64_t)TIMER_RATE << 32) / hz;
+	}
+
+	flags = get_eflags();
+	disable_interrupts();
+	if (backend == TIMER_BACKEND_LAPIC)
+	{
+		irq_register(IRQ_TIMER,NULL,NULL);
+		irq_register_vector(LAPIC_TIMER_VECTOR,timer_handler_wrapper,NULL);
+		timer_vector = LAPIC_TIMER_VECTOR;
+	} else 
+	{
+		lapic_timer_stop();
+		irq_register_vector(LAPIC_TIMER_VECTOR,NULL,NULL);
+		irq_register(IRQ_TIMER,timer_handler_wrapper,NULL);
+		timer_vector = TIMER_IDT_ENTRY;
+	}
+	timer_backend = backend;
+	carried_counts = 0;
+	if (timer_mode == TIMER_MODE_DEADLINE)
+		timer_arm_next();
+	else 
+		timer_load(TIMER_SQUARE_WAVE,TICK_COUNTS);
+	set_eflags(flags);
+	return 1;
+}
+
+/** @brief Bring the next deadline forward
+ *
+ *  If the new deadline falls within the chunk that is already armed, 
+ *  the PIT is left alone: the callback runs when the chunk expires.
+ */
+
+void timer_set_deadline(unsigned int when)
+{
+	uint32_t flags;
+	unsigned int count,elapsed;
+	if (timer_mode != TIMER_MODE_DEADLINE)
+		return;
+	flags = get_eflags();
+	disable_interrupts();
+	if ((int)(when - timer_next_deadline()) < 0)
+	{
+		requested_deadline = when;
+		deadline_requested = 1;
+		count = timer_counts_left();
+		/* If the chunk already expired the pending interrupt will 
+		 * pick up the new deadline when it re-arms */
+		if ((int)(when - (numTicks + armed_ticks)) < 0 && count != 0)
+		{
+			/* Account for the part of the chunk already elapsed 
+			 * and re-arm the rest for the earlier deadline */
+			elapsed = armed_counts - count;
+			numTicks += elapsed / TICK_COUNTS;
+			carried_counts = elapsed % TICK_COUNTS;
+			timer_arm_next();
+		}
+	}
+	set_eflags(flags);
+}
+
+/** @brief Register a timer on the wheel
+ *
+ *  Interrupts are held off while the wheel changes, so that timers can
+ *  be added from the timer callbacks as well.
+ */
+
+int timer_add(unsigned int delay, unsigned int period,
+		void (*fn)(void *), void *arg)
+{
+	uint32_t flags;
+	unsigned int expires;
+	int id;
+
+	if (fn == NULL)
+		return -1;
+	if (delay == 0)
+		delay = 1;
+
+	flags = get_eflags();
+	disable_interrupts();
+	expires = timer_get_ticks() + delay;
+	id = timer_wheel_add(expires,period,fn,arg);
+	if (id >= 0)
+		timer_set_deadline(expires);
+	set_eflags(flags);
+	return id;
+}
+
+/** @brief Cancel a registered timer
+ *
+ *  Interrupts are held off while the wheel changes.
+ */
+
+int timer_cancel(int id)
+{
+	uint32_t flags;
+	int status;
+
+	flags = get_eflags();
+	disable_interrupts();
+	status = timer_wheel_cancel(id);
+	set_eflags(flags);
+	return status;
+}
+
+/** @brief Virtual monotonic clock
+ *
+ *  In deadline mode the ticks elapsed within the armed chunk are 
+ *  read back from the PIT counter (or the TSC with the local APIC).
+ */
+
+unsigned int timer_get_ticks(void)
+{
+	uint32_t flags;
+	unsigned int ticks,count;
+	if (timer_mode != TIMER_MODE_DEADLINE)
+		return numTicks;
+	flags = get_eflags();
+	disable_interrupts();
+	ticks = numTicks;
+	count = timer_counts_left();
+	if (count != 0)
+		ticks += (armed_counts - count) / TICK_COUNTS;
+	else 
+		ticks += armed_ticks;
+	set_eflags(flags);
+	return ticks;
 }
 
-/* Handler function wrapper for assembly */
 /** @brief C timer handler wrapper 
  *  
  *  Functions:
  *  1. Incrment the counter to track the number of 
  *  events 
- *  2. Calls the callback function defined by user
- *  3. Sends acknowledgement back to PIC
+ *  2. Queues the callback function defined by user
+ *
+ *  In deadline mode the callback is only queued once the pending 
+ *  deadline is reached and the PIT is re-armed for the next one.
+ *  The dispatcher acknowledges the PIC and runs the queued work.
  */
-void timer_handler_wrapper()
+void timer_handler_wrapper(void *arg)
 {
-	numTicks++;
-	(*callback_function_addr)(numTicks);
-	/* sending acknowledgement */
-	send_ack_pic();
+	unsigned int wheel_deadline;
+	uint64_t start = rdtsc();
+	if (timer_mode == TIMER_MODE_DEADLINE)
+	{
+		timer_account_expired();
+		timer_wheel_advance(numTicks);
+		timer_run_expired();
+		if ((int)(numTicks - timer_next_deadline()) >= 0)
+		{
+			/* Keep the phase of the period, skip missed deadlines */
+			while ((int)(numTicks - period_deadline) >= 0)
+				period_deadline += deadline_period;
+			deadline_requested = 0;
+			work_queue_push(timer_callback_work,(void *)numTicks);
+		}
+		if (timer_wheel_next_expiry(&wheel_deadline) &&
+				(int)(wheel_deadline - timer_next_deadline()) < 0)
+		{
+			requested_deadline = wheel_deadline;
+			deadline_requested = 1;
+		}
+		timer_arm_next();
+	} else 
+	{
+		numTicks++;
+		timer_wheel_advance(numTicks);
+		timer_run_expired();
+		work_queue_push(timer_callback_work,(void *)numTicks);
+	}
+	isr_stats_record(&timer_isr_stats,start);
 }
-
-
@@ -17,33 +17,40 @@
 #include <timer_defines.h>
 #include <interrupt_defines.h>
 #include <seg.h>
+#include <eflags.h>
+#include "work_queue.h"
+#include "interrupt_handlers.h"
+#include "irq.h"
+#include "lapic.h"
+#include "clock.h"
+#include "timer_wheel.h"
 
-/** @brief Get the size of 2 words */
-
-#define SIZE_2_WORDS ((2)*(sizeof(void *)))
-
-/** @brief Get offset for first 16 bits */
+/** @brief Number of timer cycles between interrupts */
+#define INTERRUPT_DELAY 10/1000
 
-#define OFFSET_FIRST(x) (((unsigned int)(x)) & (0xFFFF))                    
-#define OFFSET_SECOND(x) (((unsigned int)(x)) & (0xFFFF0000)) 
+/** @brief PIT counts in one timer tick */
+#define TICK_COUNTS (TIMER_RATE * INTERRUPT_DELAY)
 
+/** @brief Timer interrupts every tick (square wave) */
+#define TIMER_MODE_PERIODIC 0
 
-/** @brief Higher 32 bits with D=1*/
-#define TRAP_GATE_REM_BITS 0x8F00
+/** @brief Timer is reprogrammed (one shot) for the next deadline */
+#define TIMER_MODE_DEADLINE 1
 
-/** @brief Higher 32 bits of Trap gate */
+/** @brief Ticks come from PIT channel 0 on IRQ 0 */
+#define TIMER_BACKEND_PIT 0
 
-#define UPPER_32(x) (TRAP_GATE_REM_BITS | OFFSET_SECOND(x))
+/** @brief Ticks come from the local APIC timer */
+#define TIMER_BACKEND_LAPIC 1
 
-/** @brief Lower 32 bits of Trap gate */
+/** @brief Command to latch the count of channel 0 */
+#define TIMER_LATCH_COUNT 0x00
 
-#define LOWER_32(x) (((SEGSEL_KERNEL_CS) << 16) | OFFSET_FIRST(x))
+/** @brief Largest count the 16-bit PIT counter can be loaded with */
+#define TIMER_MAX_COUNT 0xFFFF
 
-/** @brief Size of unsigned int */
-#define SIZE_UINT sizeof(unsigned int)
-
-/** @brief Number of timer cycles between interrupts */
-#define INTERRUPT_DELAY 10/1000
+/** @brief Most ticks a single one-shot load can cover */
+#define TIMER_MAX_CHUNK_TICKS ((TIMER_MAX_COUNT) / (TICK_COUNTS))
 
 /** @brief Get LSB
  *
@@ -71,16 +78,12 @@
 
 /* Callback function for timer handler */
 /** @brief Callback handler declaration */
-void (*callback_function_addr)(unsigned int) ;
+extern void (*callback_function_addr)(unsigned int) ;
+
+/** @brief Time spent in the top half of the timer handler */
+extern isr_stats_t timer_isr_stats;
 
 
-/** @brief Assembly handler 
- *	
- *	This is an assembly wrapper to perform 
- *	saving general purpose registers and retrieving
- *	them after C handler is done
- */
-void timer_wrapper_asm();
 
 /** @brief Handler for timer interrupt 
  *
@@ -94,18 +97,93 @@ void timer_wrapper_asm();
 
 int handler_install_timer(void (*tickback)(unsigned int));
 
-/** @brief Wrapper for C handler 
+/** @brief Switch the timer between periodic and deadline mode
  *
- * @param none
+ *  In deadline mode the PIT is programmed in one-shot mode (mode 0)
+ *  for the next pending deadline instead of interrupting every tick.
+ *  The callback is then invoked once every period ticks, and
+ *  numTicks keeps counting the ticks that have elapsed.
  *
- * @return void
+ *  @param mode TIMER_MODE_PERIODIC or TIMER_MODE_DEADLINE
+ *  @param period Ticks between callbacks in deadline mode
+ *
+ *  @return 1 on success, -1 on invalid arguments
  */
 
-void timer_handler_wrapper();
+int timer_set_mode(int mode, unsigned int period);
 
+/** @brief Choose the device the ticks come from
+ *
+ *  handler_install() starts on the PIT. TIMER_BACKEND_LAPIC moves the 
+ *  ticks to the local APIC timer (TSC-deadline mode when available, 
+ *  one-shot otherwise) with a memory mapped EOI; it fails if the CPU 
+ *  has no local APIC, and the PIT stays in use.
+ *
+ *  @param backend TIMER_BACKEND_PIT or TIMER_BACKEND_LAPIC
+ *
+ *  @return 1 on success, -1 if the backend is not available
+ */
+
+int timer_set_backend(int backend);
 
-/** @brief Send ack signal to interrupt
+/** @brief Request the callback at an earlier tick
+ *
+ *  Only has effect in deadline mode. The callback runs at the 
+ *  earliest of the requested tick and the next periodic deadline.
  *
+ *  @param when Absolute tick at which the callback should run
+ *
+ *  @return void
  */
 
-void send_ack_pic();
+void timer_set_deadline(unsigned int when);
+
+/** @brief Current tick count 
+ *
+ *  Monotonic virtual clock. In deadline mode this includes the 
+ *  ticks elapsed since the last interrupt, read from the PIT.
+ *
+ *  @return Number of ticks since the timer was installed
+ */
+
+unsigned int timer_get_ticks(void);
+
+/** @brief Register a timer on the timing wheel
+ *
+ *  fn is invoked with arg from the timer interrupt after delay ticks,
+ *  and then every period ticks if period is not 0. Insertion is O(1).
+ *
+ *  @param delay Ticks until the first run (at least 1)
+ *  @param period Ticks between runs, 0 for a one shot timer
+ *  @param fn Function to call
+ *  @param arg Argument passed to fn
+ *
+ *  @return Timer id on success, -1 if no timer is free
+ */
+
+int timer_add(unsigned int delay, unsigned int period,
+		void (*fn)(void *), void *arg);
+
+/** @brief Cancel a registered timer
+ *
+ *  O(1): the timer is unlinked from its slot.
+ *
+ *  @param id Timer id returned by timer_add()
+ *
+ *  @return 1 on success, -1 if the timer is not registered
+ */
+
+int timer_cancel(int id);
+
+/** @brief C handler of the timer IRQ
+ *
+ * Registered with irq_register(); the dispatcher acknowledges 
+ * the PIC after it returns.
+ *
+ * @param arg Unused
+ *
+ * @return void
+ */
+
+void timer_handler_wrapper(void *arg);
+
@@ -0,0 +1,326 @@
+/** @file timer_wheel.c
+ *
+ *  @brief Hierarchical timing wheel of the timer driver
+ *
+ *  What it contains :
+ *
+ *  -- Timers registered with timer_wheel_add() are kept on a 
+ *  hierarchical timing wheel of WHEEL_LEVELS levels with WHEEL_SLOTS 
+ *  slots each 
+ *  -- Level 0 holds timers expiring within WHEEL_SLOTS ticks, level n 
+ *  the ones within WHEEL_SLOTS^(n+1) ticks 
+ *  -- Every tick looks at one level 0 slot; when level 0 wraps, the 
+ *  current slot of the next level is cascaded down 
+ *  -- Insert and cancel are O(1) list operations, a tick where 
+ *  nothing expires only tests one bit 
+ *  -- Timers come from a static pool, and an id carries the generation
+ *  of its timer so that a stale one is rejected 
+ *
+ *  Nothing here touches the hardware: timer_driver.c drives the wheel
+ *  from the timer interrupt and holds interrupts off around the calls
+ *  made outside it.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs 
+ */
+
+#include <stddef.h>
+#include "timer_wheel.h"
+
+/** @brief Slots of the timing wheel, one list per slot */
+static timer_entry_t *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/** @brief Occupied slots of each level, one bit per slot */
+static uint32_t wheel_occupied[WHEEL_LEVELS][WHEEL_SLOTS / 32];
+
+/** @brief Timers that expired and wait to be run */
+static timer_entry_t *expired_timers = NULL;
+
+/** @brief Free timers of the pool */
+static timer_entry_t *free_timers = NULL;
+
+/** @brief Pool the timers are allocated from */
+static timer_entry_t timer_pool[MAX_TIMERS];
+
+/** @brief Whether the pool was put on the free list */
+static int timer_pool_ready = 0;
+
+/** @brief Last tick processed by the wheel */
+static unsigned int wheel_clock = 0;
+
+/** @brief Number of timers queued on the wheel */
+static unsigned int wheel_count = 0;
+
+/** @brief Push a timer on a list
+ *
+ *  @param list Head of the list
+ *  @param t Timer
+ */
+
+static void timer_list_add(timer_entry_t **list,timer_entry_t *t)
+{
+	t->prev = NULL;
+	t->next = *list;
+	if (*list != NULL)
+		(*list)->prev = t;
+	*list = t;
+	t->list = list;
+}
+
+/** @brief Unlink a timer from the list it is queued on
+ *
+ *  Clears the occupied bit if a wheel slot becomes empty.
+ *
+ *  @param t Timer
+ */
+
+static void timer_list_remove(timer_entry_t *t)
+{
+	timer_entry_t **list = t->list;
+	int index;
+	if (t->prev != NULL)
+		t->prev->next = t->next;
+	else 
+		*list = t->next;
+	if (t->next != NULL)
+		t->next->prev = t->prev;
+	t->next = t->prev = NULL;
+	t->list = NULL;
+
+	if (list >= &wheel[0][0] && list < &wheel[0][0] + 
+			WHEEL_LEVELS * WHEEL_SLOTS)
+	{
+		wheel_count--;
+		if (*list == NULL)
+		{
+			index = list - &wheel[0][0];
+			wheel_occupied[index / WHEEL_SLOTS][(index % WHEEL_SLOTS) / 32]
+				&= ~(1u << (index % 32));
+		}
+	}
+}
+
+/** @brief Queue a timer on the slot it expires in
+ *
+ *  The level is picked from how far away the timer expires, the slot
+ *  from the bits of the expiry tick resolved by that level.
+ *
+ *  @param t Timer
+ */
+
+static void wheel_insert(timer_entry_t *t)
+{
+	unsigned int delta = t->expires - wheel_clock;
+	unsigned int slot;
+	int level = 0;
+
+	if ((int)delta <= 0)
+	{
+		timer_list_add(&expired_timers,t);
+		return;
+	}
+	/* Anything beyond the top level waits in its last slot */
+	if (delta >= (1u << (WHEEL_BITS * WHEEL_LEVELS)))
+	{
+		delta = (1u << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+		t->expires = wheel_clock + delta;
+	}
+	while (level < WHEEL_LEVELS - 1 && 
+			delta >= (1u << (WHEEL_BITS * (level + 1))))
+		level++;
+
+	slot = (t->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	timer_list_add(&wheel[level][slot],t);
+	wheel_occupied[level][slot / 32] |= 1u << (slot % 32);
+	wheel_count++;
+}
+
+/** @brief Re-queue the timers of a slot on the lower levels
+ *
+ *  @param level Level of the slot
+ *  @param slot Slot
+ */
+
+static void wheel_cascade(int level,unsigned int slot)
+{
+	timer_entry_t *t;
+	while ((t = wheel[level][slot]) != NULL)
+	{
+		timer_list_remove(t);
+		wheel_insert(t);
+	}
+}
+
+/** @brief Move the wheel up to the given tick
+ *
+ *  Timers of every level 0 slot passed are moved to the expired list.
+ *
+ *  @param now Tick to advance to
+ */
+
+void timer_wheel_advance(unsigned int now)
+{
+	unsigned int slot,index;
+	timer_entry_t *t;
+	int level;
+
+	while ((int)(now - wheel_clock) > 0)
+	{
+		if (wheel_count == 0)
+		{
+			/* Nothing queued, nothing to cascade */
+			wheel_clock = now;
+			break;
+		}
+		wheel_clock++;
+		slot = wheel_clock & WHEEL_MASK;
+		if (slot == 0)
+		{
+			for (level = 1; level < WHEEL_LEVELS; level++)
+			{
+				index = (wheel_clock >> (WHEEL_BITS * level)) & WHEEL_MASK;
+				wheel_cascade(level,index);
+				if (index != 0)
+					break;
+			}
+		}
+		if (wheel_occupied[0][slot / 32] & (1u << (slot % 32)))
+		{
+			while ((t = wheel[0][slot]) != NULL)
+			{
+				timer_list_remove(t);
+				timer_list_add(&expired_timers,t);
+			}
+		}
+	}
+}
+
+/** @brief Register a timer on the wheel
+ */
+
+int timer_wheel_add(unsigned int expires, unsigned int period,
+		void (*fn)(void *), void *arg)
+{
+	timer_entry_t *t;
+	int i;
+
+	if (!timer_pool_ready)
+	{
+		for (i = MAX_TIMERS - 1; i >= 0; i--)
+			timer_list_add(&free_timers,&timer_pool[i]);
+		timer_pool_ready = 1;
+	}
+	if ((t = free_timers) == NULL)
+		return -1;
+	timer_list_remove(t);
+	t->generation = (t->generation + 1) & 
+		(~0u >> (TIMER_ID_BITS + 1));
+	t->in_use = 1;
+	t->fn = fn;
+	t->arg = arg;
+	t->period = period;
+	t->expires = expires;
+	wheel_insert(t);
+	return (t->generation << TIMER_ID_BITS) | (t - timer_pool);
+}
+
+/** @brief Cancel a registered timer
+ *
+ *  The generation in the id guards against cancelling a timer which 
+ *  was released and handed out again.
+ */
+
+int timer_wheel_cancel(int id)
+{
+	timer_entry_t *t;
+	int index = id & ((1 << TIMER_ID_BITS) - 1);
+
+	if (id < 0 || index >= MAX_TIMERS)
+		return -1;
+	t = &timer_pool[index];
+	if (!t->in_use || t->generation != ((unsigned int)id >> TIMER_ID_BITS))
+		return -1;
+	if (t->list != NULL)
+		timer_list_remove(t);
+	t->in_use = 0;
+	timer_list_add(&free_timers,t);
+	return 1;
+}
+
+/** @brief Take the next expired timer
+ *
+ *  Periodic timers are queued again on the wheel first, so that the 
+ *  function may cancel them. One shot timers are released.
+ */
+
+int timer_wheel_pop_expired(void (**fn)(void *), void **arg)
+{
+	timer_entry_t *t = expired_timers;
+	if (t == NULL)
+		return 0;
+	timer_list_remove(t);
+	if (t->period != 0)
+	{
+		/* Keep the phase, skip the runs we are too late for */
+		do 
+		{
+			t->expires += t->period;
+		} while ((int)(t->expires - wheel_clock) <= 0);
+		wheel_insert(t);
+	} else 
+	{
+		t->in_use = 0;
+		timer_list_add(&free_timers,t);
+	}
+	*fn = t->fn;
+	*arg = t->arg;
+	return 1;
+}
+
+/** @brief Find the first occupied level 0 slot at or after a slot
+ *
+ *  @param slot Slot to start from
+ *
+ *  @return Occupied slot, or -1 if none up to the end of the level
+ */
+
+static int wheel_find_slot(unsigned int slot)
+{
+	uint32_t bits;
+	while (slot < WHEEL_SLOTS)
+	{
+		bits = wheel_occupied[0][slot / 32] & (~0u << (slot % 32));
+		if (bits != 0)
+			return (slot & ~31u) + __builtin_ctz(bits);
+		slot = (slot & ~31u) + 32;
+	}
+	return -1;
+}
+
+/** @brief Next tick at which the wheel has work
+ *
+ *  Either the next occupied level 0 slot of this lap, or the next
+ *  cascade which may bring timers down to level 0.
+ *
+ *  @param when Where to store the tick
+ *
+ *  @return 1 if a timer is queued, 0 otherwise
+ */
+
+int timer_wheel_next_expiry(unsigned int *when)
+{
+	int slot;
+	if (expired_timers != NULL)
+	{
+		*when = wheel_clock + 1;
+		return 1;
+	}
+	if (wheel_count == 0)
+		return 0;
+	slot = wheel_find_slot((wheel_clock & WHEEL_MASK) + 1);
+	if (slot >= 0)
+		*when = (wheel_clock & ~WHEEL_MASK) + slot;
+	else 
+		*when = (wheel_clock | WHEEL_MASK) + 1;
+	return 1;
+}
@@ -0,0 +1,116 @@
+/** @file timer_wheel.h
+ *  @brief Hierarchical timing wheel of the timer driver
+ *
+ *  Timers are kept on WHEEL_LEVELS levels of WHEEL_SLOTS slots. A timer
+ *  goes on the level that resolves how far away it expires, and is 
+ *  cascaded down a level each time the level below wraps, until it 
+ *  reaches level 0 and expires. The wheel only counts ticks; it is not
+ *  locked, and timer_driver.c calls it with interrupts held off.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+/** @brief Bits of the tick count resolved by one wheel level */
+#define WHEEL_BITS 6
+
+/** @brief Slots in one level of the timing wheel */
+#define WHEEL_SLOTS (1 << (WHEEL_BITS))
+
+/** @brief Mask to get the slot out of a tick count */
+#define WHEEL_MASK ((WHEEL_SLOTS) - 1)
+
+/** @brief Levels of the timing wheel (covers 2^24 ticks) */
+#define WHEEL_LEVELS 4
+
+/** @brief Most timers that can be registered at once */
+#define MAX_TIMERS 16
+
+/** @brief Bits of a timer id which hold the pool index */
+#define TIMER_ID_BITS 8
+
+/** @brief Timer registered on the timing wheel
+ *
+ *  Timers of the same slot are kept on a doubly linked list, so
+ *  that they can be cancelled without walking the slot.
+ */
+typedef struct timer_entry
+{
+	struct timer_entry *next;
+	struct timer_entry *prev;
+	/* List the timer is queued on, NULL if not queued */
+	struct timer_entry **list;
+	/* Tick at which the timer expires */
+	unsigned int expires;
+	/* Ticks between runs, 0 for a one shot timer */
+	unsigned int period;
+	void (*fn)(void *);
+	void *arg;
+	/* Bumped on every reuse so stale ids are rejected */
+	unsigned int generation;
+	int in_use;
+} timer_entry_t;
+
+/** @brief Register a timer on the wheel
+ *
+ *  O(1). A timer already due goes straight to the expired list.
+ *
+ *  @param expires Tick of the first run
+ *  @param period Ticks between runs, 0 for a one shot timer
+ *  @param fn Function to call
+ *  @param arg Argument passed to fn
+ *
+ *  @return Timer id, -1 if no timer is free
+ */
+
+int timer_wheel_add(unsigned int expires, unsigned int period,
+		void (*fn)(void *), void *arg);
+
+/** @brief Cancel a registered timer
+ *
+ *  O(1): the timer is unlinked from its slot.
+ *
+ *  @param id Timer id returned by timer_wheel_add()
+ *
+ *  @return 1 on success, -1 if the timer is not registered
+ */
+
+int timer_wheel_cancel(int id);
+
+/** @brief Move the wheel up to the given tick
+ *
+ *  Timers of every level 0 slot passed go to the expired list, where
+ *  timer_wheel_pop_expired() takes them from.
+ *
+ *  @param now Tick to advance to
+ *
+ *  @return void
+ */
+
+void timer_wheel_advance(unsigned int now);
+
+/** @brief Take the next expired timer
+ *
+ *  @param fn Where to store its function
+ *  @param arg Where to store its argument
+ *
+ *  @return 1 if a timer was taken, 0 if none expired
+ */
+
+int timer_wheel_pop_expired(void (**fn)(void *), void **arg);
+
+/** @brief Next tick at which the wheel has work
+ *
+ *  @param when Where to store the tick
+ *
+ *  @return 1 if a timer is queued, 0 otherwise
+ */
+
+int timer_wheel_next_expiry(unsigned int *when);
+
+#endif /* _TIMER_WHEEL_H_ */
@@ -0,0 +1,167 @@
+/** @file work_queue.c
+ *
+ *  @brief Implementation of the deferred work queue
+ *
+ *  What it contains :
+ *
+ *  1. Ring of work items :
+ *
+ *  -- Bounded ring where every slot carries the position it is ready
+ *  for. A producer claims a position with a compare and swap on the
+ *  enqueue position, fills the slot and then publishes it by bumping
+ *  the sequence of the slot
+ *  -- A handler interrupting another one halfway through a push claims
+ *  the next position and never waits for the one it interrupted
+ *
+ *  2. Running the items :
+ *
+ *  -- Only one context runs the items at a time, guarded by a flag.
+ *  A nested handler finds the flag set and returns, its items are run
+ *  by the handler it interrupted
+ *  -- The consumer stops at a slot which was claimed but not yet
+ *  published; the next handler to exit picks it up
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stddef.h>
+#include <asm.h>
+#include "work_queue.h"
+
+/** @brief Ring of work items */
+static work_item_t work_ring[WORK_QUEUE_SIZE];
+
+/** @brief Next position to be claimed by a producer */
+static volatile unsigned int enqueue_pos = 0;
+
+/** @brief Next position to be run */
+static volatile unsigned int dequeue_pos = 0;
+
+/** @brief Set while some context runs the items */
+static volatile int work_running = 0;
+
+/** @brief Statistics of the queue */
+static work_queue_stats_t work_stats;
+
+/** @brief Initialize the work queue
+ */
+void work_queue_init(void)
+{
+	unsigned int i;
+	for (i = 0; i < WORK_QUEUE_SIZE; i++)
+	{
+		work_ring[i].seq = i;
+		work_ring[i].fn = NULL;
+		work_ring[i].arg = NULL;
+	}
+	enqueue_pos = 0;
+	dequeue_pos = 0;
+	work_running = 0;
+}
+
+/** @brief Queue a work item
+ */
+int work_queue_push(void (*fn)(void *), void *arg)
+{
+	work_item_t *item;
+	unsigned int pos,depth;
+	int diff;
+
+	pos = enqueue_pos;
+	while (1)
+	{
+		item = &work_ring[pos & WORK_QUEUE_MASK];
+		diff = (int)(item->seq - pos);
+		if (diff == 0)
+		{
+			if (__sync_bool_compare_and_swap(&enqueue_pos,pos,pos + 1))
+				break;
+			pos = enqueue_pos;
+		} else if (diff < 0)
+		{
+			/* Slot still holds an item a lap behind: full */
+			__sync_fetch_and_add(&work_stats.dropped,1);
+			return -1;
+		} else
+		{
+			pos = enqueue_pos;
+		}
+	}
+	item->fn = fn;
+	item->arg = arg;
+	__sync_synchronize();
+	item->seq = pos + 1;
+
+	__sync_fetch_and_add(&work_stats.queued,1);
+	depth = pos + 1 - dequeue_pos;
+	if (depth > work_stats.depth_max)
+		work_stats.depth_max = depth;
+	return 1;
+}
+
+/** @brief Take the next published item off the ring
+ *
+ *  @param fn Where to store the function
+ *  @param arg Where to store the argument
+ *
+ *  @return 1 if an item was taken, 0 otherwise
+ */
+static int work_queue_pop(void (**fn)(void *), void **arg)
+{
+	unsigned int pos = dequeue_pos;
+	work_item_t *item = &work_ring[pos & WORK_QUEUE_MASK];
+
+	if ((int)(item->seq - (pos + 1)) < 0)
+		return 0;
+	*fn = item->fn;
+	*arg = item->arg;
+	__sync_synchronize();
+	item->seq = pos + WORK_QUEUE_SIZE;
+	dequeue_pos = pos + 1;
+	return 1;
+}
+
+/** @brief Run the queued work items
+ */
+void work_queue_run(void)
+{
+	void (*fn)(void *);
+	void *arg;
+
+	if (__sync_lock_test_and_set(&work_running,1))
+		return;
+	while (1)
+	{
+		while (work_queue_pop(&fn,&arg))
+		{
+			(*fn)(arg);
+			work_stats.run++;
+		}
+		__sync_lock_release(&work_running);
+		/* An item published after the last pop but before the flag
+		 * was released has nobody else to run it */
+		if (work_ring[dequeue_pos & WORK_QUEUE_MASK].seq != dequeue_pos + 1)
+			break;
+		if (__sync_lock_test_and_set(&work_running,1))
+			break;
+	}
+}
+
+/** @brief Copy the statistics of the queue
+ */
+void work_queue_get_stats(work_queue_stats_t *stats)
+{
+	*stats = work_stats;
+}
+
+/** @brief Account one interrupt in the top half statistics
+ */
+void isr_stats_record(isr_stats_t *stats, uint64_t start)
+{
+	uint64_t cycles = rdtsc() - start;
+	stats->count++;
+	stats->cycles_total += cycles;
+	if (cycles > stats->cycles_max)
+		stats->cycles_max = cycles;
+}
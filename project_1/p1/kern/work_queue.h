@@ -0,0 +1,100 @@
+/** @file work_queue.h
+ *  @brief Deferred work queue for the interrupt handlers
+ *
+ *  Interrupt handlers only do the work that has to happen with the
+ *  device (read the port, acknowledge the PIC) and push the rest as
+ *  work items. The items run at the end of the outermost handler,
+ *  after the PIC was acknowledged and with interrupts enabled.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _WORK_QUEUE_H_
+#define _WORK_QUEUE_H_
+
+#include <stdint.h>
+
+/** @brief Number of work items the queue can hold (power of 2) */
+#define WORK_QUEUE_SIZE 32
+
+/** @brief Mask to get the ring index of a position */
+#define WORK_QUEUE_MASK (WORK_QUEUE_SIZE - 1)
+
+/** @brief Work item of the queue */
+typedef struct work_item {
+	/** @brief Position the slot is ready for */
+	volatile unsigned int seq;
+	/** @brief Function to run */
+	void (*fn)(void *);
+	/** @brief Argument to the function */
+	void *arg;
+} work_item_t;
+
+/** @brief Statistics of the queue */
+typedef struct work_queue_stats {
+	/** @brief Items queued */
+	unsigned int queued;
+	/** @brief Items run */
+	unsigned int run;
+	/** @brief Items dropped because the queue was full */
+	unsigned int dropped;
+	/** @brief Deepest the queue has been */
+	unsigned int depth_max;
+} work_queue_stats_t;
+
+/** @brief Time spent in the top half of an interrupt handler */
+typedef struct isr_stats {
+	/** @brief Interrupts served */
+	unsigned int count;
+	/** @brief Cycles spent in all of them */
+	uint64_t cycles_total;
+	/** @brief Cycles spent in the longest one */
+	uint64_t cycles_max;
+} isr_stats_t;
+
+/** @brief Initialize the work queue
+ *
+ *  Has to run before the interrupt handlers are installed.
+ *
+ *  @return void
+ */
+void work_queue_init(void);
+
+/** @brief Queue a work item
+ *
+ *  Safe to call from any interrupt handler, also when it interrupted
+ *  another one in the middle of queueing.
+ *
+ *  @param fn Function to run
+ *  @param arg Argument to the function
+ *
+ *  @return 1 on success, -1 if the queue is full
+ */
+int work_queue_push(void (*fn)(void *), void *arg);
+
+/** @brief Run the queued work items
+ *
+ *  Only the outermost caller runs the items; a nested handler returns
+ *  at once and leaves its items to the one it interrupted.
+ *
+ *  @return void
+ */
+void work_queue_run(void);
+
+/** @brief Copy the statistics of the queue
+ *
+ *  @param stats Where to copy them
+ *  @return void
+ */
+void work_queue_get_stats(work_queue_stats_t *stats);
+
+/** @brief Account one interrupt in the top half statistics
+ *
+ *  @param stats Statistics of the handler
+ *  @param start Time stamp read when the handler was entered
+ *  @return void
+ */
+void isr_stats_record(isr_stats_t *stats, uint64_t start);
+
+#endif /* _WORK_QUEUE_H_ */
@@ -0,0 +1,656 @@
+/** @file alloc_harness.c
+ *
+ *  @brief Host harness of the 410kern lmm and malloc: fuzz, replay, bench
+ *
+ *  Every lmm and malloc source is built for the host, native or with
+ *  -m32, on one lmm variant, and given a static heap as mb_util_lmm()
+ *  gives malloc_lmm the free memory in the kernel. The asserts of the
+ *  libraries are the host's, so a broken invariant stops the run.
+ *
+ *  An allocation trace is a list of ops on numbered slots, one per line:
+ *
+ *  -- m slot size: malloc
+ *  -- c slot size: calloc
+ *  -- a slot align size: memalign
+ *  -- s slot size: smalloc
+ *  -- r slot size: realloc
+ *  -- f slot: free, or sfree for a smalloc chunk
+ *
+ *  Lines starting with '#' are comments. A slot is allocated before it
+ *  is freed or realloced and is free again before it is reused.
+ *
+ *  Modes:
+ *
+ *  -- fuzz [ops] [seed]: random ops of every kind. Each chunk is filled
+ *  with a pattern of its slot, which has to be intact when the chunk is
+ *  freed or realloced (the part kept), calloc chunks have to come back
+ *  zeroed and memalign ones aligned, and every 4096 ops no free block of
+ *  lmm and no two live chunks may overlap.
+ *  -- record [ops] [slots] [seed]: write a random mixed trace to stdout
+ *  -- replay file: check a trace as fuzz does, then time it
+ *  -- bench [ops] [slots]: time built-in traces
+ *
+ *  The modes of alloc_harness.h, one per file, look at one part of the
+ *  allocator each and set up their own heap: malloc, buddy, magazine,
+ *  arena and zero, stats in alloc_harness_stats (MALLOC_STATS) and
+ *  debug in alloc_harness_debug (MALLOC_DEBUG).
+ *
+ *  Timed runs report ns/op, and at the sample with the most live bytes,
+ *  the pages lmm had handed out against the bytes live, and how much of
+ *  the free space lay outside the largest free block (fragmentation).
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Free blocks of the buddy allocator are not in the overlap check
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (128 << 20)
+/** @brief Most slots of a trace */
+#define MAX_SLOTS (1 << 16)
+/** @brief Ops between two overlap checks and two samples */
+#define CHECK_EVERY 4096
+
+/** @brief Operation of a trace */
+typedef struct op {
+	/** @brief m, c, a, s, r or f */
+	char kind;
+	/** @brief Slot it works on */
+	int slot;
+	/** @brief Bytes, 0 for f */
+	int size;
+	/** @brief Alignment of a */
+	int align;
+} op_t;
+
+/** @brief Live chunk of a slot */
+typedef struct slot {
+	/** @brief The chunk, NULL if the slot is free */
+	unsigned char *p;
+	/** @brief Bytes */
+	int size;
+	/** @brief Whether it came from smalloc() */
+	int s;
+} slot_t;
+
+/** @brief Range of the heap, for the overlap check */
+typedef struct range {
+	vm_offset_t start;
+	vm_offset_t end;
+	/** @brief Slot of a live chunk, -1 for a free block */
+	int slot;
+} range_t;
+
+/** @brief Built-in size mix */
+typedef struct mix {
+	/** @brief Name printed */
+	const char *name;
+	/** @brief Percent of chunks up to 128 bytes and of 129 to 2040 */
+	int tiny;
+	int small;
+	/** @brief Percent of reallocs and memaligns among the allocations */
+	int realloc;
+	int memalign;
+} mix_t;
+
+/** @brief The rest of the chunks are 2 KB to 32 KB */
+static const mix_t mixes[] = {
+	{"small",60,40,0,0},
+	{"mixed",70,25,10,5},
+	{"large",20,30,10,0},
+};
+
+/** @brief Mode kept in a file of its own */
+typedef struct harness_mode {
+	const char *name;
+	int (*run)(int argc, char **argv);
+	/** @brief Its arguments, for the usage */
+	const char *args;
+} harness_mode_t;
+
+static const harness_mode_t modes[] = {
+	{"malloc",malloc_mode,"[ops per trace] [slots]"},
+	{"buddy",buddy_mode,"[ops] [slots]"},
+	{"magazine",magazine_mode,"[ops per thread] [percent handed over]"},
+	{"arena",arena_mode,"[phases] [most chunks per phase]"},
+	{"zero",zero_mode,"[rounds]"},
+#ifdef MALLOC_STATS
+	{"stats",stats_mode,"[ops] [slots]"},
+#endif
+#ifdef MALLOC_DEBUG
+	{"debug",debug_mode,"[ops] [slots]"},
+#endif
+};
+
+/** @brief The heap of fuzz, replay and bench */
+static unsigned char *heap;
+/** @brief Slots */
+static slot_t slots[MAX_SLOTS];
+/** @brief Bytes live */
+static long live;
+/** @brief Free bytes of the heap before anything was allocated */
+static vm_size_t heap_avail;
+/** @brief Ranges of the overlap check: the live chunks, and the free
+ *  blocks between the blocks lmm handed out */
+#define MAX_RANGES (3 * MAX_SLOTS)
+static range_t ranges[MAX_RANGES];
+
+/** @brief Result of a timed run */
+typedef struct result {
+	/** @brief Nanoseconds per op */
+	double ns;
+	/** @brief At the sample with the most live bytes: */
+	long live;
+	/** @brief Bytes lmm had handed out, to the magazines and slabs too */
+	long used;
+	/** @brief Percent of the free space outside the largest block */
+	int frag;
+} result_t;
+
+jmp_buf *panic_catch;
+char panic_msg[256];
+
+/** @brief panic() of the libraries, which the debug heap calls */
+void panic(const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap,format);
+	vsnprintf(panic_msg,sizeof(panic_msg),format,ap);
+	va_end(ap);
+	if (panic_catch)
+		longjmp(*panic_catch,1);
+	printf("%s\n",panic_msg);
+	exit(1);
+}
+
+/** @brief Byte i of the pattern of a slot */
+static unsigned char pattern(int slot, int i)
+{
+	return (unsigned char)(slot * 31 + i);
+}
+
+/** @brief Fill a chunk with the pattern of its slot, or only its ends */
+static void fill(int slot, int full)
+{
+	slot_t *s = &slots[slot];
+	int i;
+
+	if (!full)
+	{
+		s->p[0] = pattern(slot,0);
+		s->p[s->size - 1] = pattern(slot,s->size - 1);
+		return;
+	}
+	for (i = 0; i < s->size; i++)
+		s->p[i] = pattern(slot,i);
+}
+
+/** @brief Check the first n bytes of a chunk, or only the ends in them */
+static int intact(int slot, int n, int full)
+{
+	slot_t *s = &slots[slot];
+	int i;
+
+	if (!full)
+		return s->p[0] == pattern(slot,0) && (n < s->size ||
+				s->p[n - 1] == pattern(slot,n - 1));
+	for (i = 0; i < n; i++)
+		if (s->p[i] != pattern(slot,i))
+			return 0;
+	return 1;
+}
+
+/** @brief Order of ranges by start */
+static int range_cmp(const void *a, const void *b)
+{
+	const range_t *x = a,*y = b;
+
+	return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/** @brief Check that no free block and no two live chunks overlap
+ *
+ *  A malloc chunk starts at its size word.
+ *
+ *  @return 0, -1 if two ranges overlap
+ */
+static int overlap_check(void)
+{
+	vm_offset_t addr = 0;
+	vm_size_t size;
+	lmm_flags_t flags;
+	int i,n = 0;
+
+	for (i = 0; i < MAX_SLOTS; i++)
+	{
+		if (!slots[i].p)
+			continue;
+		ranges[n].start = (vm_offset_t)slots[i].p -
+			(slots[i].s ? 0 : sizeof(size_t));
+		ranges[n].end = (vm_offset_t)slots[i].p + slots[i].size;
+		ranges[n++].slot = i;
+	}
+	for (;;)
+	{
+		lmm_find_free(&malloc_lmm,&addr,&size,&flags);
+		if (size == 0)
+			break;
+		if (n == MAX_RANGES)
+		{
+			printf("more free blocks than the overlap check holds\n");
+			return -1;
+		}
+		ranges[n].start = addr;
+		ranges[n].end = addr + size;
+		ranges[n++].slot = -1;
+		addr += size;
+	}
+
+	qsort(ranges,n,sizeof(*ranges),range_cmp);
+	for (i = 1; i < n; i++)
+		if (ranges[i].start < ranges[i - 1].end)
+		{
+			printf("slot %d [%#lx,%#lx) overlaps slot %d [%#lx,%#lx) "
+					"(-1 is a free block)\n",ranges[i - 1].slot,
+					(unsigned long)ranges[i - 1].start,
+					(unsigned long)ranges[i - 1].end,ranges[i].slot,
+					(unsigned long)ranges[i].start,
+					(unsigned long)ranges[i].end);
+			return -1;
+		}
+	return 0;
+}
+
+/** @brief Free space outside the largest free block, in percent */
+static int fragmentation(void)
+{
+	vm_offset_t addr = 0;
+	vm_size_t size,largest = 0,total = 0;
+	lmm_flags_t flags;
+
+	for (;;)
+	{
+		lmm_find_free(&malloc_lmm,&addr,&size,&flags);
+		if (size == 0)
+			break;
+		total += size;
+		if (size > largest)
+			largest = size;
+		addr += size;
+	}
+	return total ? (int)((double)(total - largest) * 100 / total) : 0;
+}
+
+/** @brief Run one op
+ *
+ *  @param op The op
+ *  @param full Whether to fill and check whole chunks or only their ends
+ *  @return 0, -1 if the allocator failed or broke a chunk
+ */
+static int op_run(const op_t *op, int full)
+{
+	slot_t *s = &slots[op->slot];
+	unsigned char *p;
+	int i,keep;
+
+	switch (op->kind)
+	{
+	case 'f':
+		if (!s->p || !intact(op->slot,s->size,full))
+			return -1;
+		if (s->s)
+			_sfree(s->p,s->size);
+		else
+			_free(s->p);
+		live -= s->size;
+		s->p = NULL;
+		return 0;
+
+	case 'r':
+		if (!s->p || s->s)
+			return -1;
+		keep = s->size < op->size ? s->size : op->size;
+		if (!(p = _realloc(s->p,op->size)))
+			return -1;
+		s->p = p;
+		if (!intact(op->slot,keep,full))
+			return -1;
+		live += op->size - s->size;
+		s->size = op->size;
+		fill(op->slot,full);
+		return 0;
+	}
+
+	if (s->p)
+		return -1;
+	switch (op->kind)
+	{
+	case 'm':
+		p = _malloc(op->size);
+		break;
+	case 'c':
+		p = _calloc(1,op->size);
+		for (i = 0; p && full && i < op->size; i++)
+			if (p[i])
+				return -1;
+		break;
+	case 'a':
+		p = _memalign(op->align,op->size);
+		if (p && (size_t)p % op->align)
+			return -1;
+		break;
+	case 's':
+		p = _smalloc(op->size);
+		break;
+	default:
+		return -1;
+	}
+	if (!p || (size_t)p % sizeof(size_t) ||
+	    p < heap || p + op->size > heap + HEAP_SIZE)
+		return -1;
+	s->p = p;
+	s->size = op->size;
+	s->s = op->kind == 's';
+	live += op->size;
+	fill(op->slot,full);
+	return 0;
+}
+
+/** @brief Check a trace, overlap checks included
+ *
+ *  @return 0, -1 if an op failed
+ */
+static int trace_check(const op_t *ops, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (op_run(&ops[i],1) < 0)
+		{
+			printf("op %d (%c slot %d, %d bytes) failed\n",i,
+					ops[i].kind,ops[i].slot,ops[i].size);
+			return -1;
+		}
+		if (i % CHECK_EVERY == 0 && overlap_check() < 0)
+			return -1;
+	}
+	return overlap_check();
+}
+
+/** @brief Time a trace, sampling the heap every CHECK_EVERY ops
+ *
+ *  @return 0, -1 if an op failed
+ */
+static int trace_time(const op_t *ops, int n, result_t *r)
+{
+	double t = 0,start;
+	int i,j;
+
+	memset(r,0,sizeof(*r));
+	for (i = 0; i < n; i = j)
+	{
+		start = now_ns();
+		for (j = i; j < n && j < i + CHECK_EVERY; j++)
+			if (op_run(&ops[j],0) < 0)
+				return -1;
+		t += now_ns() - start;
+		if (live > r->live)
+		{
+			r->live = live;
+			r->used = heap_avail - lmm_avail(&malloc_lmm,0);
+			r->frag = fragmentation();
+		}
+	}
+	r->ns = n ? t / n : 0;
+	return 0;
+}
+
+/** @brief Random size of a mix */
+static int mix_size(const mix_t *m)
+{
+	int r = rand() % 100;
+
+	if (r < m->tiny)
+		return 1 + rand() % 128;
+	if (r < m->tiny + m->small)
+		return 129 + rand() % (2040 - 128);
+	return 2048 + rand() % (30 << 10);
+}
+
+/** @brief Random trace, ending with every slot free
+ *
+ *  @param m Size mix, NULL for the fuzz mix of every kind of op
+ *  @return Ops in it
+ */
+static int trace_make(const mix_t *m, op_t *ops, int nops, int nslots)
+{
+	static const mix_t fuzz = {"fuzz",50,30,15,5};
+	char *kinds = calloc(nslots,1);
+	op_t *op;
+	int i,r,n = 0;
+
+	if (!m)
+		m = &fuzz;
+	for (i = 0; i < nops; i++)
+	{
+		op = &ops[n++];
+		op->slot = rand() % nslots;
+		op->align = 0;
+		r = rand() % 100;
+		if (kinds[op->slot] && (kinds[op->slot] == 's' ||
+					r >= m->realloc))
+		{
+			op->kind = 'f';
+			op->size = 0;
+			kinds[op->slot] = 0;
+			continue;
+		}
+		op->size = mix_size(m);
+		if (kinds[op->slot])
+			op->kind = 'r';
+		else if (r < m->memalign)
+		{
+			op->kind = 'a';
+			op->align = 8 << rand() % 10;
+		}
+		else if (m == &fuzz)
+			op->kind = "mmcs"[rand() % 4];
+		else
+			op->kind = 'm';
+		kinds[op->slot] = op->kind == 'r' ? kinds[op->slot] : op->kind;
+	}
+	for (i = 0; i < nslots; i++)
+		if (kinds[i])
+		{
+			ops[n].kind = 'f';
+			ops[n].slot = i;
+			ops[n].size = ops[n].align = 0;
+			n++;
+		}
+	free(kinds);
+	return n;
+}
+
+/** @brief Read a trace
+ *
+ *  @param f The file
+ *  @param n Set to the ops in it
+ *  @return The ops, NULL if a line is not an op
+ */
+static op_t *trace_read(FILE *f, int *n)
+{
+	char line[128],kind;
+	op_t *ops = NULL;
+	int max = 0,a,b,c,k;
+
+	*n = 0;
+	while (fgets(line,sizeof(line),f))
+	{
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (*n == max)
+		{
+			max = max ? 2 * max : 4096;
+			ops = realloc(ops,max * sizeof(*ops));
+		}
+		k = sscanf(line," %c %d %d %d",&kind,&a,&b,&c);
+		if (k < 2 || a < 0 || a >= MAX_SLOTS ||
+		    (kind == 'a' ? k != 4 || b <= 0 || (b & (b - 1)) || c <= 0
+				 : kind == 'f' ? k != 2 : k != 3 || b <= 0))
+		{
+			printf("trace line %d: %s",*n + 1,line);
+			free(ops);
+			return NULL;
+		}
+		ops[*n].kind = kind;
+		ops[*n].slot = a;
+		ops[*n].align = kind == 'a' ? b : 0;
+		ops[*n].size = kind == 'a' ? c : kind == 'f' ? 0 : b;
+		(*n)++;
+	}
+	return ops;
+}
+
+/** @brief Write a trace */
+static void trace_write(FILE *f, const op_t *ops, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (ops[i].kind == 'f')
+			fprintf(f,"f %d\n",ops[i].slot);
+		else if (ops[i].kind == 'a')
+			fprintf(f,"a %d %d %d\n",ops[i].slot,ops[i].align,
+					ops[i].size);
+		else
+			fprintf(f,"%c %d %d\n",ops[i].kind,ops[i].slot,ops[i].size);
+	}
+}
+
+/** @brief Print a timed run */
+static void result_print(const char *name, const result_t *r)
+{
+	printf("%-10s %8.1f %10ld %10ld %9ld%% %7d%%\n",name,r->ns,
+			r->live >> 10,r->used >> 10,
+			r->live ? (long)((double)(r->used - r->live) * 100 / r->live)
+				: 0,r->frag);
+}
+
+/** @brief Header of the timed runs */
+static void result_header(void)
+{
+	printf("%s lmm\n",
+#ifdef LMM_SEGREGATED
+			"segregated"
+#else
+			"list"
+#endif
+			);
+	printf("trace         ns/op    live KB    used KB  overhead    frag\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *mode = argc > 1 ? argv[1] : "bench";
+	int nops = argc > 2 ? atoi(argv[2]) : 1000000;
+	int nslots = 4096,seed = 1;
+	op_t *ops = NULL;
+	FILE *f;
+	result_t r;
+	unsigned int i;
+	int n;
+
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+		if (!strcmp(mode,modes[i].name))
+			return modes[i].run(argc - 1,argv + 1);
+
+	if (!(heap = heap_init(&malloc_lmm,HEAP_SIZE)))
+		return 2;
+	heap_avail = lmm_avail(&malloc_lmm,0);
+
+	if (!strcmp(mode,"replay") && argc > 2)
+	{
+		if (!(f = fopen(argv[2],"r")))
+			return 2;
+		ops = trace_read(f,&n);
+		fclose(f);
+		if (!ops || trace_check(ops,n) < 0)
+			return 1;
+		result_header();
+		if (trace_time(ops,n,&r) < 0)
+			return 1;
+		result_print("replay",&r);
+	}
+	else if (!strcmp(mode,"fuzz"))
+	{
+		seed = argc > 3 ? atoi(argv[3]) : 1;
+		nslots = 1024;
+	}
+	else if (!strcmp(mode,"record") || !strcmp(mode,"bench"))
+	{
+		nslots = argc > 3 ? atoi(argv[3]) : 4096;
+		seed = argc > 4 ? atoi(argv[4]) : 1;
+	}
+	else
+	{
+		printf("usage: %s fuzz [ops] [seed]\n"
+		       "       %s record [ops] [slots] [seed] > file\n"
+		       "       %s replay file\n"
+		       "       %s bench [ops] [slots]\n",
+		       argv[0],argv[0],argv[0],argv[0]);
+		for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+			printf("       %s %s %s\n",argv[0],modes[i].name,
+					modes[i].args);
+		return 2;
+	}
+	if (ops)
+	{
+		free(ops);
+		return 0;
+	}
+
+	if (nops < 1 || nslots < 1 || nslots > MAX_SLOTS ||
+	    !(ops = malloc((nops + nslots) * sizeof(*ops))))
+		return 2;
+	srand(seed);
+	if (!strcmp(mode,"fuzz"))
+	{
+		n = trace_make(NULL,ops,nops,nslots);
+		if (trace_check(ops,n) < 0)
+			return 1;
+		printf("%d ops fuzzed, no invariant broken\n",n);
+	}
+	else if (!strcmp(mode,"record"))
+	{
+		n = trace_make(&mixes[1],ops,nops,nslots);
+		printf("# %d ops, %d slots\n",n,nslots);
+		trace_write(stdout,ops,n);
+	}
+	else
+	{
+		result_header();
+		for (i = 0; i < sizeof(mixes) / sizeof(mixes[0]); i++)
+		{
+			srand(i + 1);
+			n = trace_make(&mixes[i],ops,nops,nslots);
+			if (trace_time(ops,n,&r) < 0)
+				return 1;
+			result_print(mixes[i].name,&r);
+		}
+	}
+	free(ops);
+	return 0;
+}
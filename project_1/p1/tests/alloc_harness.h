@@ -0,0 +1,37 @@
+/** @file alloc_harness.h
+ *  @brief Modes of alloc_harness kept in files of their own
+ *
+ *  Each takes the arguments after the mode name, argv[0] being the
+ *  mode, and returns the exit status: 0, 1 if a check failed, 2 for
+ *  bad arguments.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _ALLOC_HARNESS_H_
+#define _ALLOC_HARNESS_H_
+
+#include <setjmp.h>
+
+/** @brief Where panic() jumps back to, NULL to print and exit */
+extern jmp_buf *panic_catch;
+/** @brief What the last panic() said */
+extern char panic_msg[256];
+
+/** @brief malloc against lmm alone, malloc_bench.c */
+int malloc_mode(int argc, char **argv);
+/** @brief Page blocks through the buddy allocator, buddy_bench.c */
+int buddy_mode(int argc, char **argv);
+/** @brief Threads as malloc contexts, magazine_bench.c */
+int magazine_mode(int argc, char **argv);
+/** @brief Arenas against malloc, arena_bench.c */
+int arena_mode(int argc, char **argv);
+/** @brief calloc and the zeroed page pool, zero_bench.c */
+int zero_mode(int argc, char **argv);
+/** @brief The leak report of MALLOC_STATS, stats_bench.c */
+int stats_mode(int argc, char **argv);
+/** @brief The debug heap of MALLOC_DEBUG, debug_bench.c */
+int debug_mode(int argc, char **argv);
+
+#endif /* _ALLOC_HARNESS_H_ */
@@ -0,0 +1,148 @@
+/** @file arena_bench.c
+ *
+ *  @brief arena mode of alloc_harness: arenas against malloc for
+ *  phase-scoped memory
+ *
+ *  A phase allocates a random number of chunks of 1 to 300 bytes, with
+ *  now and then one of several pages like a big board, stamps them all,
+ *  checks the stamps and then drops everything. With malloc every chunk
+ *  is freed on its own; with an arena the phase ends in one
+ *  arena_reset(). The bytes kept per phase are compared too: the arena
+ *  has no size word, only the rounding to ARENA_ALIGN and the space
+ *  left at the end of its pages.
+ *
+ *  Usage: alloc_harness arena [phases] [most chunks per phase]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include <malloc/arena.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (64 << 20)
+/** @brief Bytes of the occasional big chunk */
+#define BIG_CHUNK 20000
+
+/** @brief Chunks of the current phase and their sizes */
+static unsigned char **chunks;
+static int *sizes;
+
+/** @brief Sizes of one phase, the same for both runs
+ *
+ *  @return Chunks in the phase
+ */
+static int phase_sizes(int most)
+{
+	int n = 1 + rand() % most,i;
+
+	for (i = 0; i < n; i++)
+		sizes[i] = rand() % 64 ? 1 + rand() % 300 : BIG_CHUNK;
+	return n;
+}
+
+/** @brief Stamp the chunks of a phase and check them
+ *
+ *  @return 0, -1 if two chunks overlap or one is misaligned
+ */
+static int phase_check(int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if ((size_t)chunks[i] % ARENA_ALIGN)
+			return -1;
+		chunks[i][0] = chunks[i][sizes[i] - 1] = (unsigned char)i;
+	}
+	for (i = 0; i < n; i++)
+		if (chunks[i][0] != (unsigned char)i ||
+		    chunks[i][sizes[i] - 1] != (unsigned char)i)
+			return -1;
+	return 0;
+}
+
+/** @brief Run the phases
+ *
+ *  @param arena The arena, NULL for malloc and free
+ *  @param kept Set to the bytes lmm lost to the largest phase
+ *  @return Nanoseconds per chunk, -1 if a phase failed its check
+ */
+static double run(arena_t *arena, int phases, int most, size_t *kept)
+{
+	size_t before = lmm_avail(&malloc_lmm,0);
+	double t = 0,start;
+	long total = 0;
+	int p,i,n;
+
+	*kept = 0;
+	srand(1);
+	for (p = 0; p < phases; p++)
+	{
+		n = phase_sizes(most);
+		start = now_ns();
+		for (i = 0; i < n; i++)
+			if (!(chunks[i] = arena ? arena_alloc(arena,sizes[i])
+						: _malloc(sizes[i])))
+				return -1;
+		t += now_ns() - start;
+		if (phase_check(n) < 0)
+			return -1;
+		if (before - lmm_avail(&malloc_lmm,0) > *kept)
+			*kept = before - lmm_avail(&malloc_lmm,0);
+		start = now_ns();
+		if (arena)
+			arena_reset(arena);
+		else
+			for (i = 0; i < n; i++)
+				_free(chunks[i]);
+		t += now_ns() - start;
+		total += n;
+	}
+	return t / total;
+}
+
+int arena_mode(int argc, char **argv)
+{
+	int phases = argc > 1 ? atoi(argv[1]) : 20000;
+	int most = argc > 2 ? atoi(argv[2]) : 200;
+	size_t before,mkept,akept;
+	double mns,ans;
+	arena_t arena;
+
+	chunks = calloc(most,sizeof(*chunks));
+	sizes = calloc(most,sizeof(*sizes));
+	if (chunks == NULL || sizes == NULL || most < 1 ||
+	    heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+
+	arena_create(&arena);
+	mns = run(NULL,phases,most,&mkept);
+	/* The magazines keep what malloc freed, the arena gives it all back */
+	before = lmm_avail(&malloc_lmm,0);
+	ans = run(&arena,phases,most,&akept);
+	if (mns < 0 || ans < 0)
+	{
+		printf("chunk overwritten or misaligned\n");
+		return 1;
+	}
+	arena_destroy(&arena);
+
+	printf("%d phases of up to %d chunks\n",phases,most);
+	printf("          ns/chunk  most KB kept\n");
+	printf("malloc  %10.1f %13zu\n",mns,mkept >> 10);
+	printf("arena   %10.1f %13zu\n",ans,akept >> 10);
+	if (lmm_avail(&malloc_lmm,0) != before)
+	{
+		printf("arena_destroy() left pages behind\n");
+		return 1;
+	}
+	return 0;
+}
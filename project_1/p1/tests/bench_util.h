@@ -0,0 +1,44 @@
+/** @file bench_util.h
+ *  @brief Clock and heap of the host benchmarks
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _BENCH_UTIL_H_
+#define _BENCH_UTIL_H_
+
+#include <stdlib.h>
+#include <time.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+
+/** @brief Current time in nanoseconds */
+static inline double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/** @brief Give a fresh lmm one heap region, as mb_util_lmm() gives
+ *  malloc_lmm the free memory in the kernel
+ *
+ *  @param lmm The lmm, malloc_lmm for the allocator
+ *  @param size Bytes of the heap
+ *  @return The heap, aligned to 64 KB, NULL if there is no room for it
+ */
+static inline void *heap_init(lmm_t *lmm, size_t size)
+{
+	static lmm_region_t region;
+	void *heap = aligned_alloc(1 << 16,size);
+
+	if (heap == NULL)
+		return NULL;
+	lmm_init(lmm);
+	lmm_add_region(lmm,&region,heap,size,0,0);
+	lmm_add_free(lmm,heap,size);
+	return heap;
+}
+
+#endif /* _BENCH_UTIL_H_ */
@@ -0,0 +1,248 @@
+/** @file buddy_bench.c
+ *
+ *  @brief buddy mode of alloc_harness: page block allocation in the lmm
+ *
+ *  The heap is split into a small region with flag 1 and a lower
+ *  priority and a large one without, as util_lmm sets up low and high
+ *  memory in the kernel. A
+ *  random trace allocates and frees power of two page blocks, mostly
+ *  one to eight pages with the odd 4 MB superpage, among small
+ *  unaligned lmm_alloc() chunks that break up the free lists. It runs
+ *  twice on a fresh lmm over the same heap: once with every page block
+ *  going straight to lmm_alloc_gen(), which is what lmm_alloc_aligned()
+ *  did before the buddy allocator, and once through
+ *  lmm_alloc_aligned(). Each page block alloc and free is timed on its
+ *  own, so the figures include one clock read.
+ *
+ *  Halfway through the trace, with its chunks still live, the run
+ *  counts how many more 4 MB superpages it can get, then gives them
+ *  back. At the end every chunk is freed and lmm_avail() must be what
+ *  it was at the start.
+ *
+ *  Usage: alloc_harness buddy [ops] [slots]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <lmm/lmm_buddy.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the region with flag 1 */
+#define LOW_SIZE (16 << 20)
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (256 << 20)
+/** @brief Bytes of a superpage */
+#define SUPERPAGE_SIZE (4 << 20)
+
+/** @brief Operation of the trace */
+typedef struct op {
+	/** @brief Slot it works on */
+	int slot;
+	/** @brief Bytes to allocate, 0 to free the slot */
+	int size;
+	/** @brief Region flags to ask for */
+	int flags;
+	/** @brief Whether it is a page block rather than a small chunk */
+	int pages;
+} op_t;
+
+/** @brief Memory manager of a run */
+static lmm_t lmm;
+/** @brief Its regions */
+static lmm_region_t low_region, high_region;
+
+/** @brief Live chunks, one per slot */
+static char **slot_ptr;
+/** @brief Page block alloc and free times of a run */
+static double *lat;
+
+/** @brief Generate the trace, ending with every slot free */
+static int trace_make(op_t *ops, int nops, int slots)
+{
+	op_t *live = calloc(slots,sizeof(*live));
+	int i,n = 0,order;
+
+	for (i = 0; i < nops; i++)
+	{
+		ops[n].slot = rand() % slots;
+		if (live[ops[n].slot].size)
+		{
+			ops[n] = live[ops[n].slot];
+			ops[n].size = 0;
+		} else if (rand() % 3) {
+			order = rand() % 4;
+			if (rand() % 500 == 0)
+				order = __builtin_ctz(SUPERPAGE_SIZE / PAGE_SIZE);
+			ops[n].size = PAGE_SIZE << order;
+			ops[n].flags = rand() % 8 == 0;
+			ops[n].pages = 1;
+		} else {
+			ops[n].size = 8 + rand() % 2000;
+			ops[n].flags = 0;
+			ops[n].pages = 0;
+		}
+		live[ops[n].slot] = ops[n];
+		n++;
+	}
+	for (i = 0; i < slots; i++)
+		if (live[i].size)
+		{
+			ops[n] = live[i];
+			ops[n++].size = 0;
+		}
+	free(live);
+	return n;
+}
+
+/** @brief Give the heap to a fresh lmm, in a low and a high region */
+static void regions_init(char *heap)
+{
+	lmm_init(&lmm);
+	lmm_add_region(&lmm,&low_region,heap,LOW_SIZE,1,-1);
+	lmm_add_region(&lmm,&high_region,heap + LOW_SIZE,HEAP_SIZE - LOW_SIZE,
+			0,0);
+	lmm_add_free(&lmm,heap,HEAP_SIZE);
+}
+
+/** @brief Allocate a page block
+ *
+ *  @param size Bytes, a power of two number of pages
+ *  @param flags Region flags
+ *  @param buddy Whether to go through lmm_alloc_aligned()
+ */
+static void *page_alloc(vm_size_t size, int flags, int buddy)
+{
+	int shift = __builtin_ctzl(size);
+
+	if (buddy)
+		return lmm_alloc_aligned(&lmm,size,flags,shift,0);
+	return lmm_alloc_gen(&lmm,size,flags,shift,0,(vm_offset_t)0,
+			(vm_size_t)-1);
+}
+
+/** @brief 4 MB superpages that can still be allocated */
+static int superpages_left(int buddy)
+{
+	void *sp[HEAP_SIZE / SUPERPAGE_SIZE];
+	int i,n = 0;
+
+	while ((sp[n] = page_alloc(SUPERPAGE_SIZE,0,buddy)) != NULL)
+		n++;
+	for (i = 0; i < n; i++)
+		lmm_free(&lmm,sp[i],SUPERPAGE_SIZE);
+	return n;
+}
+
+/** @brief Compare two doubles for qsort() */
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+/** @brief Run the trace and print a line of results
+ *
+ *  @param name Name printed
+ *  @param ops Trace
+ *  @param n Ops in it
+ *  @param heap Heap, HEAP_SIZE bytes
+ *  @param buddy Whether page blocks go through lmm_alloc_aligned()
+ *  @return 0, -1 if a chunk was lost or came from the wrong region or
+ *  lmm_avail() was not restored
+ */
+static int trace_run(const char *name, const op_t *ops, int n, char *heap,
+		int buddy)
+{
+	vm_size_t avail;
+	double t,sum = 0;
+	int i,nlat = 0,left = 0;
+	const op_t *op;
+	char *p;
+
+	regions_init(heap);
+	/* Let the buddy allocator set itself up before taking the baseline;
+	 * the arena it takes goes back once the page is freed */
+	lmm_free_page(&lmm,page_alloc(PAGE_SIZE,0,buddy));
+	avail = lmm_avail(&lmm,0);
+
+	for (i = 0; i < n; i++)
+	{
+		op = &ops[i];
+		if (i == n / 2)
+			left = superpages_left(buddy);
+		p = slot_ptr[op->slot];
+
+		if (op->size == 0)
+		{
+			/* The trace frees what it allocated, even if that failed */
+			if (p == NULL)
+				continue;
+			if (*p != (char)op->slot)
+				return -1;
+			slot_ptr[op->slot] = NULL;
+			t = now_ns();
+			lmm_free(&lmm,p,*(int *)(p + 4));
+			if (op->pages)
+				lat[nlat++] = now_ns() - t;
+			continue;
+		}
+
+		t = now_ns();
+		if (!op->pages)
+			p = lmm_alloc(&lmm,op->size,0);
+		else
+		{
+			p = page_alloc(op->size,op->flags,buddy);
+			lat[nlat++] = now_ns() - t;
+		}
+		if (p == NULL)
+			continue;
+		if (op->flags && (p < heap || p >= heap + LOW_SIZE))
+			return -1;
+		/* Stamp the chunk with its slot and size */
+		*p = (char)op->slot;
+		*(int *)(p + 4) = op->size;
+		slot_ptr[op->slot] = p;
+	}
+
+	for (i = 0; i < nlat; i++)
+		sum += lat[i];
+	qsort(lat,nlat,sizeof(*lat),cmp_double);
+	printf("%-14s %10.1f %10.1f %14d\n",name,sum / nlat,
+			lat[nlat * 99 / 100],left);
+	return lmm_avail(&lmm,0) == avail ? 0 : -1;
+}
+
+int buddy_mode(int argc, char **argv)
+{
+	int nops = argc > 1 ? atoi(argv[1]) : 200000;
+	int slots = argc > 2 ? atoi(argv[2]) : 4096;
+	op_t *ops = malloc((nops + slots) * sizeof(*ops));
+	char *heap = aligned_alloc(SUPERPAGE_SIZE,HEAP_SIZE);
+	int n;
+
+	slot_ptr = calloc(slots,sizeof(*slot_ptr));
+	lat = malloc((nops + slots) * sizeof(*lat));
+	if (ops == NULL || heap == NULL || slot_ptr == NULL || lat == NULL)
+		return 2;
+
+	srand(1);
+	n = trace_make(ops,nops,slots);
+	printf("%d ops, %d slots\n",nops,slots);
+	printf("page blocks       mean ns     p99 ns  4MB pages left\n");
+	if (trace_run("lmm_alloc_gen",ops,n,heap,0) < 0 ||
+	    trace_run("buddy",ops,n,heap,1) < 0)
+	{
+		printf("chunk lost, in the wrong region or not given back\n");
+		return 1;
+	}
+	free(ops);
+	return 0;
+}
@@ -0,0 +1,261 @@
+/** @file debug_bench.c
+ *
+ *  @brief debug mode of alloc_harness: check and cost of the debug heap
+ *
+ *  Only in alloc_harness_debug, whose malloc is built with MALLOC_DEBUG;
+ *  panic() jumps back here. Each
+ *  kind of corruption the debug heap is for is done once on purpose, and
+ *  has to panic with the right message, from free(), realloc() or
+ *  malloc_debug_audit(), arena allocations included; the corruption is
+ *  then undone so that the heap stays usable. memalign() and calloc()
+ *  have to keep their promises with the header in front of the chunk.
+ *
+ *  Random mallocs and frees are then timed, for comparison with the
+ *  malloc mode of alloc_harness, which is built without it.
+ *
+ *  Usage: alloc_harness_debug debug [ops] [slots]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include <malloc/malloc_debug.h>
+#include <malloc/arena.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (64 << 20)
+
+/** @brief Where panic() returns to */
+static jmp_buf panicked;
+
+/** @brief Check a panic said what it should
+ *
+ *  @return 0, -1 if it did not
+ */
+static int expect(const char *name, const char *what)
+{
+	if (!strstr(panic_msg,what))
+	{
+		printf("%s: expected \"%s\", got \"%s\"\n",name,what,panic_msg);
+		return -1;
+	}
+	printf("%-28s %s\n",name,panic_msg);
+	panic_msg[0] = 0;
+	return 0;
+}
+
+/** @brief Free enough chunks to push everything out of the quarantine */
+static void flush_quarantine(void)
+{
+	int i;
+
+	for (i = 0; i < MALLOC_DEBUG_QUARANTINE; i++)
+		_free(_malloc(16));
+}
+
+/** @brief Do each corruption once
+ *
+ *  @return 0, -1 if one was missed or named wrong
+ */
+static int corrupt(void)
+{
+	unsigned char *p,*q;
+	unsigned char saved;
+	arena_t arena;
+	int i;
+
+	/* One byte past a small and a large chunk, seen by free() */
+	p = _malloc(13);
+	if (!setjmp(panicked))
+	{
+		p[13] = 0;
+		_free(p);
+		return -1;
+	}
+	p[13] = MALLOC_DEBUG_RED;
+	if (expect("overflow, small chunk","write past the end") < 0)
+		return -1;
+	_free(p);
+
+	p = _malloc(5000);
+	if (!setjmp(panicked))
+	{
+		p[5000] = 0;
+		_free(p);
+		return -1;
+	}
+	p[5000] = MALLOC_DEBUG_RED;
+	if (expect("overflow, large chunk","write past the end") < 0)
+		return -1;
+	_free(p);
+
+	/* One byte before, over the canary */
+	p = _malloc(40);
+	saved = p[-1];
+	if (!setjmp(panicked))
+	{
+		p[-1] ^= 0xff;
+		_free(p);
+		return -1;
+	}
+	p[-1] = saved;
+	if (expect("underflow","header overwritten") < 0)
+		return -1;
+	_free(p);
+
+	/* Twice, and realloc of a freed chunk */
+	p = _malloc(100);
+	_free(p);
+	if (!setjmp(panicked))
+	{
+		_free(p);
+		return -1;
+	}
+	if (expect("double free","freed twice") < 0)
+		return -1;
+	if (!setjmp(panicked))
+	{
+		_realloc(p,200);
+		return -1;
+	}
+	if (expect("realloc after free","realloc of a freed chunk") < 0)
+		return -1;
+
+	/* Into a freed chunk, seen by the audit and when it is pushed out */
+	p = _malloc(64);
+	_free(p);
+	if (!setjmp(panicked))
+	{
+		p[10] = 1;
+		malloc_debug_audit();
+		return -1;
+	}
+	if (expect("write after free, audit","write after free") < 0)
+		return -1;
+	if (!setjmp(panicked))
+	{
+		flush_quarantine();
+		return -1;
+	}
+	p[10] = MALLOC_DEBUG_FREED;
+	if (expect("write after free, eviction","write after free") < 0)
+		return -1;
+	flush_quarantine();
+
+	/* Past a live chunk, seen by the audit before anyone frees it */
+	p = _malloc(300);
+	if (!setjmp(panicked))
+	{
+		p[303] = 0;
+		malloc_debug_audit();
+		return -1;
+	}
+	p[303] = MALLOC_DEBUG_RED;
+	if (expect("overflow, audit","write past the end") < 0)
+		return -1;
+
+	/* Past an arena allocation, as a board in game_arena */
+	arena_create(&arena);
+	q = arena_alloc(&arena,36);
+	if (!setjmp(panicked))
+	{
+		q[36] = 0;
+		malloc_debug_audit();
+		return -1;
+	}
+	q[36] = MALLOC_DEBUG_RED;
+	if (expect("overflow, arena","write past the end") < 0)
+		return -1;
+	arena_destroy(&arena);
+
+	/* What has to keep working */
+	if (malloc_debug_audit() < 1)
+		return -1;
+	for (i = 0; i < 300; i++)
+		p[i] = i;
+	q = _realloc(p,600);
+	for (i = 0; i < 300; i++)
+		if (q == p || q[i] != (unsigned char)i)
+			return -1;
+	_free(q);
+	p = _memalign(256,1000);
+	q = _calloc(1,3000);
+	if ((size_t)p % 256 || !q)
+		return -1;
+	for (i = 0; i < 3000; i++)
+		if (q[i])
+			return -1;
+	_free(p);
+	_free(q);
+	flush_quarantine();
+	return malloc_debug_audit() < 0 ? -1 : 0;
+}
+
+/** @brief Random mallocs and frees that end with everything freed
+ *
+ *  @param audit Set to the nanoseconds of an audit before the end
+ *  @param audited Set to the chunks it checked
+ *  @return Nanoseconds per op
+ */
+static double churn(int nops, int slots, double *audit, int *audited)
+{
+	void **ptr = calloc(slots,sizeof(*ptr));
+	double t = now_ns();
+	int i,s;
+
+	for (i = 0; i < nops; i++)
+	{
+		s = rand() % slots;
+		if (ptr[s])
+		{
+			_free(ptr[s]);
+			ptr[s] = NULL;
+		}
+		else
+			ptr[s] = _malloc(1 + rand() % (rand() % 8 ? 500 : 8000));
+	}
+	t = now_ns() - t;
+	*audit = now_ns();
+	*audited = malloc_debug_audit();
+	*audit = now_ns() - *audit;
+	for (s = 0; s < slots; s++)
+		if (ptr[s])
+			_free(ptr[s]);
+	free(ptr);
+	return t / nops;
+}
+
+int debug_mode(int argc, char **argv)
+{
+	int nops = argc > 1 ? atoi(argv[1]) : 1000000;
+	int slots = argc > 2 ? atoi(argv[2]) : 4096;
+	double ns,audit;
+	int n;
+
+	if (heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+	panic_catch = &panicked;
+
+	if (corrupt() < 0)
+	{
+		printf("corruption missed or misnamed\n");
+		return 1;
+	}
+	printf("every corruption caught\n");
+	/* corrupt() has returned, so a panic from here on is a real one */
+	panic_catch = NULL;
+
+	srand(1);
+	ns = churn(nops,slots,&audit,&n);
+	printf("%d ops, %d slots: %.1f ns/op with the debug heap, "
+			"audit of %d chunks %.0f us\n",nops,slots,ns,n,audit / 1e3);
+	return 0;
+}
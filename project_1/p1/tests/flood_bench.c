@@ -0,0 +1,115 @@
+/** @file flood_bench.c
+ *
+ *  @brief Host benchmark of the scanline flood fill
+ *
+ *  Plays Flood-It games on large random boards, flooding from the top
+ *  left block with the next colour in turn until the board is one
+ *  colour. Every move is done by flood_fill() and by the recursive
+ *  fill the game used to have, the boards are compared after each
+ *  move and the time per move of both is printed.
+ *
+ *  Usage: flood_bench [size] [colors] [games]
+ *
+ *  The recursive fill needs one stack frame per block, so boards much
+ *  larger than 200x200 need a larger stack (ulimit -s).
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flood.h"
+#include "bench_util.h"
+
+/** @brief The recursive fill flood_it() used to be */
+static int flood_recursive(uint8_t *board, int rows, int cols, int row,
+		int col, uint8_t new_color, uint8_t old_color)
+{
+	int filled = 1;
+	if (board[row * cols + col] != old_color)
+		return 0;
+	board[row * cols + col] = new_color;
+	if (col + 1 < cols)
+		filled += flood_recursive(board,rows,cols,row,col + 1,new_color,
+				old_color);
+	if (row + 1 < rows)
+		filled += flood_recursive(board,rows,cols,row + 1,col,new_color,
+				old_color);
+	if (row - 1 >= 0)
+		filled += flood_recursive(board,rows,cols,row - 1,col,new_color,
+				old_color);
+	if (col - 1 >= 0)
+		filled += flood_recursive(board,rows,cols,row,col - 1,new_color,
+				old_color);
+	return filled;
+}
+
+/** @brief Counts the span callbacks */
+static void count_span(int row, int col_start, int col_end, uint8_t color,
+		void *arg)
+{
+	(*(long *)arg)++;
+}
+
+int main(int argc, char **argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 200;
+	int colors = argc > 2 ? atoi(argv[2]) : 6;
+	int games = argc > 3 ? atoi(argv[3]) : 20;
+	int cells = size * size;
+	uint8_t *scan = malloc(cells),*rec = malloc(cells);
+	double scan_ns = 0,rec_ns = 0,t;
+	long moves = 0,spans = 0,filled = 0;
+	int g,i,n,m;
+	uint8_t color;
+
+	if (scan == NULL || rec == NULL || size <= 0 || colors < 2)
+		return 1;
+	for (g = 0; g < games; g++)
+	{
+		srand(g + 1);
+		for (i = 0; i < cells; i++)
+			scan[i] = rand() % colors;
+		memcpy(rec,scan,cells);
+		color = scan[0];
+		while (1)
+		{
+			for (i = 0; i < cells && scan[i] == scan[0]; i++)
+				continue;
+			if (i == cells)
+				break;
+			color = (color + 1) % colors;
+
+			t = now_ns();
+			n = flood_fill(scan,size,size,0,0,color,count_span,&spans);
+			scan_ns += now_ns() - t;
+
+			t = now_ns();
+			m = rec[0] == color ? 0 :
+				flood_recursive(rec,size,size,0,0,color,rec[0]);
+			rec_ns += now_ns() - t;
+
+			if (n == FLOOD_OVERFLOW)
+			{
+				printf("game %d: span stack overflow\n",g);
+				return 1;
+			}
+			if (n != m || memcmp(scan,rec,cells) != 0)
+			{
+				printf("game %d move %ld: mismatch (%d vs %d)\n",g,moves,n,m);
+				return 1;
+			}
+			filled += n;
+			moves++;
+		}
+	}
+	printf("%dx%d, %d colors, %d games, %ld moves, %ld cells filled\n",
+			size,size,colors,games,moves,filled);
+	printf("scanline:  %10.1f ns/move %6.2f ns/cell %ld spans\n",
+			scan_ns / moves,scan_ns / filled,spans);
+	printf("recursive: %10.1f ns/move %6.2f ns/cell\n",
+			rec_ns / moves,rec_ns / filled);
+	return 0;
+}
@@ -0,0 +1,81 @@
+/** @file hint_test.c
+ *
+ *  @brief Host test of the hint engine on known boards
+ *
+ *  -- A board where the colour that gains the most blocks now is not
+ *  the one to play: hint_best() has to look ahead and pick the other
+ *  -- A board with one other colour left, which is the hint at once
+ *  -- A flooded board, which has no hint
+ *
+ *  Usage: hint_test
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include "bitboard.h"
+#include "hint.h"
+
+/** @brief A known board, as planes */
+typedef struct known {
+	/** @brief Name printed */
+	const char *name;
+	int rows;
+	int cols;
+	const uint8_t *planes;
+	/** @brief Plane of the hint, -1 for none */
+	int hint;
+} known_t;
+
+/** @brief Playing 0 gains 4 blocks and 2 gains 1, but 2, 0, 1 floods
+ *  the board in three moves and nothing after 0 does */
+static const uint8_t greedy_trap[] = {
+	1,1,2,0,
+	0,0,1,0,
+	1,0,0,1,
+};
+
+/** @brief Only plane 3 is left */
+static const uint8_t last_colour[] = {
+	5,5,5,
+	5,3,3,
+};
+
+/** @brief Already one colour */
+static const uint8_t flooded[] = {
+	4,4,
+	4,4,
+};
+
+static const known_t boards[] = {
+	{"greedy trap",3,4,greedy_trap,2},
+	{"last colour",2,3,last_colour,3},
+	{"flooded",2,2,flooded,-1},
+};
+
+int main(void)
+{
+	uint8_t cells[BITBOARD_MAX_ROWS * BITBOARD_MAX_COLS];
+	const known_t *k;
+	bitboard_t board;
+	unsigned int i;
+	int j,hint,depth,fail = 0;
+
+	for (i = 0; i < sizeof(boards) / sizeof(boards[0]); i++)
+	{
+		k = &boards[i];
+		for (j = 0; j < k->rows * k->cols; j++)
+			cells[j] = BITBOARD_COLOR(k->planes[j]);
+		bitboard_load(&board,cells,k->rows,k->cols);
+		hint = hint_best(&board,NULL,0,&depth);
+		printf("%-12s hint %2d, %d moves deep",k->name,hint,depth);
+		if (hint != k->hint)
+		{
+			printf(", expected %d",k->hint);
+			fail = 1;
+		}
+		printf("\n");
+	}
+	return fail;
+}
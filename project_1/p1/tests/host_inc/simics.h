@@ -0,0 +1,17 @@
+/** @file simics.h
+ *  @brief Host stand-in for the simics interface
+ *
+ *  lprintf() prints a line on stdout, as the simics log would.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HOST_SIMICS_H_
+#define _HOST_SIMICS_H_
+
+#include <stdio.h>
+
+#define lprintf(...) (printf(__VA_ARGS__), printf("\n"))
+
+#endif /* _HOST_SIMICS_H_ */
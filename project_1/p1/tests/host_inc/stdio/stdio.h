@@ -0,0 +1,13 @@
+/** @file stdio/stdio.h
+ *  @brief Host stand-in for the 410kern stdio library
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HOST_STDIO_STDIO_H_
+#define _HOST_STDIO_STDIO_H_
+
+#include <stdio.h>
+
+#endif /* _HOST_STDIO_STDIO_H_ */
@@ -0,0 +1,17 @@
+/** @file stdlib.h
+ *  @brief Host stand-in for the 410kern stdlib
+ *
+ *  The host's stdlib, and panic(), which the host program defines.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HOST_STDLIB_H_
+#define _HOST_STDLIB_H_
+
+#include_next <stdlib.h>
+
+void panic(const char *format, ...);
+
+#endif /* _HOST_STDLIB_H_ */
@@ -0,0 +1,13 @@
+/** @file string/string.h
+ *  @brief Host stand-in for the 410kern string library
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HOST_STRING_STRING_H_
+#define _HOST_STRING_STRING_H_
+
+#include <string.h>
+
+#endif /* _HOST_STRING_STRING_H_ */
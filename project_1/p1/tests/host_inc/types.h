@@ -0,0 +1,24 @@
+/** @file types.h
+ *  @brief Host stand-in for the 410kern types
+ *
+ *  size_t comes from the host so that the C library and the kernel
+ *  sources agree on it; the vm types are as wide as a pointer.
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#ifndef _HOST_TYPES_H_
+#define _HOST_TYPES_H_
+
+#include <stddef.h>
+
+typedef unsigned long vm_offset_t;
+typedef unsigned long vm_size_t;
+
+typedef enum {
+    FALSE = 0,
+    TRUE
+} boolean_t;
+
+#endif /* _HOST_TYPES_H_ */
@@ -0,0 +1,140 @@
+/** @file leaderboard_test.c
+ *
+ *  @brief Host test of the high score table
+ *
+ *  -- Inserts land in order of moves, then seconds, and return their rank
+ *  -- A tie goes after the entries already in the table
+ *  -- A full table drops its last entry for a better game and turns
+ *  away a game no better than its last one
+ *  -- A saved table restores as it was; one with a byte flipped, a bad
+ *  magic number or too little room is turned away and leaves the table
+ *  alone
+ *
+ *  Usage: leaderboard_test
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "leaderboard.h"
+
+/** @brief Report a failed check and count it */
+#define CHECK(cond) \
+	do { if (!(cond)) { printf("%s:%d: %s\n",__FILE__,__LINE__,#cond); \
+		failed++; } } while (0)
+
+/** @brief Checks that failed */
+static int failed;
+
+/** @brief Whether entry i of a table is the given game */
+static int entry_is(const leaderboard_t *b, int i, int moves, int seconds,
+		int size)
+{
+	const leaderboard_entry_t *e = &b->entries[i];
+
+	return e->moves == moves && e->seconds == seconds && e->size == size;
+}
+
+/** @brief Inserts and their ranks, ties included */
+static void test_order(void)
+{
+	leaderboard_t b;
+
+	leaderboard_init(&b);
+	CHECK(leaderboard_insert(&b,20,50,6,4) == 0);
+	CHECK(leaderboard_insert(&b,10,90,6,4) == 0);
+	CHECK(leaderboard_insert(&b,15,10,6,4) == 1);
+	CHECK(leaderboard_insert(&b,10,30,6,4) == 0);
+	/* Same moves and seconds as rank 2: goes after it */
+	CHECK(leaderboard_insert(&b,15,10,8,5) == 3);
+	CHECK(b.count == 5);
+	CHECK(entry_is(&b,0,10,30,6));
+	CHECK(entry_is(&b,1,10,90,6));
+	CHECK(entry_is(&b,2,15,10,6));
+	CHECK(entry_is(&b,3,15,10,8));
+	CHECK(entry_is(&b,4,20,50,6));
+}
+
+/** @brief A full table */
+static void test_full(void)
+{
+	leaderboard_t b;
+	int i;
+
+	leaderboard_init(&b);
+	for (i = 0; i < LEADERBOARD_CAPACITY; i++)
+		CHECK(leaderboard_insert(&b,10 + i,0,6,4) == i);
+	CHECK(b.count == LEADERBOARD_CAPACITY);
+
+	/* Worse than all, and tied with the last: turned away */
+	CHECK(leaderboard_insert(&b,100,0,6,4) == -1);
+	CHECK(leaderboard_insert(&b,10 + LEADERBOARD_CAPACITY - 1,0,6,4) == -1);
+	CHECK(b.count == LEADERBOARD_CAPACITY);
+	CHECK(entry_is(&b,LEADERBOARD_CAPACITY - 1,
+			10 + LEADERBOARD_CAPACITY - 1,0,6));
+
+	/* Better than the second: the last one drops out */
+	CHECK(leaderboard_insert(&b,10,5,8,4) == 1);
+	CHECK(b.count == LEADERBOARD_CAPACITY);
+	CHECK(entry_is(&b,0,10,0,6));
+	CHECK(entry_is(&b,1,10,5,8));
+	CHECK(entry_is(&b,2,11,0,6));
+	CHECK(entry_is(&b,LEADERBOARD_CAPACITY - 1,
+			10 + LEADERBOARD_CAPACITY - 2,0,6));
+}
+
+/** @brief Save and restore, and what restore turns away */
+static void test_restore(void)
+{
+	static unsigned char mem[LEADERBOARD_SAVE_SIZE];
+	leaderboard_t b,r;
+	int i;
+
+	leaderboard_init(&b);
+	for (i = 0; i < 5; i++)
+		leaderboard_insert(&b,30 - i,i,6 + i,4);
+	CHECK(leaderboard_save(&b,mem,sizeof(mem)) == 1);
+
+	memset(&r,0xa5,sizeof(r));
+	CHECK(leaderboard_restore(&r,mem,sizeof(mem)) == 1);
+	CHECK(r.count == b.count);
+	CHECK(!memcmp(r.entries,b.entries,b.count * sizeof(b.entries[0])));
+
+	/* Too little room */
+	CHECK(leaderboard_save(&b,mem,16) == -1);
+	CHECK(leaderboard_restore(&r,mem,16) == -1);
+
+	/* A byte of an entry flipped: the checksum no longer matches */
+	leaderboard_init(&r);
+	mem[20] ^= 0x01;
+	CHECK(leaderboard_restore(&r,mem,sizeof(mem)) == -1);
+	CHECK(r.count == 0);
+	mem[20] ^= 0x01;
+
+	/* Bad magic number */
+	mem[0] ^= 0xff;
+	CHECK(leaderboard_restore(&r,mem,sizeof(mem)) == -1);
+	CHECK(r.count == 0);
+	mem[0] ^= 0xff;
+
+	/* Memory that was never saved to */
+	memset(mem,0,sizeof(mem));
+	CHECK(leaderboard_restore(&r,mem,sizeof(mem)) == -1);
+	CHECK(r.count == 0);
+}
+
+int main(void)
+{
+	test_order();
+	test_full();
+	test_restore();
+	if (failed)
+	{
+		printf("%d checks failed\n",failed);
+		return 1;
+	}
+	printf("leaderboard: insert order, ties, full table and restore ok\n");
+	return 0;
+}
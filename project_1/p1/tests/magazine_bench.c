@@ -0,0 +1,265 @@
+/** @file magazine_bench.c
+ *
+ *  @brief magazine mode of alloc_harness: malloc with several contexts
+ *
+ *  Each thread is a malloc context. It mallocs and frees chunks of 12
+ *  to 1000 bytes over its own slots, and hands some of the chunks it
+ *  allocates to the next thread through a ring, which frees them: a
+ *  remote free. The same work runs twice for 1, 2, 4 ... threads, up to
+ *  MALLOC_CONTEXTS:
+ *
+ *  -- global lock: one mutex around every _malloc() and _free(), which
+ *  is what it takes to share the allocator without the magazines
+ *  -- magazines: malloc_set_contexts() gives each thread its own
+ *  context, and the mutex is the malloc lock taken on magazine refills
+ *  and flushes
+ *
+ *  Usage: alloc_harness magazine [ops per thread] [percent handed over]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug Threads only run in parallel on as many CPUs as the host has
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (256 << 20)
+/** @brief Most threads, one per context */
+#define MAX_THREADS MALLOC_CONTEXTS
+/** @brief Chunks a thread keeps */
+#define SLOTS 256
+/** @brief Chunks in flight to a thread (power of 2) */
+#define RING_SIZE 1024
+
+/** @brief Ring a thread receives chunks to free on */
+typedef struct ring {
+	/** @brief Chunks */
+	unsigned char *slot[RING_SIZE];
+	/** @brief Next position the previous thread writes */
+	unsigned int head;
+	/** @brief Next position this thread frees */
+	unsigned int tail;
+} ring_t;
+
+/** @brief Work of a thread */
+typedef struct worker {
+	/** @brief Index, also its malloc context */
+	int id;
+	/** @brief Threads in the run */
+	int nthreads;
+	/** @brief Set if a chunk was overwritten */
+	int bad;
+	/** @brief State of rand_r() */
+	unsigned int seed;
+	/** @brief Chunks it keeps and their sizes */
+	unsigned char *ptr[SLOTS];
+	int size[SLOTS];
+} worker_t;
+
+/** @brief Rings, one per thread */
+static ring_t rings[MAX_THREADS];
+/** @brief Workers */
+static worker_t workers[MAX_THREADS];
+/** @brief Ops per thread and percent handed over */
+static int nops,handover;
+/** @brief Whether the run uses the global lock */
+static int global;
+/** @brief The one lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/** @brief Context of the calling thread */
+static __thread int self;
+
+/** @brief Context hook */
+static int context(void)
+{
+	return self;
+}
+
+/** @brief Lock hook */
+static void lock_malloc(void)
+{
+	pthread_mutex_lock(&lock);
+}
+
+/** @brief Unlock hook */
+static void unlock_malloc(void)
+{
+	pthread_mutex_unlock(&lock);
+}
+
+/** @brief _malloc() as the run shares it */
+static unsigned char *bench_malloc(int size)
+{
+	unsigned char *p;
+
+	if (!global)
+		p = _malloc(size);
+	else
+	{
+		pthread_mutex_lock(&lock);
+		p = _malloc(size);
+		pthread_mutex_unlock(&lock);
+	}
+	if (p)
+		p[0] = p[size - 1] = (unsigned char)size;
+	return p;
+}
+
+/** @brief _free() as the run shares it, checking the stamp */
+static void bench_free(worker_t *w, unsigned char *p, int size)
+{
+	if (p[0] != (unsigned char)size || p[size - 1] != p[0])
+		w->bad = 1;
+	if (!global)
+		_free(p);
+	else
+	{
+		pthread_mutex_lock(&lock);
+		_free(p);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/** @brief Free what the previous thread handed over */
+static void ring_drain(worker_t *w)
+{
+	ring_t *r = &rings[w->id];
+	unsigned int tail = r->tail;
+	unsigned char *p;
+
+	while (tail != __atomic_load_n(&r->head,__ATOMIC_ACQUIRE))
+	{
+		p = r->slot[tail % RING_SIZE];
+		/* ring_put() left the size after the stamp */
+		bench_free(w,p,((int *)p)[1]);
+		__atomic_store_n(&r->tail,++tail,__ATOMIC_RELEASE);
+	}
+}
+
+/** @brief Hand a chunk to the next thread, 0 if its ring is full */
+static int ring_put(worker_t *w, unsigned char *p)
+{
+	ring_t *r = &rings[(w->id + 1) % w->nthreads];
+	unsigned int head = r->head;
+
+	if (head - __atomic_load_n(&r->tail,__ATOMIC_ACQUIRE) == RING_SIZE)
+		return 0;
+	r->slot[head % RING_SIZE] = p;
+	__atomic_store_n(&r->head,head + 1,__ATOMIC_RELEASE);
+	return 1;
+}
+
+/** @brief Body of a thread */
+static void *worker_run(void *arg)
+{
+	worker_t *w = arg;
+	unsigned char *p;
+	int i,s,size;
+
+	self = w->id;
+	for (i = 0; i < nops; i++)
+	{
+		if ((i & 63) == 0)
+			ring_drain(w);
+		s = rand_r(&w->seed) % SLOTS;
+		if (w->ptr[s])
+		{
+			bench_free(w,w->ptr[s],w->size[s]);
+			w->ptr[s] = NULL;
+			continue;
+		}
+		size = 12 + rand_r(&w->seed) % 989;
+		if (!(p = bench_malloc(size)))
+			continue;
+		if (w->nthreads > 1 && rand_r(&w->seed) % 100 < handover)
+		{
+			((int *)p)[1] = size;
+			if (ring_put(w,p))
+				continue;
+			bench_free(w,p,size);
+			continue;
+		}
+		w->ptr[s] = p;
+		w->size[s] = size;
+	}
+	return NULL;
+}
+
+/** @brief Run the threads and free what is left
+ *
+ *  @return Millions of ops per second, -1 if a chunk was overwritten
+ */
+static double run(int nthreads)
+{
+	pthread_t tid[MAX_THREADS];
+	double t;
+	int i,s,bad = 0;
+
+	for (i = 0; i < nthreads; i++)
+	{
+		workers[i].id = i;
+		workers[i].nthreads = nthreads;
+		workers[i].seed = i + 1;
+	}
+	t = now_ns();
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&tid[i],NULL,worker_run,&workers[i]);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(tid[i],NULL);
+	t = now_ns() - t;
+
+	for (i = 0; i < nthreads; i++)
+	{
+		self = i;
+		ring_drain(&workers[i]);
+		for (s = 0; s < SLOTS; s++)
+			if (workers[i].ptr[s])
+			{
+				bench_free(&workers[i],workers[i].ptr[s],
+						workers[i].size[s]);
+				workers[i].ptr[s] = NULL;
+			}
+		bad |= workers[i].bad;
+	}
+	self = 0;
+	return bad ? -1 : (double)nops * nthreads / t * 1e3;
+}
+
+int magazine_mode(int argc, char **argv)
+{
+	double locked,mags;
+	int n;
+
+	nops = argc > 1 ? atoi(argv[1]) : 2000000;
+	handover = argc > 2 ? atoi(argv[2]) : 10;
+	if (heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+
+	printf("%d ops per thread, %d%% freed by the next thread\n",nops,
+			handover);
+	printf("threads  global lock Mops/s  magazines Mops/s\n");
+	for (n = 1; n <= MAX_THREADS; n *= 2)
+	{
+		/* One context, everything under the global lock */
+		global = 1;
+		malloc_set_contexts(NULL,NULL,NULL);
+		locked = run(n);
+		global = 0;
+		malloc_set_contexts(context,lock_malloc,unlock_malloc);
+		mags = run(n);
+		if (locked < 0 || mags < 0)
+		{
+			printf("chunk overwritten\n");
+			return 1;
+		}
+		printf("%7d %20.1f %17.1f\n",n,locked,mags);
+	}
+	return 0;
+}
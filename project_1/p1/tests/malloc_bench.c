@@ -0,0 +1,233 @@
+/** @file malloc_bench.c
+ *
+ *  @brief malloc mode of alloc_harness: the 410kern malloc against lmm
+ *
+ *  The lmm and malloc sources are built for the host and given one
+ *  heap region, as mb_util_lmm() does in the kernel. Each trace is a
+ *  random sequence of mallocs, frees and reallocs over a set of slots
+ *  with its own size mix. It runs twice on the same heap: once with
+ *  every chunk going straight to lmm, which is what _malloc() did
+ *  before the size classes, and once through _malloc(), _realloc() and
+ *  _free(). The growing trace reallocs chunks a little larger each time,
+ *  as a buffer filled in a loop is. Every chunk is stamped at both ends when it is allocated
+ *  and checked before it is freed.
+ *
+ *  Usage: alloc_harness malloc [ops per trace] [slots]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (256 << 20)
+
+/** @brief Operation of a trace */
+typedef struct op {
+	/** @brief Slot it works on */
+	int slot;
+	/** @brief Bytes to allocate, 0 to free the slot */
+	int size;
+} op_t;
+
+/** @brief Size mix of a trace */
+typedef struct trace {
+	/** @brief Name printed */
+	const char *name;
+	/** @brief Percent of chunks up to 128 bytes */
+	int tiny;
+	/** @brief Percent of chunks of 129 to 2040 bytes */
+	int small;
+	/** @brief Percent of reallocs among the ops on a full slot */
+	int realloc;
+	/** @brief Most bytes a realloc adds to the chunk, 0 for a new size */
+	int grow;
+} trace_t;
+
+/** @brief The rest of the chunks are 2 KB to 32 KB */
+static const trace_t traces[] = {
+	{"tiny",100,0,0,0},
+	{"small",60,40,0,0},
+	{"mixed",70,25,0,0},
+	{"mixed+realloc",70,25,20,0},
+	{"large",20,30,0,0},
+	{"growing",50,0,80,1024},
+};
+
+/** @brief Live chunks, one per slot */
+static unsigned char **slot_ptr;
+/** @brief Their sizes */
+static int *slot_size;
+
+/** @brief _malloc() before the size classes */
+static void *lmm_malloc(size_t size)
+{
+	size_t *chunk;
+
+	size += sizeof(size_t);
+	if (!(chunk = lmm_alloc(&malloc_lmm,size,0)))
+		return NULL;
+	*chunk = size;
+	return chunk + 1;
+}
+
+/** @brief _free() before the size classes */
+static void lmm_free_chunk(void *buf)
+{
+	size_t *chunk = (size_t *)buf - 1;
+	lmm_free(&malloc_lmm,chunk,*chunk);
+}
+
+/** @brief Random chunk size of a trace */
+static int trace_size(const trace_t *t)
+{
+	int r = rand() % 100;
+
+	if (r < t->tiny)
+		return 1 + rand() % 128;
+	if (r < t->tiny + t->small)
+		return 129 + rand() % (2040 - 128);
+	return 2048 + rand() % (30 << 10);
+}
+
+/** @brief Generate a trace, ending with every slot free */
+static int trace_make(const trace_t *t, op_t *ops, int nops, int slots)
+{
+	int *cur = calloc(slots,sizeof(*cur));
+	int i,n = 0;
+
+	for (i = 0; i < nops; i++)
+	{
+		ops[n].slot = rand() % slots;
+		if (cur[ops[n].slot] && rand() % 100 >= t->realloc)
+			ops[n].size = 0;
+		else if (cur[ops[n].slot] && t->grow)
+			ops[n].size = cur[ops[n].slot] + 1 + rand() % t->grow;
+		else
+			ops[n].size = trace_size(t);
+		cur[ops[n].slot] = ops[n].size;
+		n++;
+	}
+	for (i = 0; i < slots; i++)
+		if (cur[i])
+		{
+			ops[n].slot = i;
+			ops[n++].size = 0;
+		}
+	free(cur);
+	return n;
+}
+
+/** @brief Stamp a chunk at both ends */
+static void stamp(unsigned char *p, int size, int slot)
+{
+	p[0] = p[size - 1] = slot ^ size;
+}
+
+/** @brief Check the stamp of a slot */
+static int stamp_ok(int slot)
+{
+	unsigned char *p = slot_ptr[slot];
+	int size = slot_size[slot];
+	return p[0] == (unsigned char)(slot ^ size) && p[size - 1] == p[0];
+}
+
+/** @brief Run a trace
+ *
+ *  @param ops Trace
+ *  @param n Ops in it
+ *  @param lmm_only Whether to use lmm_malloc() instead of _malloc()
+ *  @return Nanoseconds taken, -1 if a chunk was lost or overwritten
+ */
+static double trace_run(const op_t *ops, int n, int lmm_only)
+{
+	double t = now_ns();
+	const op_t *op;
+	unsigned char *p,*np;
+	int i,keep;
+
+	for (i = 0; i < n; i++)
+	{
+		op = &ops[i];
+		p = slot_ptr[op->slot];
+		if (p && !stamp_ok(op->slot))
+			return -1;
+		if (op->size == 0)
+		{
+			if (lmm_only)
+				lmm_free_chunk(p);
+			else
+				_free(p);
+			slot_ptr[op->slot] = NULL;
+			continue;
+		}
+		if (p == NULL)
+			p = lmm_only ? lmm_malloc(op->size) : _malloc(op->size);
+		else if (lmm_only)
+		{
+			/* _realloc() before the size classes */
+			keep = slot_size[op->slot] < op->size ? slot_size[op->slot] :
+				op->size;
+			np = lmm_malloc(op->size);
+			if (np)
+				memcpy(np,p,keep);
+			lmm_free_chunk(p);
+			p = np;
+		} else
+			p = _realloc(p,op->size);
+		if (p == NULL)
+			return -1;
+		slot_ptr[op->slot] = p;
+		slot_size[op->slot] = op->size;
+		stamp(p,op->size,op->slot);
+	}
+	return now_ns() - t;
+}
+
+int malloc_mode(int argc, char **argv)
+{
+	int nops = argc > 1 ? atoi(argv[1]) : 1000000;
+	int slots = argc > 2 ? atoi(argv[2]) : 4096;
+	op_t *ops = malloc((nops + slots) * sizeof(*ops));
+	vm_size_t avail;
+	double t_lmm,t_slab;
+	unsigned int i;
+	int n;
+
+	slot_ptr = calloc(slots,sizeof(*slot_ptr));
+	slot_size = calloc(slots,sizeof(*slot_size));
+	if (ops == NULL || slot_ptr == NULL || slot_size == NULL ||
+	    heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+	avail = lmm_avail(&malloc_lmm,0);
+
+	printf("%d ops, %d slots\n",nops,slots);
+	printf("trace            lmm ns/op  malloc ns/op  speedup  kept KB\n");
+	for (i = 0; i < sizeof(traces) / sizeof(traces[0]); i++)
+	{
+		srand(i + 1);
+		n = trace_make(&traces[i],ops,nops,slots);
+		t_lmm = trace_run(ops,n,1);
+		t_slab = trace_run(ops,n,0);
+		if (t_lmm < 0 || t_slab < 0)
+		{
+			printf("%s: chunk lost or overwritten\n",traces[i].name);
+			return 1;
+		}
+		/* What is not back in lmm is the one empty slab each class keeps
+		   and the chunks left in the magazines */
+		printf("%-15s %10.1f %13.1f %8.2f %8lu\n",traces[i].name,t_lmm / n,
+				t_slab / n,t_lmm / t_slab,
+				(avail - lmm_avail(&malloc_lmm,0)) >> 10);
+	}
+	free(ops);
+	return 0;
+}
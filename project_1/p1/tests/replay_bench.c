@@ -0,0 +1,272 @@
+/** @file replay_bench.c
+ *
+ *  @brief Host regression test and benchmark of the game logic
+ *
+ *  With a file argument, every session dumped by the kernel in that
+ *  log (replay_dump() lines, e.g. kernel.log) is replayed, and the
+ *  replay must end with the moves and outcome the kernel recorded.
+ *
+ *  Without one, a bot plays sessions on random boards of every size
+ *  and colour count. It moves the cursor with w,a,s,d towards a block
+ *  of the colour it picks and marks it with space. It mostly follows
+ *  the solver, sometimes plays a random colour (and plans again) or
+ *  quits, and records the
+ *  keys with replay_record(). Every session is replayed and checked
+ *  against what the bot saw, then all of them are replayed again to
+ *  time replay_run(), which floods the board as flood_it() and
+ *  mark() do.
+ *
+ *  Usage: replay_bench [sessions] [rounds]
+ *         replay_bench -f kernel.log
+ *         replay_bench -d sessions    (dump bot sessions as the kernel does)
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mt19937int.h>
+#include "replay.h"
+#include "bitboard.h"
+#include "solver.h"
+#include "bench_util.h"
+
+/** @brief Longest line of a kernel log */
+#define LINE_MAX_CHARS 1024
+
+/** @brief Record a key, the bot takes a few ticks per key */
+static void bot_key(replay_log_t *log, unsigned int *tick, char key)
+{
+	*tick += 1 + rand() % 30;
+	replay_record(log,*tick,key);
+}
+
+/** @brief Play one session and record it
+ *
+ *  @return Number of marks that flooded the board
+ */
+static int bot_session(replay_log_t *log, uint32_t seed, int size, int colors)
+{
+	uint8_t cells[BITBOARD_MAX_ROWS * BITBOARD_MAX_COLS];
+	uint8_t moves[SOLVER_MAX_MOVES];
+	bitboard_t board;
+	unsigned int tick = 0;
+	int i,p,best,limit,row = 0,col = 0,target,dist,d,marks = 0;
+	int planned,step = 0;
+	int count = 0,outcome = REPLAY_PLAYING,quit_at = -1;
+
+	sgenrand(seed);
+	for (i = 0; i < size * size; i++)
+		cells[i] = BITBOARD_COLOR(genrand() % colors);
+	bitboard_load(&board,cells,size,size);
+	planned = solver_solve(&board,moves,SOLVER_MAX_MOVES,NULL,0,NULL);
+	limit = planned + SOLVER_SLACK + 1;
+	replay_start(log,seed,size,size,colors,limit,tick);
+	if (rand() % 20 == 0)
+		quit_at = rand() % limit;
+
+	while (outcome == REPLAY_PLAYING)
+	{
+		if (count == quit_at)
+		{
+			bot_key(log,&tick,'q');
+			outcome = REPLAY_QUIT;
+			break;
+		}
+		/* Mostly the solver's plan, one move in eight a random one */
+		p = rand() % colors;
+		if (rand() % 8 == 0 && p != board.color)
+		{
+			best = p;
+			step = planned;
+		} else
+		{
+			if (step == planned)
+			{
+				planned = solver_solve(&board,moves,SOLVER_MAX_MOVES,NULL,0,
+						NULL);
+				step = 0;
+			}
+			best = moves[step++];
+		}
+		/* Nearest block of that colour outside the region */
+		target = -1;
+		dist = size * 2;
+		for (i = 0; i < size * size; i++)
+		{
+			if (cells[i] != BITBOARD_COLOR(best) ||
+					bitset_test(&board.region,i / size,i % size))
+				continue;
+			d = abs(i / size - row) + abs(i % size - col);
+			if (d < dist)
+			{
+				dist = d;
+				target = i;
+			}
+		}
+		if (target < 0)
+			continue;
+		while (row != target / size || col != target % size)
+		{
+			if (rand() % 16 == 0)
+				bot_key(log,&tick,"xnh"[rand() % 3]);
+			if (row < target / size)
+				bot_key(log,&tick,'s'),row++;
+			else if (row > target / size)
+				bot_key(log,&tick,'w'),row--;
+			else if (col < target % size)
+				bot_key(log,&tick,'d'),col++;
+			else
+				bot_key(log,&tick,'a'),col--;
+		}
+		bot_key(log,&tick,' ');
+		count++;
+		if (count >= limit)
+		{
+			outcome = REPLAY_FAILED;
+			break;
+		}
+		/* cells is the bot's view of the screen */
+		bitboard_move(&board,best);
+		for (i = 0; i < size * size; i++)
+			if (bitset_test(&board.region,i / size,i % size))
+				cells[i] = BITBOARD_COLOR(best);
+		marks++;
+		if (bitboard_is_done(&board))
+			outcome = REPLAY_FINISHED;
+	}
+	replay_end(log,outcome,count);
+	return marks;
+}
+
+/** @brief Replay the sessions of a kernel log and check them */
+static int replay_file(const char *path)
+{
+	static replay_log_t log;
+	char line[LINE_MAX_CHARS],*p;
+	replay_result_t result;
+	unsigned int seed,delta,key;
+	int rows,cols,colors,limit,events,moves,outcome,used;
+	int sessions = 0,bad = 0,open = 0;
+	FILE *f = fopen(path,"r");
+
+	if (f == NULL)
+	{
+		perror(path);
+		return 1;
+	}
+	while (1)
+	{
+		p = fgets(line,sizeof(line),f);
+		/* A session ends at the next header or at the end of the log */
+		if (open && (p == NULL || strstr(line,"replay v1 ") != NULL))
+		{
+			if (replay_run(&log,&result) < 0)
+			{
+				printf("session %d (seed %u): not a valid session\n",sessions,
+						log.seed);
+				bad++;
+			}
+			else if (result.moves != log.moves ||
+					result.outcome != log.outcome)
+			{
+				printf("session %d (seed %u): kernel %d moves outcome %d, "
+						"replay %d moves outcome %d\n",sessions,log.seed,log.moves,
+						log.outcome,result.moves,result.outcome);
+				bad++;
+			}
+			sessions++;
+			open = 0;
+		}
+		if (p == NULL)
+			break;
+		if ((p = strstr(line,"replay v1 ")) != NULL)
+		{
+			if (sscanf(p,"replay v1 seed=%u size=%dx%d colors=%d limit=%d "
+					"events=%d moves=%d outcome=%d",&seed,&rows,&cols,&colors,
+					&limit,&events,&moves,&outcome) != 8)
+				continue;
+			replay_start(&log,seed,rows,cols,colors,limit,0);
+			replay_end(&log,outcome,moves);
+			open = 1;
+		} else if (open && (p = strstr(line,"replay ev ")) != NULL)
+		{
+			p += strlen("replay ev ");
+			while (sscanf(p,"%u:%x%n",&delta,&key,&used) == 2)
+			{
+				replay_record(&log,log.last_tick + delta,(char)key);
+				p += used;
+			}
+		}
+	}
+	fclose(f);
+	printf("%d sessions replayed, %d mismatches\n",sessions,bad);
+	return bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+	int sessions,rounds,i,r,marks = 0,events = 0;
+	int outcomes[4] = {0,0,0,0};
+	replay_log_t *logs;
+	replay_result_t result;
+	double t;
+
+	if (argc > 2 && strcmp(argv[1],"-f") == 0)
+		return replay_file(argv[2]);
+	if (argc > 2 && strcmp(argv[1],"-d") == 0)
+	{
+		static replay_log_t log;
+		srand(1);
+		for (i = 0; i < atoi(argv[2]); i++)
+		{
+			bot_session(&log,i + 1,6 + 2 * (rand() % 5),4 + rand() % 5);
+			replay_dump(&log);
+		}
+		return 0;
+	}
+	sessions = argc > 1 ? atoi(argv[1]) : 2000;
+	rounds = argc > 2 ? atoi(argv[2]) : 5;
+	logs = malloc(sessions * sizeof(*logs));
+	if (logs == NULL)
+		return 1;
+
+	srand(1);
+	for (i = 0; i < sessions; i++)
+	{
+		marks += bot_session(&logs[i],i + 1,6 + 2 * (rand() % 5),
+				4 + rand() % 5);
+		events += logs[i].count;
+		outcomes[logs[i].outcome]++;
+		if (replay_run(&logs[i],&result) < 0)
+		{
+			printf("session %d: not a valid session\n",i);
+			return 1;
+		}
+		if (result.moves != logs[i].moves ||
+				result.outcome != logs[i].outcome)
+		{
+			printf("session %d: bot %d moves outcome %d, replay %d moves "
+					"outcome %d\n",i,logs[i].moves,logs[i].outcome,
+					result.moves,result.outcome);
+			return 1;
+		}
+	}
+	printf("%d sessions: %d finished, %d failed, %d quit, %d keys, "
+			"%d floods\n",sessions,outcomes[REPLAY_FINISHED],
+			outcomes[REPLAY_FAILED],outcomes[REPLAY_QUIT],events,marks);
+
+	t = now_ns();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < sessions; i++)
+			replay_run(&logs[i],&result);
+	t = now_ns() - t;
+	printf("replay: %.0f sessions/s, %.1f us/session, %.0f ns/key, "
+			"%.0f ns/flood\n",sessions * rounds / (t / 1e9),
+			t / 1e3 / (sessions * rounds),t / ((double)events * rounds),
+			t / ((double)marks * rounds));
+	free(logs);
+	return 0;
+}
@@ -0,0 +1,100 @@
+/** @file solver_bench.c
+ *
+ *  @brief Host benchmark of the Flood-It solver
+ *
+ *  Solves random boards of every size and colour count the game
+ *  offers, one board per seed, with the time budget the game uses.
+ *  Every solution is replayed on the bitboard to check that it floods
+ *  the board. For each setting it prints the greedy and final
+ *  solution lengths, the limit the game used to set, and the time
+ *  taken.
+ *
+ *  Usage: solver_bench [seeds per setting] [budget in ms]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bitboard.h"
+#include "solver.h"
+
+/** @brief Move limits the game used before the solver */
+static const int max_iter[5][5] = {
+	{7,8,10,12,14},
+	{9,11,14,16,19},
+	{11,14,17,20,23},
+	{14,17,21,25,28},
+	{16,20,25,29,33}
+};
+
+/** @brief Current time in nanoseconds */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	int seeds = argc > 1 ? atoi(argv[1]) : 200;
+	uint64_t budget = (argc > 2 ? atoi(argv[2]) : 50) * 1000000ULL;
+	uint8_t cells[BITBOARD_MAX_ROWS * BITBOARD_MAX_COLS];
+	uint8_t moves[SOLVER_MAX_MOVES];
+	bitboard_t board,replay;
+	solver_stats_t st;
+	int s,b,c,i,n,size,colors,timeouts,worst,total = 0;
+	double greedy_sum,moves_sum,ms_sum,ms_max;
+
+	printf("size colors  table greedy  solver  worst  avg ms  max ms"
+			"  timeouts\n");
+	for (b = 0; b < 5; b++)
+	{
+		for (c = 0; c < 5; c++)
+		{
+			size = 6 + 2 * b;
+			colors = 4 + c;
+			greedy_sum = moves_sum = ms_sum = ms_max = 0;
+			timeouts = worst = 0;
+			for (s = 0; s < seeds; s++)
+			{
+				srand(s * 25 + b * 5 + c + 1);
+				for (i = 0; i < size * size; i++)
+					cells[i] = BITBOARD_COLOR(rand() % colors);
+				bitboard_load(&board,cells,size,size);
+				n = solver_solve(&board,moves,SOLVER_MAX_MOVES,now_ns,budget,
+						&st);
+				if (n < 0)
+				{
+					printf("seed %d: no solution\n",s);
+					return 1;
+				}
+				replay = board;
+				for (i = 0; i < n; i++)
+					bitboard_move(&replay,moves[i]);
+				if (!bitboard_is_done(&replay))
+				{
+					printf("seed %d: solution does not flood the board\n",s);
+					return 1;
+				}
+				greedy_sum += st.greedy_moves;
+				moves_sum += n;
+				ms_sum += st.ns / 1e6;
+				if (st.ns / 1e6 > ms_max)
+					ms_max = st.ns / 1e6;
+				if (n > worst)
+					worst = n;
+				timeouts += st.timed_out;
+				total++;
+			}
+			printf("%2dx%-2d %5d %6d %6.2f %7.2f %6d %7.2f %7.2f %9d\n",
+					size,size,colors,max_iter[b][c],greedy_sum / seeds,
+					moves_sum / seeds,worst,ms_sum / seeds,ms_max,timeouts);
+		}
+	}
+	printf("%d boards solved\n",total);
+	return 0;
+}
@@ -0,0 +1,156 @@
+/** @file stats_bench.c
+ *
+ *  @brief stats mode of alloc_harness: check and cost of the accounting
+ *
+ *  Only in alloc_harness_stats, whose malloc is built with MALLOC_STATS.
+ *  Two call sites leak a known number of chunks, one small and one from
+ *  lmm, among random mallocs and frees that are all given back, and the
+ *  leak report has to name exactly those two sites with their chunks
+ *  and bytes. The class counts, live and peak bytes are checked as
+ *  well, then the report is logged as the 'l' key does in the kernel.
+ *
+ *  The random part is timed, for comparison with the malloc mode of
+ *  alloc_harness, which is built without the accounting.
+ *
+ *  Usage: alloc_harness_stats stats [ops] [slots]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include <malloc/malloc_stats.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (64 << 20)
+/** @brief Chunks each leaking site keeps */
+#define LEAKS 100
+/** @brief Size of the small and the large leaked chunks */
+#define SMALL_LEAK 40
+#define LARGE_LEAK 5000
+
+/** @brief Leaked chunks, freed at the end */
+static void *leaked[2][LEAKS];
+
+/** @brief One leaking call site */
+static __attribute__((noinline)) void *leak_small(void)
+{
+	return _malloc(SMALL_LEAK);
+}
+
+/** @brief The other one */
+static __attribute__((noinline)) void *leak_large(void)
+{
+	return _malloc(LARGE_LEAK);
+}
+
+/** @brief Random mallocs and frees that end with everything freed
+ *
+ *  @return Nanoseconds per op
+ */
+static double churn(int nops, int slots)
+{
+	void **ptr = calloc(slots,sizeof(*ptr));
+	double t = now_ns();
+	int i,s;
+
+	for (i = 0; i < nops; i++)
+	{
+		s = rand() % slots;
+		if (ptr[s])
+		{
+			_free(ptr[s]);
+			ptr[s] = NULL;
+		}
+		else
+			ptr[s] = _malloc(1 + rand() % (rand() % 8 ? 500 : 8000));
+		if (i % (nops / LEAKS) == 0 && i / (nops / LEAKS) < LEAKS)
+		{
+			leaked[0][i / (nops / LEAKS)] = leak_small();
+			leaked[1][i / (nops / LEAKS)] = leak_large();
+		}
+	}
+	t = now_ns() - t;
+	for (s = 0; s < slots; s++)
+		if (ptr[s])
+			_free(ptr[s]);
+	free(ptr);
+	return t / nops;
+}
+
+/** @brief Check the accounting with the leaks live
+ *
+ *  @return 0 if it matches, -1 otherwise
+ */
+static int check(void)
+{
+	malloc_site_stats_t sites[4];
+	malloc_stats_t st;
+	unsigned int allocs = 0,frees = 0,i;
+	int n;
+
+	if (malloc_stats_get(&st) < 0)
+		return -1;
+	for (i = 0; i < MALLOC_STATS_CLASSES; i++)
+	{
+		allocs += st.classes[i].allocs;
+		frees += st.classes[i].frees;
+	}
+	if (allocs - frees != 2 * LEAKS || st.untracked != 0 ||
+	    st.live_bytes != LEAKS * (SMALL_LEAK + LARGE_LEAK) ||
+	    st.classes[SLAB_CLASSES].live_bytes != LEAKS * LARGE_LEAK ||
+	    st.peak_bytes < st.live_bytes ||
+	    st.largest_free > st.free_bytes)
+		return -1;
+
+	n = malloc_stats_sites(sites,4);
+	if (n != 2 ||
+	    sites[0].chunks != LEAKS || sites[0].bytes != LEAKS * LARGE_LEAK ||
+	    sites[1].chunks != LEAKS || sites[1].bytes != LEAKS * SMALL_LEAK)
+		return -1;
+	return 0;
+}
+
+int stats_mode(int argc, char **argv)
+{
+	int nops = argc > 1 ? atoi(argv[1]) : 1000000;
+	int slots = argc > 2 ? atoi(argv[2]) : 4096;
+	malloc_stats_t st;
+	double ns;
+	int i;
+
+	if (nops < LEAKS || heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+
+	srand(1);
+	ns = churn(nops,slots);
+	printf("%d ops, %d slots: %.1f ns/op with the accounting\n",nops,slots,
+			ns);
+	if (check() < 0)
+	{
+		printf("accounting does not match the leaks\n");
+		malloc_stats_dump();
+		return 1;
+	}
+	malloc_stats_dump();
+
+	for (i = 0; i < LEAKS; i++)
+	{
+		_free(leaked[0][i]);
+		_free(leaked[1][i]);
+	}
+	malloc_stats_get(&st);
+	if (st.live_bytes != 0 || malloc_stats_sites(NULL,0) != 0)
+	{
+		printf("live bytes left after freeing everything\n");
+		return 1;
+	}
+	printf("leak report matches\n");
+	return 0;
+}
@@ -0,0 +1,213 @@
+/** @file wheel_test.c
+ *
+ *  @brief Host test of the timer driver's timing wheel
+ *
+ *  The wheel is advanced one tick at a time, as the timer interrupt
+ *  does, and every expired timer is run on the spot.
+ *
+ *  -- Timers just before, on and just after each level boundary fire
+ *  once, on the tick they were due, however often they were cascaded
+ *  -- A timer beyond the top level fires when the top level runs out
+ *  -- A periodic timer keeps its phase across cascades and can cancel
+ *  itself from its own function
+ *  -- Cancel stops a timer; the id of a released timer is turned away,
+ *  also once its pool entry is handed out again
+ *  -- timer_wheel_next_expiry() never points past the next expiry
+ *  -- The pool runs out after MAX_TIMERS timers
+ *
+ *  Usage: wheel_test
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include "timer_wheel.h"
+
+/** @brief Report a failed check and count it */
+#define CHECK(cond) \
+	do { if (!(cond)) { printf("%s:%d: %s\n",__FILE__,__LINE__,#cond); \
+		failed++; } } while (0)
+
+/** @brief Ticks the top level of the wheel reaches */
+#define WHEEL_SPAN (1u << (WHEEL_BITS * WHEEL_LEVELS))
+
+/** @brief Checks that failed */
+static int failed;
+
+/** @brief Tick the wheel was advanced to */
+static unsigned int now;
+
+/** @brief What a timer's function saw */
+typedef struct fired {
+	/** @brief Runs so far */
+	int runs;
+	/** @brief Tick of the last run */
+	unsigned int tick;
+	/** @brief Own id and the run to cancel itself on, 0 for never */
+	int id;
+	int cancel_at;
+} fired_t;
+
+/** @brief Function of every timer: note the run */
+static void note(void *arg)
+{
+	fired_t *f = arg;
+
+	f->runs++;
+	f->tick = now;
+	if (f->runs == f->cancel_at)
+		CHECK(timer_wheel_cancel(f->id) == 1);
+}
+
+/** @brief Advance to a tick, running what expires on the way */
+static void run_to(unsigned int tick)
+{
+	void (*fn)(void *);
+	void *arg;
+
+	while ((int)(tick - now) > 0)
+	{
+		now++;
+		timer_wheel_advance(now);
+		while (timer_wheel_pop_expired(&fn,&arg))
+			(*fn)(arg);
+	}
+}
+
+/** @brief Timers around every level boundary */
+static void test_boundaries(void)
+{
+	static const unsigned int delays[] = {
+		1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+	};
+	enum { N = sizeof(delays) / sizeof(delays[0]) };
+	fired_t f[N] = {{0}};
+	unsigned int start;
+	int i;
+
+	/* Off any slot boundary, so that cascades come early for some */
+	run_to(now + 37);
+	start = now;
+	for (i = 0; i < N; i++)
+		CHECK(timer_wheel_add(start + delays[i],0,note,&f[i]) >= 0);
+	run_to(start + delays[N - 1] + 100);
+	for (i = 0; i < N; i++)
+	{
+		if (f[i].runs != 1 || f[i].tick != start + delays[i])
+			printf("delay %u: %d runs, last at +%u\n",delays[i],f[i].runs,
+					f[i].tick - start);
+		CHECK(f[i].runs == 1 && f[i].tick == start + delays[i]);
+	}
+}
+
+/** @brief A timer further away than the wheel reaches */
+static void test_beyond(void)
+{
+	fired_t f = {0};
+	unsigned int start = now;
+
+	CHECK(timer_wheel_add(start + WHEEL_SPAN + 1000,0,note,&f) >= 0);
+	run_to(start + WHEEL_SPAN + 2000);
+	CHECK(f.runs == 1);
+	CHECK(f.tick == start + WHEEL_SPAN - 1);
+}
+
+/** @brief A periodic timer that cancels itself on its fifth run */
+static void test_periodic(void)
+{
+	fired_t f = {0};
+	unsigned int start = now;
+
+	f.cancel_at = 5;
+	f.id = timer_wheel_add(start + 10,1000,note,&f);
+	CHECK(f.id >= 0);
+	run_to(start + 3500);
+	CHECK(f.runs == 4 && f.tick == start + 3010);
+	run_to(start + 10000);
+	CHECK(f.runs == 5 && f.tick == start + 4010);
+}
+
+/** @brief Cancel, and ids that no longer name a timer */
+static void test_cancel(void)
+{
+	fired_t a = {0},b = {0};
+	int ida,idb;
+
+	ida = timer_wheel_add(now + 100,0,note,&a);
+	CHECK(ida >= 0);
+	CHECK(timer_wheel_cancel(ida) == 1);
+	CHECK(timer_wheel_cancel(ida) == -1);
+	run_to(now + 200);
+	CHECK(a.runs == 0);
+
+	/* a fires and is released, b gets its pool entry back */
+	ida = timer_wheel_add(now + 5,0,note,&a);
+	run_to(now + 5);
+	CHECK(a.runs == 1);
+	idb = timer_wheel_add(now + 5,0,note,&b);
+	CHECK(idb >= 0 && idb != ida);
+	CHECK((idb & ((1 << TIMER_ID_BITS) - 1)) ==
+			(ida & ((1 << TIMER_ID_BITS) - 1)));
+	CHECK(timer_wheel_cancel(ida) == -1);
+	run_to(now + 5);
+	CHECK(b.runs == 1);
+
+	CHECK(timer_wheel_cancel(-1) == -1);
+	CHECK(timer_wheel_cancel(MAX_TIMERS) == -1);
+}
+
+/** @brief The next expiry is never later than the timer */
+static void test_next_expiry(void)
+{
+	fired_t f = {0};
+	unsigned int when,expires = now + 5000;
+	int id;
+
+	CHECK(timer_wheel_next_expiry(&when) == 0);
+	id = timer_wheel_add(expires,0,note,&f);
+	while ((int)(now - expires) < 0)
+	{
+		CHECK(timer_wheel_next_expiry(&when) == 1);
+		CHECK((int)(when - now) > 0 && (int)(when - expires) <= 0);
+		if ((int)(when - now) <= 0 || (int)(when - expires) > 0)
+			break;
+		/* Sleep until then, as deadline mode does */
+		run_to(when);
+	}
+	CHECK(f.runs == 1 && f.tick == expires);
+	CHECK(timer_wheel_cancel(id) == -1);
+}
+
+/** @brief The pool holds MAX_TIMERS timers */
+static void test_pool(void)
+{
+	fired_t f = {0};
+	int ids[MAX_TIMERS],i;
+
+	for (i = 0; i < MAX_TIMERS; i++)
+		CHECK((ids[i] = timer_wheel_add(now + 10 + i,0,note,&f)) >= 0);
+	CHECK(timer_wheel_add(now + 10,0,note,&f) == -1);
+	for (i = 0; i < MAX_TIMERS; i++)
+		CHECK(timer_wheel_cancel(ids[i]) == 1);
+	run_to(now + 100);
+	CHECK(f.runs == 0);
+}
+
+int main(void)
+{
+	test_boundaries();
+	test_beyond();
+	test_periodic();
+	test_cancel();
+	test_next_expiry();
+	test_pool();
+	if (failed)
+	{
+		printf("%d checks failed\n",failed);
+		return 1;
+	}
+	printf("wheel: level boundaries, cascades, periodic, cancel and "
+			"pool ok\n");
+	return 0;
+}
@@ -0,0 +1,99 @@
+/** @file zero_bench.c
+ *
+ *  @brief zero mode of alloc_harness: calloc with and without the zeroed
+ *  page pool
+ *
+ *  Rounds of ZERO_POOL_PAGES callocs of 2 to 4 KB, which dirty their
+ *  chunks and free them again, so that every page is reused dirty.
+ *  Each round runs once with the pool empty, where calloc zeroes the
+ *  page on the spot, and once after zero_pool_fill(), as it runs while
+ *  the kernel waits for a key. Only the callocs are timed, and every
+ *  chunk has to come back zeroed.
+ *
+ *  Usage: alloc_harness zero [rounds]
+ *
+ *  @author Ishant Dawer (idawer)
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmm/lmm.h>
+#include <lmm/lmm_types.h>
+#include <malloc/malloc_internal.h>
+#include <malloc/zero_pool.h>
+#include "bench_util.h"
+#include "alloc_harness.h"
+
+/** @brief Bytes of the heap */
+#define HEAP_SIZE (16 << 20)
+
+/** @brief One round of callocs, dirtied and freed
+ *
+ *  @param t Time of the callocs is added to it
+ *  @return 0, -1 if a chunk was not zeroed
+ */
+static int round_run(double *t)
+{
+	unsigned char *p[ZERO_POOL_PAGES];
+	size_t size[ZERO_POOL_PAGES];
+	double start;
+	size_t j;
+	int i;
+
+	for (i = 0; i < ZERO_POOL_PAGES; i++)
+		size[i] = 2100 + rand() % 1900;
+	start = now_ns();
+	for (i = 0; i < ZERO_POOL_PAGES; i++)
+		p[i] = _calloc(1,size[i]);
+	*t += now_ns() - start;
+
+	for (i = 0; i < ZERO_POOL_PAGES; i++)
+	{
+		if (!p[i])
+			return -1;
+		for (j = 0; j < size[i]; j++)
+			if (p[i][j])
+				return -1;
+		memset(p[i],0xa5,size[i]);
+	}
+	for (i = 0; i < ZERO_POOL_PAGES; i++)
+		_free(p[i]);
+	return 0;
+}
+
+int zero_mode(int argc, char **argv)
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+	double cold = 0,warm = 0,fill = 0,start;
+	int r;
+
+	if (heap_init(&malloc_lmm,HEAP_SIZE) == NULL)
+		return 2;
+
+	srand(1);
+	for (r = 0; r < rounds; r++)
+	{
+		if (round_run(&cold) < 0)
+			break;
+		start = now_ns();
+		zero_pool_fill(ZERO_POOL_PAGES);
+		fill += now_ns() - start;
+		if (zero_pool_count() != ZERO_POOL_PAGES || round_run(&warm) < 0)
+			break;
+	}
+	if (r < rounds)
+	{
+		printf("calloc chunk not zeroed\n");
+		return 1;
+	}
+
+	printf("%d rounds of %d callocs of 2 to 4 KB\n",rounds,ZERO_POOL_PAGES);
+	printf("pool empty:  %6.1f ns per calloc\n",
+			cold / rounds / ZERO_POOL_PAGES);
+	printf("pool filled: %6.1f ns per calloc, %.1f ns per page to fill\n",
+			warm / rounds / ZERO_POOL_PAGES,
+			fill / rounds / ZERO_POOL_PAGES);
+	return 0;
+}